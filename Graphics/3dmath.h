@@ -1,6 +1,7 @@
 #ifndef _GRAPHICS_3DMATH_H
 #define _GRAPHICS_3DMATH_H
 
+#include <stdint.h>
 #include <math.h>
 #include <string.h>
 
@@ -34,6 +35,22 @@ static INLINE void NormalizeVector(float *v)
 
 void TransformVectorNormalize(float vec[3], float mtx[4][4]);
 
+/* Four-vertex batch kernels for the gSP vertex pipeline.
+ *
+ * 'vtx' points at four consecutive vertices. Each kernel gives the same
+ * result, bit for bit, as running the per-vertex code on each vertex in
+ * turn; they use SSE2 or AArch64 NEON when the build targets them and a
+ * plain loop otherwise. */
+struct SPVertex;
+struct SPLight;
+
+void TransformVertex4(struct SPVertex *vtx, float mtx[4][4]);
+void TransformVectorNormalize4(struct SPVertex *vtx, float mtx[4][4]);
+void LightVertex4(struct SPVertex *vtx, const struct SPLight *lights, uint32_t numLights);
+void PointLightVertex4(struct SPVertex *vtx, float vPos[3][4],
+      const struct SPLight *lights, uint32_t numLights);
+void ClipVertex4(struct SPVertex *vtx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,7 +1,10 @@
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "3dmath.h"
+#include "RSP/gSP_state.h"
 
 void TransformVectorNormalize(float vec[3], float mtx[4][4])
 {
@@ -32,3 +35,289 @@ void TransformVectorNormalize(float vec[3], float mtx[4][4])
       vec[2] /= len;
    }
 }
+
+/* Four-lane float vectors for the batch kernels below. Min, max and clamps
+ * are spelt as compare-and-select so every backend resolves them exactly
+ * like the scalar 'a < b ? a : b' code they replace. */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+typedef __m128 v4sf;
+typedef __m128 v4mask;
+
+static INLINE v4sf v4_load(const float *p)         { return _mm_loadu_ps(p); }
+static INLINE void v4_store(float *p, v4sf a)      { _mm_storeu_ps(p, a); }
+static INLINE v4sf v4_set1(float f)                { return _mm_set1_ps(f); }
+static INLINE v4sf v4_add(v4sf a, v4sf b)          { return _mm_add_ps(a, b); }
+static INLINE v4sf v4_sub(v4sf a, v4sf b)          { return _mm_sub_ps(a, b); }
+static INLINE v4sf v4_mul(v4sf a, v4sf b)          { return _mm_mul_ps(a, b); }
+static INLINE v4sf v4_div(v4sf a, v4sf b)          { return _mm_div_ps(a, b); }
+static INLINE v4sf v4_sqrt(v4sf a)                 { return _mm_sqrt_ps(a); }
+static INLINE v4mask v4_cmpgt(v4sf a, v4sf b)      { return _mm_cmpgt_ps(a, b); }
+static INLINE v4mask v4_cmplt(v4sf a, v4sf b)      { return _mm_cmplt_ps(a, b); }
+static INLINE v4mask v4_cmpneq(v4sf a, v4sf b)     { return _mm_cmpneq_ps(a, b); }
+static INLINE int v4_movemask(v4mask m)            { return _mm_movemask_ps(m); }
+
+static INLINE v4sf v4_select(v4mask m, v4sf a, v4sf b)
+{
+   return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+static INLINE void v4_transpose(v4sf *r0, v4sf *r1, v4sf *r2, v4sf *r3)
+{
+   _MM_TRANSPOSE4_PS(*r0, *r1, *r2, *r3);
+}
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(HAVE_NEON))
+#include <arm_neon.h>
+
+typedef float32x4_t v4sf;
+typedef uint32x4_t v4mask;
+
+static INLINE v4sf v4_load(const float *p)         { return vld1q_f32(p); }
+static INLINE void v4_store(float *p, v4sf a)      { vst1q_f32(p, a); }
+static INLINE v4sf v4_set1(float f)                { return vdupq_n_f32(f); }
+static INLINE v4sf v4_add(v4sf a, v4sf b)          { return vaddq_f32(a, b); }
+static INLINE v4sf v4_sub(v4sf a, v4sf b)          { return vsubq_f32(a, b); }
+static INLINE v4sf v4_mul(v4sf a, v4sf b)          { return vmulq_f32(a, b); }
+static INLINE v4sf v4_div(v4sf a, v4sf b)          { return vdivq_f32(a, b); }
+static INLINE v4sf v4_sqrt(v4sf a)                 { return vsqrtq_f32(a); }
+static INLINE v4mask v4_cmpgt(v4sf a, v4sf b)      { return vcgtq_f32(a, b); }
+static INLINE v4mask v4_cmplt(v4sf a, v4sf b)      { return vcltq_f32(a, b); }
+static INLINE v4mask v4_cmpneq(v4sf a, v4sf b)     { return vmvnq_u32(vceqq_f32(a, b)); }
+
+static INLINE int v4_movemask(v4mask m)
+{
+   static const uint32_t bits[4] = { 1, 2, 4, 8 };
+   return (int)vaddvq_u32(vandq_u32(m, vld1q_u32(bits)));
+}
+
+static INLINE v4sf v4_select(v4mask m, v4sf a, v4sf b)
+{
+   return vbslq_f32(m, a, b);
+}
+
+static INLINE void v4_transpose(v4sf *r0, v4sf *r1, v4sf *r2, v4sf *r3)
+{
+   float32x4x2_t t01 = vtrnq_f32(*r0, *r1);
+   float32x4x2_t t23 = vtrnq_f32(*r2, *r3);
+   *r0 = vcombine_f32(vget_low_f32(t01.val[0]),  vget_low_f32(t23.val[0]));
+   *r1 = vcombine_f32(vget_low_f32(t01.val[1]),  vget_low_f32(t23.val[1]));
+   *r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+   *r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#else
+typedef struct { float f[4]; } v4sf;
+typedef struct { int m[4]; } v4mask;
+
+#define V4_MAP(expr) { v4sf r; int i; for (i = 0; i < 4; i++) r.f[i] = (expr); return r; }
+#define V4_CMP(expr) { v4mask r; int i; for (i = 0; i < 4; i++) r.m[i] = (expr); return r; }
+
+static INLINE v4sf v4_load(const float *p)         V4_MAP(p[i])
+static INLINE v4sf v4_set1(float f)                V4_MAP(f)
+static INLINE v4sf v4_add(v4sf a, v4sf b)          V4_MAP(a.f[i] + b.f[i])
+static INLINE v4sf v4_sub(v4sf a, v4sf b)          V4_MAP(a.f[i] - b.f[i])
+static INLINE v4sf v4_mul(v4sf a, v4sf b)          V4_MAP(a.f[i] * b.f[i])
+static INLINE v4sf v4_div(v4sf a, v4sf b)          V4_MAP(a.f[i] / b.f[i])
+static INLINE v4sf v4_sqrt(v4sf a)                 V4_MAP(sqrtf(a.f[i]))
+static INLINE v4mask v4_cmpgt(v4sf a, v4sf b)      V4_CMP(a.f[i] > b.f[i])
+static INLINE v4mask v4_cmplt(v4sf a, v4sf b)      V4_CMP(a.f[i] < b.f[i])
+static INLINE v4mask v4_cmpneq(v4sf a, v4sf b)     V4_CMP(a.f[i] != b.f[i])
+static INLINE v4sf v4_select(v4mask m, v4sf a, v4sf b) V4_MAP(m.m[i] ? a.f[i] : b.f[i])
+
+#undef V4_MAP
+#undef V4_CMP
+
+static INLINE void v4_store(float *p, v4sf a)
+{
+   memcpy(p, a.f, sizeof(a.f));
+}
+
+static INLINE int v4_movemask(v4mask m)
+{
+   return (m.m[0] ? 1 : 0) | (m.m[1] ? 2 : 0) | (m.m[2] ? 4 : 0) | (m.m[3] ? 8 : 0);
+}
+
+static INLINE void v4_transpose(v4sf *r0, v4sf *r1, v4sf *r2, v4sf *r3)
+{
+   v4sf *rows[4];
+   float t[4][4];
+   int i, j;
+   rows[0] = r0; rows[1] = r1; rows[2] = r2; rows[3] = r3;
+   for (i = 0; i < 4; i++)
+      for (j = 0; j < 4; j++)
+         t[j][i] = rows[i]->f[j];
+   for (i = 0; i < 4; i++)
+      memcpy(rows[i]->f, t[i], sizeof(t[i]));
+}
+#endif
+
+/* Same values as the CLIP_* flags in both plugins' gSP.h. */
+#define CLIP4_NEGX   0x01
+#define CLIP4_POSX   0x02
+#define CLIP4_NEGY   0x04
+#define CLIP4_POSY   0x08
+#define CLIP4_Z      0x10
+
+/* Gathers the four floats at 'field' of four vertices into one register per
+ * component; v4_scatter writes them back. */
+static INLINE void v4_gather(struct SPVertex *vtx, size_t field,
+      v4sf *c0, v4sf *c1, v4sf *c2, v4sf *c3)
+{
+   *c0 = v4_load((const float*)((const char*)&vtx[0] + field));
+   *c1 = v4_load((const float*)((const char*)&vtx[1] + field));
+   *c2 = v4_load((const float*)((const char*)&vtx[2] + field));
+   *c3 = v4_load((const float*)((const char*)&vtx[3] + field));
+   v4_transpose(c0, c1, c2, c3);
+}
+
+static INLINE void v4_scatter(struct SPVertex *vtx, size_t field,
+      v4sf c0, v4sf c1, v4sf c2, v4sf c3)
+{
+   v4_transpose(&c0, &c1, &c2, &c3);
+   v4_store((float*)((char*)&vtx[0] + field), c0);
+   v4_store((float*)((char*)&vtx[1] + field), c1);
+   v4_store((float*)((char*)&vtx[2] + field), c2);
+   v4_store((float*)((char*)&vtx[3] + field), c3);
+}
+
+void TransformVertex4(struct SPVertex *vtx, float mtx[4][4])
+{
+   v4sf x, y, z, w, out[4];
+   int i;
+
+   v4_gather(vtx, offsetof(struct SPVertex, x), &x, &y, &z, &w);
+
+   for (i = 0; i < 4; i++)
+      out[i] = v4_add(v4_add(v4_add(
+                  v4_mul(x, v4_set1(mtx[0][i])),
+                  v4_mul(y, v4_set1(mtx[1][i]))),
+                  v4_mul(z, v4_set1(mtx[2][i]))),
+                  v4_set1(mtx[3][i]));
+
+   v4_scatter(vtx, offsetof(struct SPVertex, x), out[0], out[1], out[2], out[3]);
+}
+
+void TransformVectorNormalize4(struct SPVertex *vtx, float mtx[4][4])
+{
+   v4sf x, y, z, pad, out[3], len, zero;
+   v4mask nonzero;
+   int i;
+
+   v4_gather(vtx, offsetof(struct SPVertex, nx), &x, &y, &z, &pad);
+
+   for (i = 0; i < 3; i++)
+      out[i] = v4_add(v4_add(
+                  v4_mul(v4_set1(mtx[0][i]), x),
+                  v4_mul(v4_set1(mtx[1][i]), y)),
+                  v4_mul(v4_set1(mtx[2][i]), z));
+
+   len     = v4_add(v4_add(v4_mul(out[0], out[0]), v4_mul(out[1], out[1])),
+         v4_mul(out[2], out[2]));
+   zero    = v4_set1(0.0f);
+   nonzero = v4_cmpneq(len, zero);
+   len     = v4_sqrt(len);
+
+   for (i = 0; i < 3; i++)
+      out[i] = v4_select(nonzero, v4_div(out[i], len), out[i]);
+
+   v4_scatter(vtx, offsetof(struct SPVertex, nx), out[0], out[1], out[2], pad);
+}
+
+void LightVertex4(struct SPVertex *vtx, const struct SPLight *lights, uint32_t numLights)
+{
+   v4sf nx, ny, nz, pad, r, g, b, a, zero, one;
+   uint32_t l;
+
+   v4_gather(vtx, offsetof(struct SPVertex, nx), &nx, &ny, &nz, &pad);
+   v4_gather(vtx, offsetof(struct SPVertex, r), &r, &g, &b, &a);
+
+   zero = v4_set1(0.0f);
+   one  = v4_set1(1.0f);
+   r    = v4_set1(lights[numLights].r);
+   g    = v4_set1(lights[numLights].g);
+   b    = v4_set1(lights[numLights].b);
+
+   for (l = 0; l < numLights; l++)
+   {
+      v4sf intensity = v4_add(v4_add(
+               v4_mul(nx, v4_set1(lights[l].x)),
+               v4_mul(ny, v4_set1(lights[l].y))),
+               v4_mul(nz, v4_set1(lights[l].z)));
+      intensity = v4_select(v4_cmplt(intensity, zero), zero, intensity);
+      r = v4_add(r, v4_mul(v4_set1(lights[l].r), intensity));
+      g = v4_add(g, v4_mul(v4_set1(lights[l].g), intensity));
+      b = v4_add(b, v4_mul(v4_set1(lights[l].b), intensity));
+   }
+
+   r = v4_select(v4_cmplt(r, one), r, one);
+   g = v4_select(v4_cmplt(g, one), g, one);
+   b = v4_select(v4_cmplt(b, one), b, one);
+
+   v4_scatter(vtx, offsetof(struct SPVertex, r), r, g, b, a);
+   vtx[0].HWLight = vtx[1].HWLight = vtx[2].HWLight = vtx[3].HWLight = 0;
+}
+
+void PointLightVertex4(struct SPVertex *vtx, float vPos[3][4],
+      const struct SPLight *lights, uint32_t numLights)
+{
+   v4sf px, py, pz, r, g, b, a, zero, one;
+   uint32_t l;
+
+   v4_gather(vtx, offsetof(struct SPVertex, r), &r, &g, &b, &a);
+
+   px   = v4_load(vPos[0]);
+   py   = v4_load(vPos[1]);
+   pz   = v4_load(vPos[2]);
+   zero = v4_set1(0.0f);
+   one  = v4_set1(1.0f);
+   r    = v4_set1(lights[numLights].r);
+   g    = v4_set1(lights[numLights].g);
+   b    = v4_set1(lights[numLights].b);
+
+   for (l = 0; l < numLights; l++)
+   {
+      v4sf lx        = v4_sub(v4_set1(lights[l].posx), px);
+      v4sf ly        = v4_sub(v4_set1(lights[l].posy), py);
+      v4sf lz        = v4_sub(v4_set1(lights[l].posz), pz);
+      v4sf len2      = v4_add(v4_add(v4_mul(lx, lx), v4_mul(ly, ly)), v4_mul(lz, lz));
+      v4sf len       = v4_sqrt(len2);
+      v4sf at        = v4_add(v4_add(v4_set1(lights[l].ca),
+               v4_mul(v4_div(len, v4_set1(65535.0f)), v4_set1(lights[l].la))),
+               v4_mul(v4_div(len2, v4_set1(65535.0f)), v4_set1(lights[l].qa)));
+      v4sf intensity = v4_select(v4_cmpgt(at, zero), v4_div(one, at), zero);
+      v4mask lit     = v4_cmpgt(intensity, zero);
+
+      r = v4_select(lit, v4_add(r, v4_mul(v4_set1(lights[l].r), intensity)), r);
+      g = v4_select(lit, v4_add(g, v4_mul(v4_set1(lights[l].g), intensity)), g);
+      b = v4_select(lit, v4_add(b, v4_mul(v4_set1(lights[l].b), intensity)), b);
+   }
+
+   r = v4_select(v4_cmpgt(r, one), one, r);
+   g = v4_select(v4_cmpgt(g, one), one, g);
+   b = v4_select(v4_cmpgt(b, one), one, b);
+
+   v4_scatter(vtx, offsetof(struct SPVertex, r), r, g, b, a);
+   vtx[0].HWLight = vtx[1].HWLight = vtx[2].HWLight = vtx[3].HWLight = 0;
+}
+
+void ClipVertex4(struct SPVertex *vtx)
+{
+   v4sf x, y, z, w, negw;
+   int posx, negx, posy, negy, clipz, i;
+
+   v4_gather(vtx, offsetof(struct SPVertex, x), &x, &y, &z, &w);
+
+   negw  = v4_sub(v4_set1(0.0f), w);
+   posx  = v4_movemask(v4_cmpgt(x, w));
+   negx  = v4_movemask(v4_cmplt(x, negw));
+   posy  = v4_movemask(v4_cmpgt(y, w));
+   negy  = v4_movemask(v4_cmplt(y, negw));
+   clipz = v4_movemask(v4_cmplt(w, v4_set1(0.01f)));
+
+   for (i = 0; i < 4; i++)
+      vtx[i].clip = ((posx  >> i) & 1 ? CLIP4_POSX : 0)
+                  | ((negx  >> i) & 1 ? CLIP4_NEGX : 0)
+                  | ((posy  >> i) & 1 ? CLIP4_POSY : 0)
+                  | ((negy  >> i) & 1 ? CLIP4_NEGY : 0)
+                  | ((clipz >> i) & 1 ? CLIP4_Z    : 0);
+}
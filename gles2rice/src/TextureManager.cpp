@@ -27,53 +27,29 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 CTextureManager gTextureManager;
 
-unsigned int g_maxTextureMemUsage = (5*1024*1024);
-unsigned int g_amountToFree = (512*1024);
-bool g_bUseSetTextureMem = false;
+static const uint32_t dwFramesToKill = 5*30;          // 5 secs at 30 fps
+static const uint32_t dwFramesToDelete = 30*30;       // 30 secs at 30 fps
+static const uint32_t dwMaxEvictPerPurge = 32;        // Spread big purges across several frames
+static const uint32_t dwMaxEvictPerCreate = 8;
+static const uint32_t dwBudgetOnly = 0xFFFFFFFF;      // Minimum age which only lets the budget evict
 
-// Returns the first prime greater than or equal to nFirst
-inline int GetNextPrime(int nFirst)
+static inline uint32_t SizeClass(uint32_t dwSize)
 {
-   int nCurrent = nFirst;
-
-   // Just make sure it's odd
-   if ((nCurrent % 2) == 0)
-      nCurrent++;
-
-   for (;;)
-   {
-      // nSqrtCurrent = nCurrent^0.5 + 1 (round up)
-      int nSqrtCurrent  = (int)sqrt((double)nCurrent) + 1;
-      bool bIsComposite = false;
-
-      // Test all odd numbers from 3..nSqrtCurrent
-      for (int i = 3; i <= nSqrtCurrent; i+=2)
-      {
-         if ((nCurrent % i) == 0)
-         {
-            bIsComposite = true;
-            break;
-         }
-      }
-
-      if (!bIsComposite)
-         return nCurrent;
-
-      // Select next odd candidate...
-      nCurrent += 2;
-   }
+    uint32_t c = 0;
+    while ((1u << c) < dwSize)
+        c++;
+    return c;
 }
 
 ///////////////////////////////////////////////////////////////////////
 //
 ///////////////////////////////////////////////////////////////////////
 CTextureManager::CTextureManager() :
-    m_pHead(NULL),
     m_pCacheTxtrList(NULL),
-    m_numOfCachedTxtrList(809)
+    m_numOfCachedTxtrList(1024),
+    m_numOfCachedTxtr(0),
+    m_dwTrimClass(0)
 {
-    m_numOfCachedTxtrList = GetNextPrime(800);
-
     m_currentTextureMemUsage    = 0;
     m_pYoungestTexture          = NULL;
     m_pOldestTexture            = NULL;
@@ -83,6 +59,9 @@ CTextureManager::CTextureManager() :
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
         m_pCacheTxtrList[i] = NULL;
 
+    memset(m_pRecycledHead, 0, sizeof(m_pRecycledHead));
+    memset(m_pRecycledTail, 0, sizeof(m_pRecycledTail));
+
     memset(&m_blackTextureEntry, 0, sizeof(TxtrCacheEntry));
     memset(&m_PrimColorTextureEntry, 0, sizeof(TxtrCacheEntry));
     memset(&m_EnvColorTextureEntry, 0, sizeof(TxtrCacheEntry));
@@ -95,7 +74,7 @@ CTextureManager::~CTextureManager()
     CleanUp();
 
     delete []m_pCacheTxtrList;
-    m_pCacheTxtrList = NULL;    
+    m_pCacheTxtrList = NULL;
 }
 
 
@@ -104,18 +83,22 @@ bool CTextureManager::CleanUp()
 {
     RecycleAllTextures();
 
-    if (!g_bUseSetTextureMem)
+    for (uint32_t w = 0; w < TXTR_SIZE_CLASSES; w++)
     {
-        while (m_pHead)
+        for (uint32_t h = 0; h < TXTR_SIZE_CLASSES; h++)
         {
-            TxtrCacheEntry * pVictim = m_pHead;
-            m_pHead = pVictim->pNext;
+            while (m_pRecycledHead[w][h])
+            {
+                TxtrCacheEntry * pVictim = m_pRecycledHead[w][h];
+                m_pRecycledHead[w][h] = pVictim->pNextYoungest;
 
-            delete pVictim;
+                DeleteCacheEntry(pVictim);
+            }
+            m_pRecycledTail[w][h] = NULL;
         }
     }
 
-    if( m_blackTextureEntry.pTexture )      delete m_blackTextureEntry.pTexture;    
+    if( m_blackTextureEntry.pTexture )      delete m_blackTextureEntry.pTexture;
     if( m_PrimColorTextureEntry.pTexture )  delete m_PrimColorTextureEntry.pTexture;
     if( m_EnvColorTextureEntry.pTexture )   delete m_EnvColorTextureEntry.pTexture;
     if( m_LODFracTextureEntry.pTexture )    delete m_LODFracTextureEntry.pTexture;
@@ -140,89 +123,123 @@ bool CTextureManager::TCacheEntryIsLoaded(TxtrCacheEntry *pEntry)
     return false;
 }
 
-// Purge any textures whos last usage was over 5 seconds ago
-void CTextureManager::PurgeOldTextures()
+// Free the entry and the texture it owns, and take it off the budget
+void CTextureManager::DeleteCacheEntry(TxtrCacheEntry *pEntry)
 {
-    if (m_pCacheTxtrList == NULL)
-        return;
-    
-    if (g_bUseSetTextureMem)
-        return;
+    m_currentTextureMemUsage -= pEntry->dwMemUsage;
 
-    static const uint32_t dwFramesToKill = 5*30;          // 5 secs at 30 fps
-    static const uint32_t dwFramesToDelete = 30*30;       // 30 secs at 30 fps
-    
-    for ( uint32_t i = 0; i < m_numOfCachedTxtrList; i++ )
+    if (pEntry->pTexture)
+        delete pEntry->pTexture;
+    pEntry->pTexture = NULL;
+
+    delete pEntry;
+}
+
+bool CTextureManager::IsOverBudget(uint32_t dwExtra)
+{
+    if (options.textureCacheSize == 0)
+        return false;
+
+    return m_currentTextureMemUsage + dwExtra > options.textureCacheSize*1024*1024;
+}
+
+// Move the oldest textures to the recycle pool, at most dwMaxCount of them.
+// A texture goes once it is older than dwMinAge frames, or earlier while the cache
+// is over budget. Textures used in the current frame are never touched.
+uint32_t CTextureManager::RetireOldTextures(uint32_t dwMaxCount, uint32_t dwMinAge, uint32_t dwExtra)
+{
+    uint32_t dwCount = 0;
+
+    while (dwCount < dwMaxCount && m_pOldestTexture != NULL)
     {
-        TxtrCacheEntry * pEntry;
-        TxtrCacheEntry * pNext;
-        
-        pEntry = m_pCacheTxtrList[i];
-        while (pEntry)
-        {
-            pNext = pEntry->pNext;
-            
-            if ( status.gDlistCount - pEntry->FrameLastUsed > dwFramesToKill && !TCacheEntryIsLoaded(pEntry))
-                RemoveTexture(pEntry);
-            pEntry = pNext;
-        }
+        TxtrCacheEntry *pEntry = m_pOldestTexture;
+        uint32_t dwAge = status.gDlistCount - pEntry->dwGeneration;
+
+        // The age list is sorted, nothing younger can go either
+        if (dwAge == 0)
+            break;
+        if (dwAge <= dwMinAge && !IsOverBudget(dwExtra))
+            break;
+        if (TCacheEntryIsLoaded(pEntry))
+            break;
+
+        RemoveTexture(pEntry);
+        dwCount++;
     }
-    
-    
-    // Remove any old textures that haven't been recycled in 1 minute or so
-    // Normally these would be reused
-    TxtrCacheEntry* pPrev = NULL;
-    TxtrCacheEntry* pCurr = m_pHead;
-    TxtrCacheEntry * pNext;
 
-    while (pCurr)
+    return dwCount;
+}
+
+// Delete textures from the recycle pool, at most dwMaxCount of them.
+// Classes are visited round robin and the least recently recycled entry of
+// each class goes first.
+uint32_t CTextureManager::TrimRecyclePool(uint32_t dwMaxCount, uint32_t dwMinAge, uint32_t dwExtra)
+{
+    uint32_t dwCount = 0;
+    uint32_t dwIdle  = 0;
+
+    while (dwCount < dwMaxCount && dwIdle < TXTR_SIZE_CLASSES*TXTR_SIZE_CLASSES)
     {
-        pNext = pCurr->pNext;
-        
-        if ( status.gDlistCount - pCurr->FrameLastUsed > dwFramesToDelete && !TCacheEntryIsLoaded(pCurr) )
+        uint32_t w = m_dwTrimClass / TXTR_SIZE_CLASSES;
+        uint32_t h = m_dwTrimClass % TXTR_SIZE_CLASSES;
+        TxtrCacheEntry *pEntry = m_pRecycledTail[w][h];
+
+        if (pEntry != NULL &&
+            (status.gDlistCount - pEntry->dwGeneration > dwMinAge || IsOverBudget(dwExtra)))
         {
-            if (pPrev != NULL)
-               pPrev->pNext = pCurr->pNext;
+            m_pRecycledTail[w][h] = pEntry->pLastYoungest;
+            if (pEntry->pLastYoungest != NULL)
+                pEntry->pLastYoungest->pNextYoungest = NULL;
             else
-               m_pHead      = pCurr->pNext;
-            
-            delete pCurr;
-            pCurr = pNext;  
+                m_pRecycledHead[w][h] = NULL;
+
+            DeleteCacheEntry(pEntry);
+            dwCount++;
+            dwIdle = 0;
         }
         else
         {
-            pPrev = pCurr;
-            pCurr = pNext;
+            dwIdle++;
         }
+
+        m_dwTrimClass = (m_dwTrimClass + 1) % (TXTR_SIZE_CLASSES*TXTR_SIZE_CLASSES);
     }
+
+    return dwCount;
+}
+
+// Retire textures whose last usage was over 5 seconds ago, and free recycled
+// textures which have not been revived in 30 seconds. Only a bounded amount of
+// work is done per call, so a large purge is spread across several frames.
+void CTextureManager::PurgeOldTextures()
+{
+    if (m_pCacheTxtrList == NULL)
+        return;
+
+    RetireOldTextures(dwMaxEvictPerPurge, dwFramesToKill, 0);
+    TrimRecyclePool(dwMaxEvictPerPurge, dwFramesToDelete, 0);
 }
 
 void CTextureManager::RecycleAllTextures()
 {
     if (m_pCacheTxtrList == NULL)
         return;
-    
-    uint32_t dwCount = 0;
-    uint32_t dwTotalUses = 0;
-    
+
     m_pYoungestTexture          = NULL;
     m_pOldestTexture            = NULL;
 
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
     {
-        while (m_pCacheTxtrList[i])
+        if (m_pCacheTxtrList[i])
         {
             TxtrCacheEntry *pTVictim = m_pCacheTxtrList[i];
-            m_pCacheTxtrList[i] = pTVictim->pNext;
-            
-            dwTotalUses += pTVictim->dwUses;
-            dwCount++;
-            if (g_bUseSetTextureMem)
-                delete pTVictim;
-            else
-               RecycleTexture(pTVictim);
+            m_pCacheTxtrList[i] = NULL;
+
+            RecycleTexture(pTVictim);
         }
     }
+
+    m_numOfCachedTxtr = 0;
 }
 
 void CTextureManager::RecheckHiresForAllTextures()
@@ -232,98 +249,150 @@ void CTextureManager::RecheckHiresForAllTextures()
 
     for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
     {
-        while (m_pCacheTxtrList[i])
-        {
-            TxtrCacheEntry *pTVictim = m_pCacheTxtrList[i];
-            m_pCacheTxtrList[i] = pTVictim->pNext;
-            pTVictim->bExternalTxtrChecked = false;
-
-        }
+        if (m_pCacheTxtrList[i])
+            m_pCacheTxtrList[i]->bExternalTxtrChecked = false;
     }
 }
 
 
-// Add to the recycle list
+// Add to the recycle pool of its size class
 void CTextureManager::RecycleTexture(TxtrCacheEntry *pEntry)
 {
-   if (g_bUseSetTextureMem)
+   if (pEntry->pTexture == NULL)
+   {
+      DeleteCacheEntry(pEntry);
       return;
+   }
 
-   // Fix me, why I can not reuse the texture in OpenGL,
-   // how can I unload texture from video card memory for OpenGL
-   delete pEntry;
+   uint32_t w = SizeClass(pEntry->pTexture->m_dwCreatedTextureWidth);
+   uint32_t h = SizeClass(pEntry->pTexture->m_dwCreatedTextureHeight);
+
+   if (w >= TXTR_SIZE_CLASSES || h >= TXTR_SIZE_CLASSES)
+   {
+      DeleteCacheEntry(pEntry);
+      return;
+   }
+
+   if (pEntry->pEnhancedTexture)
+      free(pEntry->pEnhancedTexture);
+   pEntry->pEnhancedTexture = NULL;
+
+   pEntry->dwGeneration  = status.gDlistCount;
+   pEntry->pLastYoungest = NULL;
+   pEntry->pNextYoungest = m_pRecycledHead[w][h];
+   if (m_pRecycledHead[w][h] != NULL)
+      m_pRecycledHead[w][h]->pLastYoungest = pEntry;
+   else
+      m_pRecycledTail[w][h] = pEntry;
+   m_pRecycledHead[w][h] = pEntry;
 }
 
-// Search for a texture of the specified dimensions to recycle
+// Take a recycled texture of the same size class from the pool, this never allocates
 TxtrCacheEntry * CTextureManager::ReviveTexture( uint32_t width, uint32_t height )
 {
-    if (g_bUseSetTextureMem)
+    uint32_t w = SizeClass(width);
+    uint32_t h = SizeClass(height);
+
+    if (w >= TXTR_SIZE_CLASSES || h >= TXTR_SIZE_CLASSES)
         return NULL;
 
-    TxtrCacheEntry* pPrev = NULL;
-    TxtrCacheEntry* pCurr = m_pHead;
+    TxtrCacheEntry *pEntry = m_pRecycledHead[w][h];
+    if (pEntry == NULL)
+        return NULL;
 
-    while (pCurr)
-    {
-        if (pCurr->ti.WidthToCreate == width &&
-            pCurr->ti.HeightToCreate == height)
-        {
-            // Remove from list
-            if (pPrev != NULL) pPrev->pNext        = pCurr->pNext;
-            else               m_pHead = pCurr->pNext;
-            
-            return pCurr;
-        }
-        
-        pPrev = pCurr;
-        pCurr = pCurr->pNext;
-    }
-    
-    return NULL;
+    m_pRecycledHead[w][h] = pEntry->pNextYoungest;
+    if (pEntry->pNextYoungest != NULL)
+        pEntry->pNextYoungest->pLastYoungest = NULL;
+    else
+        m_pRecycledTail[w][h] = NULL;
+
+    // The created (power of 2) size is the same, only the requested size may differ
+    CTexture *pTexture = pEntry->pTexture;
+    pTexture->m_dwWidth  = width;
+    pTexture->m_dwHeight = height;
+    pTexture->m_fXScale  = (float)pTexture->m_dwCreatedTextureWidth/(float)width;
+    pTexture->m_fYScale  = (float)pTexture->m_dwCreatedTextureHeight/(float)height;
+    pTexture->m_bScaledS = false;
+    pTexture->m_bScaledT = false;
+
+    return pEntry;
 }
 
 
 uint32_t CTextureManager::Hash(uint32_t dwValue)
 {
     // Divide by four, because most textures will be on a 4 byte boundry, so bottom four
-    // bits are null
-    return (dwValue>>2) % m_numOfCachedTxtrList;
+    // bits are null. The multiply spreads neighbouring addresses over the whole table.
+    return ((dwValue>>2) * 2654435761u) & (m_numOfCachedTxtrList - 1);
 }
 
-void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
+// Double the index size and reinsert every entry, done while the load factor is above 1/2
+void CTextureManager::GrowIndex()
 {
-    if (!g_bUseSetTextureMem)
-        return;
+    TxtrCacheEntry **pOldList = m_pCacheTxtrList;
+    uint32_t dwOldSize = m_numOfCachedTxtrList;
 
-    if (pEntry == m_pYoungestTexture)
-        return;
+    m_numOfCachedTxtrList = dwOldSize * 2;
+    m_pCacheTxtrList = new TxtrCacheEntry *[m_numOfCachedTxtrList];
+
+    for (uint32_t i = 0; i < m_numOfCachedTxtrList; i++)
+        m_pCacheTxtrList[i] = NULL;
+
+    for (uint32_t i = 0; i < dwOldSize; i++)
+    {
+        if (pOldList[i] == NULL)
+            continue;
 
-    // if its the oldest, then change the oldest pointer
-    if (pEntry == m_pOldestTexture)
+        uint32_t dwKey = Hash(pOldList[i]->ti.Address);
+        while (m_pCacheTxtrList[dwKey])
+            dwKey = (dwKey + 1) & (m_numOfCachedTxtrList - 1);
+        m_pCacheTxtrList[dwKey] = pOldList[i];
+    }
+
+    delete []pOldList;
+}
+
+void CTextureManager::RemoveFromAgeList(TxtrCacheEntry *pEntry)
+{
+    if (pEntry->pNextYoungest != NULL)
+        pEntry->pNextYoungest->pLastYoungest = pEntry->pLastYoungest;
+    else if (m_pYoungestTexture == pEntry)
+        m_pYoungestTexture = pEntry->pLastYoungest;
+
+    if (pEntry->pLastYoungest != NULL)
+        pEntry->pLastYoungest->pNextYoungest = pEntry->pNextYoungest;
+    else if (m_pOldestTexture == pEntry)
         m_pOldestTexture = pEntry->pNextYoungest;
 
-    // if its a not a new texture, close the gap in the age list
-    // where pEntry use to reside
-    if (pEntry->pNextYoungest != NULL || pEntry->pLastYoungest != NULL)
+    pEntry->pNextYoungest = NULL;
+    pEntry->pLastYoungest = NULL;
+}
+
+// The age list only moves once per entry and frame, so textures used many
+// times in a frame don't pay for relinking on every lookup
+void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
+{
+    if (pEntry == m_pYoungestTexture)
     {
-        if (pEntry->pNextYoungest != NULL)
-        {
-            pEntry->pNextYoungest->pLastYoungest = pEntry->pLastYoungest;
-        }
-        if (pEntry->pLastYoungest != NULL)
-        {
-            pEntry->pLastYoungest->pNextYoungest = pEntry->pNextYoungest;
-        }
+        pEntry->dwGeneration = status.gDlistCount;
+        return;
     }
 
+    if (pEntry->dwGeneration == status.gDlistCount &&
+        (pEntry->pNextYoungest != NULL || pEntry->pLastYoungest != NULL))
+        return;
+
+    // close the gap in the age list where pEntry use to reside
+    RemoveFromAgeList(pEntry);
+
     // this texture is now the youngest, so place it on the end of the list
     if (m_pYoungestTexture != NULL)
         m_pYoungestTexture->pNextYoungest = pEntry;
 
-    pEntry->pNextYoungest = NULL;
     pEntry->pLastYoungest = m_pYoungestTexture;
+    pEntry->dwGeneration  = status.gDlistCount;
     m_pYoungestTexture = pEntry;
-     
+
     // if this is the first texture in memory then its also the oldest
     if (m_pOldestTexture == NULL)
     {
@@ -332,17 +401,19 @@ void CTextureManager::MakeTextureYoungest(TxtrCacheEntry *pEntry)
 }
 
 void CTextureManager::AddTexture(TxtrCacheEntry *pEntry)
-{   
-    uint32_t dwKey = Hash(pEntry->ti.Address);
-    
+{
     if (m_pCacheTxtrList == NULL)
         return;
-    
-    //TxtrCacheEntry **p = &m_pCacheTxtrList[dwKey];
-    
-    // Add to head (not tail, for speed - new textures are more likely to be accessed next)
-    pEntry->pNext = m_pCacheTxtrList[dwKey];
+
+    if ((m_numOfCachedTxtr + 1) * 2 > m_numOfCachedTxtrList)
+        GrowIndex();
+
+    uint32_t dwKey = Hash(pEntry->ti.Address);
+    while (m_pCacheTxtrList[dwKey])
+        dwKey = (dwKey + 1) & (m_numOfCachedTxtrList - 1);
+
     m_pCacheTxtrList[dwKey] = pEntry;
+    m_numOfCachedTxtr++;
 
     // Move the texture to the top of the age list
     MakeTextureYoungest(pEntry);
@@ -353,20 +424,22 @@ void CTextureManager::AddTexture(TxtrCacheEntry *pEntry)
 TxtrCacheEntry * CTextureManager::GetTxtrCacheEntry(TxtrInfo * pti)
 {
     TxtrCacheEntry *pEntry;
-    
+
     if (m_pCacheTxtrList == NULL)
         return NULL;
-    
+
     // See if it is already in the hash table
     uint32_t dwKey = Hash(pti->Address);
 
-    for (pEntry = m_pCacheTxtrList[dwKey]; pEntry; pEntry = pEntry->pNext)
+    for (pEntry = m_pCacheTxtrList[dwKey]; pEntry; pEntry = m_pCacheTxtrList[dwKey])
     {
         if ( pEntry->ti == *pti )
         {
             MakeTextureYoungest(pEntry);
             return pEntry;
         }
+
+        dwKey = (dwKey + 1) & (m_numOfCachedTxtrList - 1);
     }
 
     return NULL;
@@ -379,77 +452,59 @@ void CTextureManager::RemoveTexture(TxtrCacheEntry * pEntry)
     if (m_pCacheTxtrList == NULL)
         return;
 
-    // See if it is already in the hash table
-    uint32_t dwKey = Hash(pEntry->ti.Address);
-
-    TxtrCacheEntry* pPrev = NULL;
-    TxtrCacheEntry* pCurr = m_pCacheTxtrList[dwKey];
+    uint32_t dwMask = m_numOfCachedTxtrList - 1;
+    uint32_t i = Hash(pEntry->ti.Address);
 
-    while (pCurr)
-    {
-        // Check that the attributes match
-        if ( pCurr->ti == pEntry->ti )
-        {
-            if (pPrev != NULL) 
-                pPrev->pNext = pCurr->pNext;
-            else
-               m_pCacheTxtrList[dwKey] = pCurr->pNext;
+    while (m_pCacheTxtrList[i] && m_pCacheTxtrList[i] != pEntry)
+        i = (i + 1) & dwMask;
 
-            if (g_bUseSetTextureMem)
-            {
-                // remove the texture from the age list
-                if (pEntry->pNextYoungest != NULL)
-                    pEntry->pNextYoungest->pLastYoungest = pEntry->pLastYoungest;
-                if (pEntry->pLastYoungest != NULL)
-                    pEntry->pLastYoungest->pNextYoungest = pEntry->pNextYoungest;
-
-                // decrease the mem usage counter
-                m_currentTextureMemUsage -= (pEntry->pTexture->m_dwWidth * pEntry->pTexture->m_dwHeight * 4);
-            
-                delete pEntry;
-            }
-            else
-                RecycleTexture(pEntry);
+    if (m_pCacheTxtrList[i] == NULL)
+        return;
 
+    // Backward shift deletion, keeps every probe sequence unbroken without tombstones
+    uint32_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & dwMask;
+        if (m_pCacheTxtrList[j] == NULL)
             break;
-        }
 
-        pPrev = pCurr;
-        pCurr = pCurr->pNext;
+        uint32_t k = Hash(m_pCacheTxtrList[j]->ti.Address);
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+            m_pCacheTxtrList[i] = m_pCacheTxtrList[j];
+            i = j;
+        }
     }
+    m_pCacheTxtrList[i] = NULL;
+    m_numOfCachedTxtr--;
+
+    RemoveFromAgeList(pEntry);
+    RecycleTexture(pEntry);
 }
-    
+
 TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t dwWidth, uint32_t dwHeight)
 {
-   TxtrCacheEntry * pEntry = NULL;
+   // Find a used texture
+   TxtrCacheEntry * pEntry = ReviveTexture(dwWidth, dwHeight);
 
-   if (g_bUseSetTextureMem)
+   if (pEntry == NULL)
    {
-      uint32_t widthToCreate = dwWidth;
-      uint32_t heightToCreate = dwHeight;
-      unsigned int freeUpSize = (widthToCreate * heightToCreate * 4) + g_amountToFree;
+      uint32_t dwMemUsage = (1u << SizeClass(dwWidth)) * (1u << SizeClass(dwHeight)) * 4;
 
-      // make sure there is enough room for the new texture by deleting old textures
-      while ((m_currentTextureMemUsage + freeUpSize) > g_maxTextureMemUsage && m_pOldestTexture != NULL)
+      // make sure there is enough room for the new texture by recycling old textures,
+      // a few at a time, and dropping recycled ones nobody revived
+      if (IsOverBudget(dwMemUsage))
       {
-         TxtrCacheEntry *nextYoungest = m_pOldestTexture->pNextYoungest;
-
-         RemoveTexture(m_pOldestTexture);
-
-         m_pOldestTexture = nextYoungest;
+         RetireOldTextures(dwMaxEvictPerCreate, dwBudgetOnly, dwMemUsage);
+         TrimRecyclePool(dwMaxEvictPerCreate, dwBudgetOnly, dwMemUsage);
 
-         //printf("Freeing Texture\n");
+         // A texture of this size class may just have been retired
+         pEntry = ReviveTexture(dwWidth, dwHeight);
       }
-
-      m_currentTextureMemUsage += widthToCreate * heightToCreate * 4;
-   }
-   else
-   {
-      // Find a used texture
-      pEntry = ReviveTexture(dwWidth, dwHeight);
    }
 
-   if (pEntry == NULL || g_bUseSetTextureMem)
+   if (pEntry == NULL)
    {
       // Couldn't find on - recreate!
       pEntry = new TxtrCacheEntry;
@@ -459,6 +514,7 @@ TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t
          return NULL;
       }
 
+      pEntry->dwMemUsage = 0;
       pEntry->pTexture = CDeviceBuilder::GetBuilder()->CreateTexture(dwWidth, dwHeight);
       if (pEntry->pTexture == NULL || pEntry->pTexture->GetTexture() == NULL)
       {
@@ -469,7 +525,11 @@ TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t
       {
          pEntry->pTexture->m_bScaledS = false;
          pEntry->pTexture->m_bScaledT = false;
+         pEntry->dwMemUsage = pEntry->pTexture->m_dwCreatedTextureWidth *
+            pEntry->pTexture->m_dwCreatedTextureHeight * pEntry->pTexture->GetPixelSize();
       }
+
+      m_currentTextureMemUsage += pEntry->dwMemUsage;
    }
 
    // Initialize
@@ -482,13 +542,14 @@ TxtrCacheEntry * CTextureManager::CreateNewCacheEntry(uint32_t dwAddr, uint32_t
    pEntry->dwCRC = 0;
    pEntry->FrameLastUsed = status.gDlistCount;
    pEntry->FrameLastUpdated = 0;
+   pEntry->dwGeneration = status.gDlistCount - 1;
    pEntry->lastEntry = NULL;
    pEntry->bExternalTxtrChecked = false;
    pEntry->maxCI = -1;
 
    // Add to the hash table
    AddTexture(pEntry);
-   return pEntry;  
+   return pEntry;
 }
 
 // If already in table, return
@@ -1173,41 +1234,17 @@ TxtrCacheEntry * CTextureManager::GetCachedTexture(uint32_t tex)
    {
       if( m_pCacheTxtrList[i] == NULL )
          continue;
-      else
-      {
-         TxtrCacheEntry *pEntry;
-
-         for (pEntry = m_pCacheTxtrList[i]; pEntry; pEntry = pEntry->pNext)
-         {
-            if( size == tex )
-               return pEntry;
-            else
-               size++;
-         }
-      }
+      if( size == tex )
+         return m_pCacheTxtrList[i];
+      size++;
    }
    return NULL;
 }
 
 uint32_t CTextureManager::GetNumOfCachedTexture()
 {
-   uint32_t size = 0;
-   for( uint32_t i=0; i<m_numOfCachedTxtrList; i++ )
-   {
-      if( m_pCacheTxtrList[i] == NULL )
-         continue;
-      else
-      {
-         TxtrCacheEntry *pEntry;
-
-         for (pEntry = m_pCacheTxtrList[i]; pEntry; pEntry = pEntry->pNext)
-         {
-            size++;
-         }
-      }
-   }
-   TRACE1("Totally %d texture cached", size);
-   return size;
+   TRACE1("Totally %d texture cached", m_numOfCachedTxtr);
+   return m_numOfCachedTxtr;
 }
 #endif
 
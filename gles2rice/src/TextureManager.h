@@ -33,6 +33,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define S_FLAG  0
 #define T_FLAG  1
 
+#define TXTR_SIZE_CLASSES   12      // Recycle pool size classes, 1 to 2048 texels per side
+
 class TxtrInfo
 {
 public:
@@ -142,7 +144,7 @@ typedef struct TxtrCacheEntry
     
     struct TxtrCacheEntry *pNext;       // Must be first element!
 
-    struct TxtrCacheEntry *pNextYoungest;
+    struct TxtrCacheEntry *pNextYoungest;   // Age list, or recycle pool list once recycled
     struct TxtrCacheEntry *pLastYoungest;
 
     TxtrInfo ti;
@@ -154,6 +156,8 @@ typedef struct TxtrCacheEntry
     uint32_t  dwTimeLastUsed; // timeGetTime of time of last usage
     uint32_t  FrameLastUsed;  // Frame # that this was last used
     uint32_t  FrameLastUpdated;
+    uint32_t  dwGeneration;   // Frame # in which the entry last moved in the age list
+    uint32_t  dwMemUsage;     // Bytes held by pTexture, counted against the cache budget
 
     CTexture    *pTexture;
     CTexture    *pEnhancedTexture;
@@ -203,8 +207,15 @@ protected:
         int arrayWidth, int flag, int mask, int mirror, int clamp, uint32_t otherSize);
 
     uint32_t Hash(uint32_t dwValue);
+    void GrowIndex();
     bool TCacheEntryIsLoaded(TxtrCacheEntry *pEntry);
 
+    void DeleteCacheEntry(TxtrCacheEntry *pEntry);
+    void RemoveFromAgeList(TxtrCacheEntry *pEntry);
+    bool IsOverBudget(uint32_t dwExtra);
+    uint32_t RetireOldTextures(uint32_t dwMaxCount, uint32_t dwMinAge, uint32_t dwExtra);
+    uint32_t TrimRecyclePool(uint32_t dwMaxCount, uint32_t dwMinAge, uint32_t dwExtra);
+
     void updateColorTexture(CTexture *ptexture, uint32_t color);
     
 public:
@@ -213,9 +224,17 @@ public:
     void Mirror(void *array, uint32_t width, uint32_t mask, uint32_t towidth, uint32_t arrayWidth, uint32_t rows, int flag, int size );
     
 protected:
-    TxtrCacheEntry * m_pHead;
+    // Open-addressing (linear probing) index keyed on the texture address,
+    // the table size is always a power of 2
     TxtrCacheEntry ** m_pCacheTxtrList;
     uint32_t m_numOfCachedTxtrList;
+    uint32_t m_numOfCachedTxtr;
+
+    // Recycled textures, pooled by size class (log2 of the created width and height).
+    // Each class is a list through pNextYoungest/pLastYoungest, most recently recycled first.
+    TxtrCacheEntry * m_pRecycledHead[TXTR_SIZE_CLASSES][TXTR_SIZE_CLASSES];
+    TxtrCacheEntry * m_pRecycledTail[TXTR_SIZE_CLASSES][TXTR_SIZE_CLASSES];
+    uint32_t m_dwTrimClass;
 
     TxtrCacheEntry m_blackTextureEntry;
     TxtrCacheEntry m_PrimColorTextureEntry;
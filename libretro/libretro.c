@@ -20,8 +20,12 @@
 #include "main/cheat.h"
 #include "main/version.h"
 #include "main/savestates.h"
+#include "main/trace.h"
 #include "dd/dd_disk.h"
 #include "pi/pi_controller.h"
+#include "main/device.h"
+#include "rsp/rsp_core.h"
+#include "rsp/rsp_profile.h"
 #include "si/pif.h"
 #include "libretro_memory.h"
 
@@ -90,12 +94,15 @@ static uint32_t game_size           = 0;
 static bool     emu_initialized     = false;
 static unsigned initial_boot        = true;
 static unsigned audio_buffer_size   = 2048;
+static bool     audio_thread        = false;
+static signed   old_rate_control    = -1;
 
 static unsigned retro_filtering     = 0;
 static unsigned retro_dithering     = 0;
 static bool     reinit_screen       = false;
 static bool     first_context_reset = false;
 static bool     pushed_frame        = false;
+static bool     can_dupe            = false;
 
 unsigned frame_dupe                 = false;
 
@@ -119,6 +126,10 @@ static bool initializing            = true;
 
 extern int g_vi_refresh_rate;
 
+#ifdef HAVE_THR_AL
+extern unsigned angrylion_frame_changed(void);
+#endif
+
 /* after the controller's CONTROL* member has been assigned we can update
  * them straight from here... */
 extern struct
@@ -288,6 +299,12 @@ static void setup_variables(void)
 #endif
       {"parallel-n64-audio-buffer-size",
          "Audio Buffer Size (restart); 2048|1024"},
+      {"parallel-n64-audio-rate-control",
+         "Audio Rate Control; enabled|disabled"},
+#ifdef HAVE_AUDIO_THREAD
+      {"parallel-n64-audio-thread",
+         "Audio Resampling on a Separate Thread (restart); disabled|enabled"},
+#endif
       {"parallel-n64-astick-deadzone",
         "Analog Deadzone (percent); 15|20|25|30|0|5|10"},
       {"parallel-n64-pak1",
@@ -339,6 +356,22 @@ static void setup_variables(void)
       { "parallel-n64-angrylion-vioverlay",
        "(Angrylion) VI Overlay; disabled|enabled"
       },
+#ifdef HAVE_THR_AL
+      { "parallel-n64-angrylion-async",
+       "(Angrylion) Asynchronous RDP (restart); disabled|enabled"
+      },
+#endif
+#ifdef HAVE_RSP_THREAD
+      { "parallel-n64-rsp-async",
+       "(LLE RSP) Audio tasks on a separate thread (restart); disabled|enabled"
+      },
+#endif
+      { "parallel-n64-rsp-profile",
+       "RSP Profiling (saves rsp-profile.json); disabled|enabled"
+      },
+      { "parallel-n64-trace",
+       "Timeline Tracing (saves trace.json); disabled|enabled"
+      },
       { "parallel-n64-virefresh",
          "VI Refresh (Overclock); auto|1500|2200" },
       { "parallel-n64-bufferswap",
@@ -529,7 +562,13 @@ bool emu_step_render(void)
       switch (gfx_plugin)
       {
          case GFX_ANGRYLION:
+#ifdef HAVE_THR_AL
+            /* only frontends that can dupe accept NULL for an unchanged frame */
+            video_cb((angrylion_frame_changed() || !can_dupe) ? blitter_buf_lock : NULL,
+                  screen_width, screen_height, screen_pitch);
+#else
             video_cb(blitter_buf_lock, screen_width, screen_height, screen_pitch);
+#endif
             break;
 
          case GFX_PARALLEL:
@@ -569,6 +608,17 @@ static void emu_step_initialize(void)
    core_settings_autoselect_gfx_plugin();
    core_settings_autoselect_rsp_plugin();
 
+#ifdef HAVE_RSP_THREAD
+   {
+      /* HLE audio is cheap enough, only LLE RSP plugins gain from it */
+      struct retro_variable rsp_async_var = { "parallel-n64-rsp-async", 0 };
+
+      environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &rsp_async_var);
+      rsp_set_async_tasks(rsp_plugin != RSP_HLE && rsp_async_var.value &&
+            !strcmp(rsp_async_var.value, "enabled"));
+   }
+#endif
+
    plugin_connect_all(gfx_plugin, rsp_plugin);
 
    if (log_cb)
@@ -862,6 +912,10 @@ void retro_init(void)
    uint64_t serialization_quirks = RETRO_SERIALIZATION_QUIRK_MUST_INITIALIZE;
 
    screen_pitch = 0;
+   old_rate_control = -1;
+
+   /* the emulation thread runs on the frontend's thread */
+   trace_thread_name("cpu");
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_LOG_INTERFACE, &log))
       log_cb = log.log;
@@ -876,6 +930,9 @@ void retro_init(void)
    environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &colorMode);
    environ_cb(RETRO_ENVIRONMENT_GET_RUMBLE_INTERFACE, &rumble);
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
+
    environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &serialization_quirks);
    initializing = true;
 
@@ -916,6 +973,7 @@ void retro_deinit(void)
 
    vulkan_inited     = false;
    gl_inited         = false;
+   old_rate_control  = -1;
 }
 
 #include "../mupen64plus-video-angrylion/vi.h"
@@ -926,6 +984,9 @@ extern void glide_set_filtering(unsigned value);
 extern void angrylion_set_vi(unsigned value);
 extern void angrylion_set_filtering(unsigned value);
 extern void angrylion_set_dithering(unsigned value);
+#ifdef HAVE_THR_AL
+extern void angrylion_set_async(unsigned value);
+#endif
 extern void parallel_set_dithering(unsigned value);
 extern void ChangeSize();
 
@@ -999,6 +1060,39 @@ static void gfx_set_dithering(void)
      }
 }
 
+static void get_save_path(char *path, size_t size, const char *name)
+{
+   const char *dir = NULL;
+   char slash;
+
+#if defined(_WIN32)
+   slash = '\\';
+#else
+   slash = '/';
+#endif
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) || !dir)
+      dir = ".";
+
+   snprintf(path, size, "%s%c%s", dir, slash, name);
+}
+
+static void write_rsp_profile(void)
+{
+   char path[1024];
+
+   get_save_path(path, sizeof(path), "rsp-profile.json");
+   rsp_profile_dump(path);
+}
+
+static void write_trace(void)
+{
+   char path[1024];
+
+   get_save_path(path, sizeof(path), "trace.json");
+   trace_dump(path);
+}
+
 void update_variables(bool startup)
 {
    struct retro_variable var;
@@ -1048,6 +1142,14 @@ void update_variables(bool startup)
       if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
          audio_buffer_size = atoi(var.value);
 
+#ifdef HAVE_AUDIO_THREAD
+      var.key = "parallel-n64-audio-thread";
+      var.value = NULL;
+
+      audio_thread = environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value &&
+         !strcmp(var.value, "enabled");
+#endif
+
       var.key = "parallel-n64-gfxplugin";
       var.value = NULL;
 
@@ -1096,6 +1198,67 @@ void update_variables(bool startup)
    else
       angrylion_set_vi(0);
 
+#ifdef HAVE_THR_AL
+   var.key = "parallel-n64-angrylion-async";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      angrylion_set_async(!strcmp(var.value, "enabled"));
+   else
+      angrylion_set_async(0);
+#endif
+
+   var.key = "parallel-n64-rsp-profile";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int profile = !strcmp(var.value, "enabled");
+
+      if (profile != rsp_profile_enabled())
+      {
+         /* an audio task may still be counting on the RSP thread */
+         rsp_wait_task(&g_dev.sp);
+         if (!profile)
+            write_rsp_profile();
+         rsp_profile_enable(profile);
+      }
+   }
+
+   var.key = "parallel-n64-trace";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int trace = !strcmp(var.value, "enabled");
+
+      if (trace != trace_enabled)
+      {
+         trace_enable(trace);
+         if (!trace)
+            write_trace();
+      }
+   }
+
+   var.key = "parallel-n64-audio-rate-control";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      signed rate_control = !strcmp(var.value, "enabled");
+
+      if (rate_control != old_rate_control)
+      {
+         struct retro_audio_buffer_status_callback buffer_status;
+
+         /* frontends without the callback leave the rate as it is */
+         buffer_status.callback = rate_control ? audio_buffer_status_libretro : NULL;
+         environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &buffer_status);
+         audio_buffer_status_libretro(false, 0, false);
+         old_rate_control = rate_control;
+      }
+   }
+
    CFG_HLE_GFX = (gfx_plugin != GFX_ANGRYLION) && (gfx_plugin != GFX_PARALLEL) ? 1 : 0;
    CFG_HLE_AUD = 0; /* There is no HLE audio code in libretro audio plugin. */
 
@@ -1326,7 +1489,7 @@ bool retro_load_game(const struct retro_game_info *game)
    update_variables(true);
    initial_boot = false;
 
-   init_audio_libretro(audio_buffer_size);
+   init_audio_libretro(audio_buffer_size, audio_thread);
 
    if (gfx_plugin != GFX_ANGRYLION)
    {
@@ -1409,6 +1572,18 @@ void retro_unload_game(void)
     co_switch(game_thread);
 #endif
 
+    if (rsp_profile_enabled())
+    {
+       rsp_wait_task(&g_dev.sp);
+       write_rsp_profile();
+    }
+
+    if (trace_enabled)
+    {
+       trace_enable(0);
+       write_trace();
+    }
+
     CoreDoCommand(M64CMD_ROM_CLOSE, 0, NULL);
     emu_initialized = false;
 }
@@ -1582,6 +1757,8 @@ void retro_run (void)
             break;
       }
    } while (emu_step_render());
+
+   audio_flush_libretro();
 }
 
 void retro_reset (void)
@@ -1008,6 +1008,26 @@ struct retro_hw_render_context_negotiation_interface
                                             * recognize or support. Should be set in either retro_init or retro_load_game, but not both.
                                             */
 
+#define RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK 62
+                                           /* const struct retro_audio_buffer_status_callback * --
+                                            * Lets the core know how occupied the audio buffer is when
+                                            * retro_run() starts. Passing NULL disables the callback.
+                                            * The frontend may not support this, in which case the call
+                                            * returns false.
+                                            */
+
+/* Notifies the core about the audio buffer state.
+ * 'active' is false when the frontend is not using the audio buffer (e.g. fast forward or audio disabled).
+ * 'occupancy' is the fill level in percent, 0 to 100.
+ * 'underrun_likely' is set when the frontend expects the buffer to run out soon.
+ */
+typedef void (RETRO_CALLCONV *retro_audio_buffer_status_callback_t)(
+      bool active, unsigned occupancy, bool underrun_likely);
+struct retro_audio_buffer_status_callback
+{
+   retro_audio_buffer_status_callback_t callback;
+};
+
 
 #define RETRO_MEMDESC_CONST     (1 << 0)   /* The frontend will never change this memory area once retro_load_game has returned. */
 #define RETRO_MEMDESC_BIGENDIAN (1 << 1)   /* The memory area contains big endian data. Default is little endian. */
@@ -65,6 +65,9 @@
 #include "../r4300/reset.h"
 #include "../rdp/rdp_core.h"
 #include "../rsp/rsp_core.h"
+#ifdef HAVE_RSP_THREAD
+#include "../rsp/rsp_thread.h"
+#endif
 #include "../ri/ri_controller.h"
 #include "../si/si_controller.h"
 #include "../vi/vi_controller.h"
@@ -261,6 +264,11 @@ void mupen_main_exit(void)
       destroy_debugger();
 #endif
 
+   rsp_wait_task(&g_dev.sp);
+#ifdef HAVE_RSP_THREAD
+   rsp_thread_close();
+#endif
+
    if (rsp.romClosed) rsp.romClosed();
    if (input.romClosed) input.romClosed();
    if (gfx.romClosed) gfx.romClosed();
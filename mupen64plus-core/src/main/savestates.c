@@ -46,6 +46,7 @@
 #include "../rdp/rdp_core.h"
 #include "../ri/ri_controller.h"
 #include "../rsp/rsp_core.h"
+#include "../rsp/rsp_imem.h"
 #include "../si/si_controller.h"
 #include "../vi/vi_controller.h"
 #include "osal/preproc.h"
@@ -82,6 +83,8 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    if(strncmp((char *)curr, savestate_magic, 8)!=0)
       return 0;
 
+   rsp_wait_task(&g_dev.sp);
+
    curr += 8;
 
    version = *curr++;
@@ -217,6 +220,7 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
 
    COPYARRAY(g_dev.ri.rdram.dram, curr, uint32_t, RDRAM_MAX_SIZE/4);
    COPYARRAY(g_dev.sp.mem, curr, uint32_t, SP_MEM_SIZE/4);
+   rsp_imem_written(0, 0x1000);
    COPYARRAY(g_dev.si.pif.ram, curr, uint8_t, PIF_RAM_SIZE);
 
    g_dev.pi.use_flashram = GETDATA(curr, int);
@@ -305,6 +309,8 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    if (!curr)
       return 0;
 
+   rsp_wait_task(&g_dev.sp);
+
    queuelength = save_eventqueue_infos(queue);
 
    // Write the save state data to memory
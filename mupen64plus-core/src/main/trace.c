@@ -0,0 +1,205 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - trace.c                                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* per thread, about 1 MB */
+#define TRACE_BUFFER_SIZE   0x10000
+
+#if defined(_MSC_VER)
+  #include <windows.h>
+  #define THREAD_LOCAL      __declspec(thread)
+  #define STORE_RELEASE(ptr, value)  (_WriteBarrier(), *(ptr) = (value))
+  #define LOAD_ACQUIRE(ptr) (*(volatile uint32_t*)(ptr))
+  #define PUSH_BUFFER(head, buf) \
+      (InterlockedCompareExchangePointer((PVOID volatile*)(head), (buf), (buf)->next) == (buf)->next)
+  #define NEXT_THREAD_ID()  InterlockedIncrement(&thread_ids)
+#else
+  #define THREAD_LOCAL      __thread
+  #define STORE_RELEASE(ptr, value)  __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+  #define LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+  #define PUSH_BUFFER(head, buf) \
+      __sync_bool_compare_and_swap(head, (buf)->next, buf)
+  #define NEXT_THREAD_ID()  __sync_add_and_fetch(&thread_ids, 1)
+#endif
+
+struct trace_entry
+{
+    int64_t start;
+    uint32_t duration;
+    uint32_t event;
+};
+
+/* written by its own thread only, head counts every entry ever recorded */
+struct trace_buffer
+{
+    struct trace_entry entries[TRACE_BUFFER_SIZE];
+    uint32_t head;
+    long thread_id;
+    const char* thread_name;
+    struct trace_buffer* next;
+};
+
+static const char* event_names[NUM_TRACE_EVENTS][2] =
+{
+    { "r4300", "cpu" },
+    { "recompile", "cpu" },
+    { "sp_gfx_task", "rsp" },
+    { "sp_audio_task", "rsp" },
+    { "sp_task", "rsp" },
+    { "vi_update", "vi" },
+    { "audio_push", "audio" },
+    { "rdp_update", "rdp" },
+    { "rdp_batch", "rdp" },
+    { "rdp_worker", "rdp" },
+};
+
+volatile int trace_enabled;
+
+static struct trace_buffer* volatile buffers;
+static volatile long thread_ids;
+static int64_t trace_start;
+
+static THREAD_LOCAL struct trace_buffer* thread_buffer;
+static THREAD_LOCAL const char* thread_name;
+
+#if defined(WIN32) && !defined(__MINGW32__)
+  int64_t trace_time(void)
+  {
+      static LARGE_INTEGER freq = { 0 };
+      LARGE_INTEGER counter;
+
+      if (freq.QuadPart == 0)
+          QueryPerformanceFrequency(&freq);
+      QueryPerformanceCounter(&counter);
+      return (int64_t)((double)counter.QuadPart * 1000000000.0 / freq.QuadPart);
+  }
+#else
+  #include <time.h>
+  int64_t trace_time(void)
+  {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+#endif
+
+static struct trace_buffer* create_buffer(void)
+{
+    struct trace_buffer* buf = (struct trace_buffer*)calloc(1, sizeof(*buf));
+
+    if (buf == NULL)
+        return NULL;
+
+    buf->thread_id = NEXT_THREAD_ID();
+    buf->thread_name = thread_name;
+
+    /* buffers are only ever added, and live as long as the process */
+    do
+        buf->next = buffers;
+    while (!PUSH_BUFFER(&buffers, buf));
+
+    return buf;
+}
+
+void trace_record(enum trace_event event, int64_t start)
+{
+    struct trace_buffer* buf = thread_buffer;
+    struct trace_entry* entry;
+    int64_t duration = trace_time() - start;
+
+    if (buf == NULL)
+    {
+        buf = thread_buffer = create_buffer();
+        if (buf == NULL)
+            return;
+    }
+
+    entry = &buf->entries[buf->head & (TRACE_BUFFER_SIZE - 1)];
+    entry->start = start;
+    entry->duration = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    entry->event = event;
+
+    STORE_RELEASE(&buf->head, buf->head + 1);
+}
+
+void trace_thread_name(const char* name)
+{
+    thread_name = name;
+    if (thread_buffer)
+        thread_buffer->thread_name = name;
+}
+
+void trace_enable(int enable)
+{
+    if (enable && !trace_enabled)
+        trace_start = trace_time();
+
+    trace_enabled = enable;
+}
+
+int trace_dump(const char* path)
+{
+    struct trace_buffer* buf;
+    int first = 1;
+    FILE* f;
+
+    f = fopen(path, "w");
+    if (f == NULL)
+        return 0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (buf = buffers; buf != NULL; buf = buf->next)
+    {
+        uint32_t head = LOAD_ACQUIRE(&buf->head);
+        uint32_t count = head < TRACE_BUFFER_SIZE ? head : TRACE_BUFFER_SIZE;
+        uint32_t i;
+
+        if (buf->thread_name)
+        {
+            fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,"
+                "\"args\":{\"name\":\"%s\"}}", first ? "" : ",", buf->thread_id, buf->thread_name);
+            first = 0;
+        }
+
+        for (i = head - count; i != head; i++)
+        {
+            const struct trace_entry* entry = &buf->entries[i & (TRACE_BUFFER_SIZE - 1)];
+
+            /* left over from an earlier recording */
+            if (entry->start < trace_start)
+                continue;
+
+            fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%ld,"
+                "\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",",
+                event_names[entry->event][0], event_names[entry->event][1], buf->thread_id,
+                (entry->start - trace_start) / 1000.0, entry->duration / 1000.0);
+            first = 0;
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return 1;
+}
@@ -0,0 +1,74 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - trace.h                                                 *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_MAIN_TRACE_H
+#define M64P_MAIN_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Timeline of what the emulator threads spend their time on, exported in
+ * the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+ *
+ * Every thread appends to its own ring buffer, so recording takes no lock.
+ * While tracing is off, trace_begin is a single load and trace_end a test
+ * of its result. */
+enum trace_event
+{
+    TRACE_R4300,
+    TRACE_RECOMPILE,
+    TRACE_SP_GFX_TASK,
+    TRACE_SP_AUDIO_TASK,
+    TRACE_SP_TASK,
+    TRACE_VI_UPDATE,
+    TRACE_AUDIO_PUSH,
+    TRACE_RDP_UPDATE,
+    TRACE_RDP_BATCH,
+    TRACE_RDP_WORKER,
+    NUM_TRACE_EVENTS
+};
+
+extern volatile int trace_enabled;
+
+int64_t trace_time(void);
+void trace_record(enum trace_event event, int64_t start);
+
+#define trace_begin() (trace_enabled ? trace_time() : 0)
+#define trace_end(event, start) \
+    do { if (start) trace_record(event, start); } while (0)
+
+/* shown in the timeline for the calling thread, must be a literal */
+void trace_thread_name(const char* name);
+
+void trace_enable(int enable);
+
+/* Writes everything recorded since tracing was last enabled, returns 0 on
+ * failure.  Threads still recording may tear the records they overwrite,
+ * so disable tracing first. */
+int trace_dump(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
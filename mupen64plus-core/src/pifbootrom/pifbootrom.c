@@ -33,6 +33,7 @@
 #include "r4300/r4300.h"
 #include "r4300/r4300_core.h"
 #include "rsp/rsp_core.h"
+#include "rsp/rsp_imem.h"
 #include "si/si_controller.h"
 #include "vi/vi_controller.h"
 #include "main/rom.h"
@@ -121,6 +122,7 @@ void pifbootrom_hle_execute(struct device *dev)
     dev->sp.mem[0x1014/4] = 0x3c0dbfc0;
     dev->sp.mem[0x1018/4] = 0x8da80024;
     dev->sp.mem[0x101c/4] = 0x3c0bb000;
+    rsp_imem_written(0, 0x20);
 
     /* required by CIC x105 */
     reg[11] = INT64_C(0xffffffffa4000040); /* t3 */
@@ -22,9 +22,15 @@
 #include "api/m64p_types.h"
 #include "api/libretro.h"
 #include "ai/ai_controller.h"
+#include "audio_plugin.h"
+#include "audio_resample.h"
+#ifdef HAVE_AUDIO_THREAD
+#include "audio_thread.h"
+#endif
 #include "main/main.h"
 #include "main/device.h"
 #include "main/rom.h"
+#include "main/trace.h"
 #include "plugin/plugin.h"
 #include "ri/ri_controller.h"
 #include "vi/vi_controller.h"
@@ -36,58 +42,70 @@
 #include <string.h>
 #include <stdarg.h>
 
-#include <audio/conversion/float_to_s16.h>
-#include <audio/conversion/s16_to_float.h>
-#include <audio/audio_resampler.h>
-
 extern retro_audio_sample_batch_t audio_batch_cb;
 
 static unsigned MAX_AUDIO_FRAMES = 2048;
 
 #define VI_INTR_TIME 500000
 
+#define OUTPUT_FREQ 44100
+
+/* largest change of the output rate used to keep the frontend's buffer half
+ * full, like the dynamic rate control of RetroArch */
+#define RATE_CONTROL_DELTA 0.005
+
 /* Read header for type definition */
 static int GameFreq = 33600;
 static unsigned CountsPerSecond;
 static unsigned BytesPerSecond;
 static unsigned CountsPerByte;
 
-static const retro_resampler_t *resampler;
-static void *resampler_audio_data;
-static float *audio_in_buffer_float;
-static float *audio_out_buffer_float;
+static struct audio_resample resample;
 static int16_t *audio_out_buffer_s16;
 
-void (*audio_convert_s16_to_float_arm)(float *out,
-      const int16_t *in, size_t samples, float gain);
-void (*audio_convert_float_to_s16_arm)(int16_t *out,
-      const float *in, size_t samples);
+/* last state reported by the frontend, occupancy in percent */
+static bool audio_buffer_active;
+static unsigned audio_buffer_occupancy;
+
+#ifdef HAVE_AUDIO_THREAD
+/* resampling happens on the audio thread, retro_run delivers the frames */
+static bool audio_async;
+#endif
 
 void deinit_audio_libretro(void)
 {
-   if (resampler && resampler_audio_data)
-   {
-      resampler->free(resampler_audio_data);
-      resampler = NULL;
-      resampler_audio_data = NULL;
-      free(audio_in_buffer_float);
-      free(audio_out_buffer_float);
-      free(audio_out_buffer_s16);
-   }
+#ifdef HAVE_AUDIO_THREAD
+   audio_thread_close();
+#endif
+   free(audio_out_buffer_s16);
+   audio_out_buffer_s16 = NULL;
 }
 
-void init_audio_libretro(unsigned max_audio_frames)
+void init_audio_libretro(unsigned max_audio_frames, bool threaded)
 {
-   retro_resampler_realloc(&resampler_audio_data, &resampler, "sinc", 1.0);
+#ifdef HAVE_AUDIO_THREAD
+   audio_thread_close();
+   audio_async = threaded;
+#endif
 
    MAX_AUDIO_FRAMES = max_audio_frames;
 
-   audio_in_buffer_float  = malloc(2 * MAX_AUDIO_FRAMES * sizeof(float));
-   audio_out_buffer_float = malloc(2 * MAX_AUDIO_FRAMES * sizeof(float));
-   audio_out_buffer_s16   = malloc(2 * MAX_AUDIO_FRAMES * sizeof(int16_t));
+   free(audio_out_buffer_s16);
+   audio_out_buffer_s16 = malloc(2 * MAX_AUDIO_FRAMES * sizeof(int16_t));
+
+   memset(&resample, 0, sizeof(resample));
+   audio_resample_init(&resample, GameFreq, OUTPUT_FREQ);
+
+#ifdef HAVE_AUDIO_THREAD
+   if (audio_async)
+      audio_thread_start(&resample);
+#endif
+}
 
-   convert_s16_to_float_init_simd();
-   convert_float_to_s16_init_simd();
+void audio_buffer_status_libretro(bool active, unsigned occupancy, bool underrun_likely)
+{
+   audio_buffer_active    = active;
+   audio_buffer_occupancy = occupancy;
 }
 
 static void aiDacrateChanged(void *user_data, unsigned int frequency, unsigned int bits)
@@ -97,6 +115,17 @@ static void aiDacrateChanged(void *user_data, unsigned int frequency, unsigned i
    CountsPerSecond = VI_INTR_TIME * 60 /* TODO/FIXME - dehardcode */;
    CountsPerByte   = CountsPerSecond / BytesPerSecond;
 
+   /* games may set the same rate over and over */
+   if (resample.in_rate != frequency)
+   {
+#ifdef HAVE_AUDIO_THREAD
+      /* the thread still owns the resampler until it runs dry */
+      if (audio_async)
+         audio_thread_wait();
+#endif
+      audio_resample_init(&resample, frequency, OUTPUT_FREQ);
+   }
+
 #if 0
    printf("CountsPerByte: %d, GameFreq: %d\n", CountsPerByte, GameFreq);
 #endif
@@ -120,61 +149,59 @@ void set_audio_format_via_libretro(void* user_data,
    ai->regs[AI_DACRATE_REG] = saved_ai_dacrate;
 }
 
-static void aiLenChanged(void* user_data, const void* buffer, size_t size)
+static void batch_frames(const int16_t *out, size_t out_frames)
 {
-   size_t max_frames, remain_frames;
-   uint32_t i;
-   double ratio;
-   struct resampler_data data = {0};
-   int16_t *out      = NULL;
-   int16_t *raw_data = (int16_t*)buffer;
-   size_t frames     = size / 4;
-   uint8_t *p        = (uint8_t*)buffer;
-
-   for (i = 0; i < size; i += 4)
+   while (out_frames)
    {
-      p[i ] ^= p[i + 2];
-      p[i + 2] ^= p[i ];
-      p[i ] ^= p[i + 2];
-      p[i + 1] ^= p[i + 3];
-      p[i + 3] ^= p[i + 1];
-      p[i + 1] ^= p[i + 3];
+      size_t ret  = audio_batch_cb(out, out_frames);
+      out_frames -= ret;
+      out        += ret * 2;
    }
+}
 
-audio_batch:
-   out               = NULL;
-   ratio             = 44100.0 / GameFreq;
-   max_frames        = (GameFreq > 44100) ? MAX_AUDIO_FRAMES : (size_t)(MAX_AUDIO_FRAMES / ratio - 1);
-   remain_frames     = 0;
+/* Hands the frames the audio thread finished so far to the frontend, they
+ * trail the emulation by up to one call of retro_run. */
+void audio_flush_libretro(void)
+{
+#ifdef HAVE_AUDIO_THREAD
+   size_t out_frames;
 
-   if (frames > max_frames)
-   {
-      remain_frames = frames - max_frames;
-      frames = max_frames;
-   }
+   if (!audio_async)
+      return;
 
-   data.data_in      = audio_in_buffer_float;
-   data.data_out     = audio_out_buffer_float;
-   data.input_frames = frames;
-   data.ratio        = ratio;
+   while ((out_frames = audio_thread_read(audio_out_buffer_s16, MAX_AUDIO_FRAMES)))
+      batch_frames(audio_out_buffer_s16, out_frames);
+#endif
+}
 
-   convert_s16_to_float(audio_in_buffer_float, raw_data, frames * 2, 1.0f);
-   resampler->process(resampler_audio_data, &data);
-   convert_float_to_s16(audio_out_buffer_s16, audio_out_buffer_float, data.output_frames * 2);
+static void aiLenChanged(void* user_data, const void* buffer, size_t size)
+{
+   const uint32_t *in = (const uint32_t*)buffer;
+   size_t frames      = size / 4;
+   double adjust      = 1.0;
 
-   out                    = audio_out_buffer_s16;
+   if (audio_buffer_active)
+      adjust += RATE_CONTROL_DELTA * (1.0 - audio_buffer_occupancy / 50.0);
 
-   while (data.output_frames)
+#ifdef HAVE_AUDIO_THREAD
+   if (audio_async)
    {
-      size_t ret          = audio_batch_cb(out, data.output_frames);
-      data.output_frames -= ret;
-      out                += ret * 2;
+      audio_thread_push(in, frames, adjust);
+      return;
    }
-   if (remain_frames)
+#endif
+
+   audio_resample_adjust(&resample, adjust);
+
+   while (frames)
    {
-      raw_data = raw_data + frames * 2;
-      frames   = remain_frames;
-      goto audio_batch;
+      size_t read         = frames;
+      size_t out_frames   = audio_resample(&resample, audio_out_buffer_s16, MAX_AUDIO_FRAMES, in, &read);
+
+      in     += read;
+      frames -= read;
+
+      batch_frames(audio_out_buffer_s16, out_frames);
    }
 }
 
@@ -184,6 +211,7 @@ void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t
    struct ai_controller* ai = (struct ai_controller*)user_data;
    uint32_t saved_ai_length = ai->regs[AI_LEN_REG];
    uint32_t saved_ai_dram = ai->regs[AI_DRAM_ADDR_REG];
+   int64_t start = trace_begin();
 
    /* notify plugin of new samples to play.
     * Exploit the fact that buffer points in ai->ri->rdram.dram to retrieve dram_addr_reg value */
@@ -191,6 +219,7 @@ void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t
    ai->regs[AI_LEN_REG] = size;
 
    aiLenChanged(user_data, buffer, size);
+   trace_end(TRACE_AUDIO_PUSH, start);
 
    /* restore original registers vlaues */
    ai->regs[AI_LEN_REG]       = saved_ai_length;
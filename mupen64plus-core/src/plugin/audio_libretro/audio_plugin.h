@@ -23,8 +23,15 @@
 #define M64P_PLUGIN_EMULATE_SPEAKER_VIA_LIBRETRO_H
 
 #include <stddef.h>
+#include <boolean.h>
 
-void init_audio_libretro(unsigned max_frames);
+void init_audio_libretro(unsigned max_frames, bool threaded);
 void deinit_audio_libretro(void);
 
+/* delivers what the audio thread resampled, once per retro_run */
+void audio_flush_libretro(void);
+
+/* retro_audio_buffer_status_callback_t, steers the output rate */
+void audio_buffer_status_libretro(bool active, unsigned occupancy, bool underrun_likely);
+
 #endif
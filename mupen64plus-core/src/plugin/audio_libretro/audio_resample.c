@@ -0,0 +1,267 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_resample.c                                        *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "audio_resample.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TAPS            AUDIO_RESAMPLE_TAPS
+#define PHASES          AUDIO_RESAMPLE_PHASES
+
+/* 8.24 time, rounded to the nearest phase */
+#define TIME_BITS       24
+#define TIME_ONE        (1u << TIME_BITS)
+#define PHASE_SHIFT     (TIME_BITS - AUDIO_RESAMPLE_PHASE_BITS)
+
+#define COEFF_BITS      14
+
+/* same filter as the libretro sinc resampler at the quality the core used
+ * to build it with, SINC_LOWER_QUALITY */
+#define CUTOFF          0.98
+
+static double sinc(double x)
+{
+    return x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+}
+
+static void init_coeffs(struct audio_resample* rs, double cutoff)
+{
+    unsigned phase, tap;
+
+    for (phase = 0; phase <= PHASES; phase++)
+    {
+        double values[TAPS];
+        double sum = 0.0;
+
+        /* distance of the output to the input frame that is tap frames old */
+        for (tap = 0; tap < TAPS; tap++)
+        {
+            double x = tap + (double)phase / PHASES - TAPS / 2;
+
+            /* Lanczos window */
+            values[tap] = cutoff * sinc(x * cutoff) * sinc(x / (TAPS / 2));
+            sum += values[tap];
+        }
+
+        /* unity gain for DC in every phase */
+        for (tap = 0; tap < TAPS; tap++)
+            rs->coeffs[phase][tap] = (int16_t)floor(values[tap] / sum * (1 << COEFF_BITS) + 0.5);
+    }
+}
+
+void audio_resample_init(struct audio_resample* rs, unsigned in_rate, unsigned out_rate)
+{
+    double cutoff = CUTOFF;
+
+    /* downsampling has to cut off below the output's Nyquist frequency */
+    if (out_rate < in_rate)
+        cutoff *= (double)out_rate / in_rate;
+
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+
+    init_coeffs(rs, cutoff);
+    audio_resample_adjust(rs, 1.0);
+}
+
+void audio_resample_adjust(struct audio_resample* rs, double adjust)
+{
+    rs->step = (uint32_t)(TIME_ONE * (double)rs->in_rate / (rs->out_rate * adjust) + 0.5);
+}
+
+static const int16_t* phase_coeffs(const struct audio_resample* rs, uint32_t time)
+{
+    return rs->coeffs[(time + (1u << (PHASE_SHIFT - 1))) >> PHASE_SHIFT];
+}
+
+/* The history is kept in a register while resampling where the host has
+ * SIMD, so that shifting in a frame doesn't take a trip through memory. */
+#if defined(__SSE2__)
+typedef __m128i history_t;
+
+static history_t load_history(const int16_t* history)
+{
+    return _mm_loadu_si128((const __m128i*)history);
+}
+
+static void store_history(int16_t* history, const history_t* h)
+{
+    _mm_storeu_si128((__m128i*)history, *h);
+}
+
+static void push_sample(history_t* h, int16_t sample)
+{
+    *h = _mm_insert_epi16(_mm_slli_si128(*h, 2), (uint16_t)sample, 0);
+}
+
+static uint32_t filter_frame(const history_t* history_l, const history_t* history_r, const int16_t* coeffs)
+{
+    __m128i c = _mm_loadu_si128((const __m128i*)coeffs);
+    __m128i l = _mm_madd_epi16(*history_l, c);
+    __m128i r = _mm_madd_epi16(*history_r, c);
+    __m128i sum;
+
+    /* horizontal sums, { l, r } in the low dwords */
+    sum = _mm_add_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (COEFF_BITS - 1))), COEFF_BITS);
+
+    return _mm_cvtsi128_si32(_mm_packs_epi32(sum, sum));
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+typedef int16x8_t history_t;
+
+static history_t load_history(const int16_t* history)
+{
+    return vld1q_s16(history);
+}
+
+static void store_history(int16_t* history, const history_t* h)
+{
+    vst1q_s16(history, *h);
+}
+
+static void push_sample(history_t* h, int16_t sample)
+{
+    *h = vextq_s16(vdupq_n_s16(sample), *h, 7);
+}
+
+static uint32_t filter_frame(const history_t* history_l, const history_t* history_r, const int16_t* coeffs)
+{
+    int16x8_t l = *history_l, r = *history_r;
+    int16x8_t c = vld1q_s16(coeffs);
+    int32x4_t sum_l = vmlal_s16(vmull_s16(vget_low_s16(l), vget_low_s16(c)), vget_high_s16(l), vget_high_s16(c));
+    int32x4_t sum_r = vmlal_s16(vmull_s16(vget_low_s16(r), vget_low_s16(c)), vget_high_s16(r), vget_high_s16(c));
+    int32x2_t sum = vpadd_s32(vpadd_s32(vget_low_s32(sum_l), vget_high_s32(sum_l)),
+        vpadd_s32(vget_low_s32(sum_r), vget_high_s32(sum_r)));
+
+    return vget_lane_u32(vreinterpret_u32_s16(vqrshrn_n_s32(vcombine_s32(sum, sum), COEFF_BITS)), 0);
+}
+#else
+/* a ring stored twice, so that the taps starting at pos are contiguous */
+typedef struct
+{
+    int16_t s[2 * TAPS];
+    unsigned pos;
+} history_t;
+
+static history_t load_history(const int16_t* history)
+{
+    history_t h;
+
+    memcpy(h.s, history, TAPS * sizeof(int16_t));
+    memcpy(h.s + TAPS, history, TAPS * sizeof(int16_t));
+    h.pos = 0;
+    return h;
+}
+
+static void store_history(int16_t* history, const history_t* h)
+{
+    memcpy(history, h->s + h->pos, TAPS * sizeof(int16_t));
+}
+
+static void push_sample(history_t* h, int16_t sample)
+{
+    h->pos = (h->pos ? h->pos : TAPS) - 1;
+    h->s[h->pos] = h->s[h->pos + TAPS] = sample;
+}
+
+static uint16_t clamp_s16(int32_t value)
+{
+    value = (value + (1 << (COEFF_BITS - 1))) >> COEFF_BITS;
+
+    if (value > INT16_MAX)
+        return (uint16_t)INT16_MAX;
+    if (value < INT16_MIN)
+        return (uint16_t)INT16_MIN;
+    return (uint16_t)value;
+}
+
+/* left sample first in memory */
+static uint32_t filter_frame(const history_t* history_l, const history_t* history_r, const int16_t* coeffs)
+{
+    const int16_t* l = history_l->s + history_l->pos;
+    const int16_t* r = history_r->s + history_r->pos;
+    int32_t sum_l = 0, sum_r = 0;
+    uint16_t result[2];
+    uint32_t frame;
+    unsigned i;
+
+    for (i = 0; i < TAPS; i++)
+    {
+        sum_l += l[i] * coeffs[i];
+        sum_r += r[i] * coeffs[i];
+    }
+
+    result[0] = clamp_s16(sum_l);
+    result[1] = clamp_s16(sum_r);
+    memcpy(&frame, result, sizeof(frame));
+    return frame;
+}
+#endif
+
+size_t audio_resample(struct audio_resample* rs, int16_t* out, size_t out_frames,
+    const uint32_t* in, size_t* in_frames)
+{
+    history_t history_l = load_history(rs->history_l);
+    history_t history_r = load_history(rs->history_r);
+    size_t available = *in_frames;
+    size_t read = 0, written = 0;
+    uint32_t time = rs->time, step = rs->step;
+
+    while (written < out_frames)
+    {
+        uint32_t frame;
+
+        while (time >= TIME_ONE)
+        {
+            if (read == available)
+                goto done;
+
+            frame = in[read++];
+            push_sample(&history_l, (int16_t)(frame >> 16));
+            push_sample(&history_r, (int16_t)frame);
+            time -= TIME_ONE;
+        }
+
+        frame = filter_frame(&history_l, &history_r, phase_coeffs(rs, time));
+        memcpy(out + written * 2, &frame, sizeof(frame));
+        written++;
+        time += step;
+    }
+
+done:
+    store_history(rs->history_l, &history_l);
+    store_history(rs->history_r, &history_r);
+    rs->time = time;
+    *in_frames = read;
+    return written;
+}
@@ -0,0 +1,70 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_resample.h                                        *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_PLUGIN_AUDIO_RESAMPLE_H
+#define M64P_PLUGIN_AUDIO_RESAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Polyphase windowed sinc, TAPS input frames per output frame and the
+ * nearest of PHASES coefficient sets. */
+#define AUDIO_RESAMPLE_TAPS         8
+#define AUDIO_RESAMPLE_PHASE_BITS   10
+#define AUDIO_RESAMPLE_PHASES       (1 << AUDIO_RESAMPLE_PHASE_BITS)
+
+struct audio_resample
+{
+    /* Q14, the extra phase is the first one of the next input frame */
+    int16_t coeffs[AUDIO_RESAMPLE_PHASES + 1][AUDIO_RESAMPLE_TAPS];
+
+    /* newest frame first */
+    int16_t history_l[AUDIO_RESAMPLE_TAPS];
+    int16_t history_r[AUDIO_RESAMPLE_TAPS];
+
+    /* position between the two newest input frames, 8.24 */
+    uint32_t time;
+    uint32_t step;
+
+    unsigned in_rate;
+    unsigned out_rate;
+};
+
+/* Sets up the filter for a new input rate, keeping the current history. */
+void audio_resample_init(struct audio_resample* rs, unsigned in_rate, unsigned out_rate);
+
+/* Scales the output rate by adjust, used to steer the frontend's buffer. */
+void audio_resample_adjust(struct audio_resample* rs, double adjust);
+
+/* Converts AI samples as they are stored in RDRAM, one 32-bit word per
+ * frame with the left channel in the upper half, into interleaved s16.
+ * Stops when either side runs out, in_frames returns the frames read. */
+size_t audio_resample(struct audio_resample* rs, int16_t* out, size_t out_frames,
+    const uint32_t* in, size_t* in_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
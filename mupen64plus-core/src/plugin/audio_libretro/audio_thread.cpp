@@ -0,0 +1,195 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_thread.cpp                                        *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "audio_thread.h"
+#include "audio_resample.h"
+
+#include "main/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <string.h>
+
+/* frames, a power of two; a few video frames at any AI rate */
+#define RING_SIZE 0x2000
+#define RING_MASK (RING_SIZE - 1)
+
+/* Counters run freely and only one side stores each of them. */
+struct ring
+{
+    uint32_t data[RING_SIZE];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable signal_work;
+static std::condition_variable signal_done;
+
+static struct audio_resample* resampler;
+static std::atomic<double> rate_adjust;
+static bool busy;
+static bool exiting;
+
+/* AI words from the emulation, stereo s16 frames for retro_run */
+static struct ring input;
+static struct ring output;
+
+static void resample_input(void)
+{
+    size_t tail = input.tail.load(std::memory_order_relaxed);
+    size_t head = input.head.load(std::memory_order_acquire);
+
+    audio_resample_adjust(resampler, rate_adjust.load(std::memory_order_relaxed));
+
+    while (tail != head)
+    {
+        size_t out_head = output.head.load(std::memory_order_relaxed);
+        size_t space = RING_SIZE - (out_head - output.tail.load(std::memory_order_acquire));
+        size_t in_frames = std::min(head - tail, (size_t)RING_SIZE - (tail & RING_MASK));
+        size_t out_frames;
+
+        /* nobody is reading, blocking here could stall audio_thread_wait */
+        if (!space)
+        {
+            tail = head;
+            break;
+        }
+
+        out_frames = audio_resample(resampler, (int16_t*)&output.data[out_head & RING_MASK],
+            std::min(space, (size_t)RING_SIZE - (out_head & RING_MASK)),
+            &input.data[tail & RING_MASK], &in_frames);
+
+        output.head.store(out_head + out_frames, std::memory_order_release);
+
+        tail += in_frames;
+        input.tail.store(tail, std::memory_order_release);
+
+        head = input.head.load(std::memory_order_acquire);
+    }
+
+    input.tail.store(tail, std::memory_order_release);
+}
+
+static void audio_thread_main(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    trace_thread_name("audio");
+
+    for (;;)
+    {
+        signal_work.wait(lock, [] {
+            return exiting || input.head.load(std::memory_order_acquire) != input.tail.load(std::memory_order_relaxed);
+        });
+
+        if (exiting)
+            break;
+
+        busy = true;
+        lock.unlock();
+        resample_input();
+        lock.lock();
+
+        busy = false;
+        signal_done.notify_all();
+    }
+}
+
+static bool idle(void)
+{
+    return !busy && input.head.load(std::memory_order_acquire) == input.tail.load(std::memory_order_acquire);
+}
+
+void audio_thread_start(struct audio_resample* rs)
+{
+    audio_thread_close();
+
+    resampler = rs;
+    rate_adjust.store(1.0);
+    input.head = input.tail = 0;
+    output.head = output.tail = 0;
+
+    exiting = false;
+    thread = std::thread(audio_thread_main);
+}
+
+void audio_thread_push(const uint32_t* frames, size_t count, double adjust)
+{
+    size_t head = input.head.load(std::memory_order_relaxed);
+    size_t offset = head & RING_MASK;
+    size_t first;
+
+    /* never waits for the thread, the excess is dropped */
+    count = std::min(count, RING_SIZE - (head - input.tail.load(std::memory_order_acquire)));
+    first = std::min(count, (size_t)RING_SIZE - offset);
+
+    memcpy(&input.data[offset], frames, first * sizeof(uint32_t));
+    memcpy(&input.data[0], frames + first, (count - first) * sizeof(uint32_t));
+
+    rate_adjust.store(adjust, std::memory_order_relaxed);
+    input.head.store(head + count, std::memory_order_release);
+
+    /* taking the lock keeps the wakeup from slipping in before the wait */
+    std::lock_guard<std::mutex> lock(mutex);
+    signal_work.notify_one();
+}
+
+size_t audio_thread_read(int16_t* out, size_t max_frames)
+{
+    size_t tail = output.tail.load(std::memory_order_relaxed);
+    size_t offset = tail & RING_MASK;
+    size_t count = std::min(max_frames, output.head.load(std::memory_order_acquire) - tail);
+    size_t first = std::min(count, (size_t)RING_SIZE - offset);
+
+    memcpy(out, &output.data[offset], first * sizeof(uint32_t));
+    memcpy(out + first * 2, &output.data[0], (count - first) * sizeof(uint32_t));
+
+    output.tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+void audio_thread_wait(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (thread.joinable())
+        signal_done.wait(lock, idle);
+}
+
+void audio_thread_close(void)
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        signal_done.wait(lock, idle);
+        exiting = true;
+        signal_work.notify_one();
+    }
+
+    thread.join();
+}
@@ -0,0 +1,48 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - audio_thread.h                                          *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_PLUGIN_AUDIO_THREAD_H
+#define M64P_PLUGIN_AUDIO_THREAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct audio_resample;
+
+/* Host thread resampling AI buffers while the CPU carries on. Frames go in
+ * and out through single producer, single consumer rings: the emulation
+ * pushes AI words and retro_run reads the resampled frames, both from the
+ * frontend's thread. The resampler belongs to the thread until
+ * audio_thread_wait or audio_thread_close. */
+void audio_thread_start(struct audio_resample* rs);
+void audio_thread_push(const uint32_t* frames, size_t count, double adjust);
+size_t audio_thread_read(int16_t* out, size_t max_frames);
+void audio_thread_wait(void);
+void audio_thread_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -236,7 +236,7 @@ static m64p_error plugin_start_rsp(void)
    rsp_info.RDRAM = (unsigned char *) g_rdram;
    rsp_info.DMEM = (unsigned char *) g_dev.sp.mem;
    rsp_info.IMEM = (unsigned char *) g_dev.sp.mem + 0x1000;
-   rsp_info.MI_INTR_REG = &g_dev.r4300.mi.regs[MI_INTR_REG];
+   rsp_info.MI_INTR_REG = &g_dev.sp.mi_intr;
    rsp_info.SP_MEM_ADDR_REG = &g_dev.sp.regs[SP_MEM_ADDR_REG];
    rsp_info.SP_DRAM_ADDR_REG = &g_dev.sp.regs[SP_DRAM_ADDR_REG];
    rsp_info.SP_RD_LEN_REG = &g_dev.sp.regs[SP_RD_LEN_REG];
@@ -488,6 +488,10 @@ void genbne_idle()
 {
 }
 
+void genbne_poll()
+{
+}
+
 void genblez()
 {
 }
@@ -496,6 +500,10 @@ void genblez_idle()
 {
 }
 
+void genblez_poll()
+{
+}
+
 void genbgtz()
 {
 }
@@ -508,6 +516,10 @@ void genbgtz_idle()
 {
 }
 
+void genbgtz_poll()
+{
+}
+
 void genaddi()
 {
 }
@@ -552,6 +564,10 @@ void genbeql_idle()
 {
 }
 
+void genbeql_poll()
+{
+}
+
 void genbeq()
 {
 }
@@ -564,6 +580,10 @@ void genbeq_idle()
 {
 }
 
+void genbeq_poll()
+{
+}
+
 void genbnel()
 {
 }
@@ -576,6 +596,10 @@ void genbnel_idle()
 {
 }
 
+void genbnel_poll()
+{
+}
+
 void genblezl()
 {
 }
@@ -588,6 +612,10 @@ void genblezl_idle()
 {
 }
 
+void genblezl_poll()
+{
+}
+
 void genbgtzl()
 {
 }
@@ -600,6 +628,10 @@ void genbgtzl_idle()
 {
 }
 
+void genbgtzl_poll()
+{
+}
+
 void gendaddi()
 {
 }
@@ -730,6 +762,10 @@ void genbltz_idle()
 {
 }
 
+void genbltz_poll()
+{
+}
+
 void genbgez()
 {
 }
@@ -742,6 +778,10 @@ void genbgez_idle()
 {
 }
 
+void genbgez_poll()
+{
+}
+
 void genbltzl()
 {
 }
@@ -754,6 +794,10 @@ void genbltzl_idle()
 {
 }
 
+void genbltzl_poll()
+{
+}
+
 void genbgezl()
 {
 }
@@ -766,6 +810,10 @@ void genbgezl_idle()
 {
 }
 
+void genbgezl_poll()
+{
+}
+
 void genbltzal()
 {
 }
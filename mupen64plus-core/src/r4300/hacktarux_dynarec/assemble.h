@@ -896,6 +896,17 @@ static INLINE void and_m32rel_imm32(unsigned int *m32, unsigned int imm32)
    put32(imm32);
 }
 
+static INLINE void sub_m32rel_imm32(unsigned int *m32, unsigned int imm32)
+{
+   int offset = rel_r15_offset(m32, "sub_m32rel_imm32");
+
+   put8(0x41);
+   put8(0x81);
+   put8(0xAF);
+   put32(offset);
+   put32(imm32);
+}
+
 static INLINE void xor_reg32_reg32(unsigned int reg1, unsigned int reg2)
 {
    put8(0x31);
@@ -1407,6 +1407,40 @@ void gentest_idle(void)
    jump_end_rel32();
 }
 
+/* Taken polling loop branches count poll_spins down, poll_loop then
+ * checks the loop and may fast-forward Count. Registers must be free. */
+static void gentest_poll(struct precomp_instr *branch)
+{
+#ifdef __x86_64__
+   cmp_m32rel_imm32((unsigned int *)(&branch_taken), 0);
+   je_near_rj(0);
+   jump_start_rel32();
+
+   sub_m32rel_imm32((unsigned int *)(&poll_spins), 1);
+   jne_rj(0);
+   jump_start_rel8();
+
+   mov_reg64_imm64(RAX, (uint64_t) branch);
+   mov_m64rel_xreg64((uint64_t *)(&PC), RAX);
+   mov_reg64_imm64(RAX, (uint64_t) poll_loop);
+   call_reg64(RAX);
+
+   jump_end_rel8();
+#else
+   cmp_m32_imm32((unsigned int *)(&branch_taken), 0);
+   je_near_rj(0);
+
+   jump_start_rel32();
+
+   sub_m32_imm32((unsigned int *)(&poll_spins), 1);
+   jne_rj(17);
+   mov_m32_imm32((unsigned int*)(&PC), (unsigned int)(branch)); // 10
+   mov_reg32_imm32(EAX, (unsigned int)poll_loop); // 5
+   call_reg32(EAX); // 2
+#endif
+   jump_end_rel32();
+}
+
 void genbeq_idle(void)
 {
 #ifdef INTERPRET_BEQ_IDLE
@@ -1425,6 +1459,25 @@ void genbeq_idle(void)
 #endif
 }
 
+void genbeq_poll(void)
+{
+#ifdef INTERPRET_BEQ
+   gencallinterp((native_type)cached_interpreter_table.BEQ, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BEQ, 1);
+      return;
+   }
+
+   genbeq_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 void genbne(void)
 {
 #ifdef INTERPRET_BNE
@@ -1479,6 +1532,25 @@ void genbne_idle(void)
 #endif
 }
 
+void genbne_poll(void)
+{
+#ifdef INTERPRET_BNE
+   gencallinterp((native_type)cached_interpreter_table.BNE, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BNE, 1);
+      return;
+   }
+
+   genbne_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 void genblez(void)
 {
 #ifdef INTERPRET_BLEZ
@@ -1533,6 +1605,25 @@ void genblez_idle(void)
 #endif
 }
 
+void genblez_poll(void)
+{
+#ifdef INTERPRET_BLEZ
+   gencallinterp((native_type)cached_interpreter_table.BLEZ, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BLEZ, 1);
+      return;
+   }
+
+   genblez_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 void genbgtz(void)
 {
 #ifdef INTERPRET_BGTZ
@@ -1587,6 +1678,25 @@ void genbgtz_idle(void)
 #endif
 }
 
+void genbgtz_poll(void)
+{
+#ifdef INTERPRET_BGTZ
+   gencallinterp((native_type)cached_interpreter_table.BGTZ, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BGTZ, 1);
+      return;
+   }
+
+   genbgtz_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 void genaddi(void)
 {
 #ifdef INTERPRET_ADDI
@@ -1905,6 +2015,25 @@ void genbeql_idle(void)
 #endif
 }
 
+void genbeql_poll(void)
+{
+#ifdef INTERPRET_BEQL
+   gencallinterp((native_type)cached_interpreter_table.BEQL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BEQL, 1);
+      return;
+   }
+
+   genbeq_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 void genbnel(void)
 {
 #ifdef INTERPRET_BNEL
@@ -1959,6 +2088,25 @@ void genbnel_idle(void)
 #endif
 }
 
+void genbnel_poll(void)
+{
+#ifdef INTERPRET_BNEL
+   gencallinterp((native_type)cached_interpreter_table.BNEL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BNEL, 1);
+      return;
+   }
+
+   genbne_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 void genblezl(void)
 {
 #ifdef INTERPRET_BLEZL
@@ -2013,6 +2161,25 @@ void genblezl_idle(void)
 #endif
 }
 
+void genblezl_poll(void)
+{
+#ifdef INTERPRET_BLEZL
+   gencallinterp((native_type)cached_interpreter_table.BLEZL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BLEZL, 1);
+      return;
+   }
+
+   genblez_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 void genbgtzl(void)
 {
 #ifdef INTERPRET_BGTZL
@@ -2067,6 +2234,25 @@ void genbgtzl_idle(void)
 #endif
 }
 
+void genbgtzl_poll(void)
+{
+#ifdef INTERPRET_BGTZL
+   gencallinterp((native_type)cached_interpreter_table.BGTZL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BGTZL, 1);
+      return;
+   }
+
+   genbgtz_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 void gendaddi(void)
 {
 #ifdef INTERPRET_DADDI
@@ -5691,6 +5877,25 @@ void genbltz_idle(void)
 #endif
 }
 
+void genbltz_poll(void)
+{
+#ifdef INTERPRET_BLTZ
+   gencallinterp((native_type)cached_interpreter_table.BLTZ, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BLTZ, 1);
+      return;
+   }
+
+   genbltz_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 static void genbgez_test(void)
 {
    int rs_64bit = is64((unsigned int *)dst->f.i.rs);
@@ -5795,6 +6000,25 @@ void genbgez_idle(void)
 #endif
 }
 
+void genbgez_poll(void)
+{
+#ifdef INTERPRET_BGEZ
+   gencallinterp((native_type)cached_interpreter_table.BGEZ, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BGEZ, 1);
+      return;
+   }
+
+   genbgez_test();
+   gendelayslot();
+   gentest_poll(dst-1);
+   gentest();
+#endif
+}
+
 void genbltzl(void)
 {
 #ifdef INTERPRET_BLTZL
@@ -5849,6 +6073,25 @@ void genbltzl_idle(void)
 #endif
 }
 
+void genbltzl_poll(void)
+{
+#ifdef INTERPRET_BLTZL
+   gencallinterp((native_type)cached_interpreter_table.BLTZL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BLTZL, 1);
+      return;
+   }
+
+   genbltz_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 void genbgezl(void)
 {
 #ifdef INTERPRET_BGEZL
@@ -5903,6 +6146,25 @@ void genbgezl_idle(void)
 #endif
 }
 
+void genbgezl_poll(void)
+{
+#ifdef INTERPRET_BGEZL
+   gencallinterp((native_type)cached_interpreter_table.BGEZL, 1);
+#else
+   if (((dst->addr & 0xFFF) == 0xFFC && 
+            (dst->addr < 0x80000000 || dst->addr >= 0xC0000000))||no_compiled_jump)
+   {
+      gencallinterp((native_type)cached_interpreter_table.BGEZL, 1);
+      return;
+   }
+
+   genbgez_test();
+   free_all_registers();
+   gentest_poll(dst);
+   gentestl();
+#endif
+}
+
 static void genbranchlink(void)
 {
    int r31_64bit = is64((unsigned int*)&reg[31]);
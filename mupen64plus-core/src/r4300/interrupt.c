@@ -38,6 +38,7 @@
 #include "main/main.h"
 #include "main/device.h"
 #include "main/savestates.h"
+#include "main/trace.h"
 #include "mi_controller.h"
 #include "new_dynarec/new_dynarec.h"
 #include "pi/pi_controller.h"
@@ -503,7 +504,7 @@ static void nmi_int_handler(void)
 }
 
 
-void gen_interrupt(void)
+static void do_interrupt(void)
 {
    if (stop == 1)
    {
@@ -545,6 +546,8 @@ void gen_interrupt(void)
 
       case VI_INT:
          remove_interrupt_event();
+         /* no RSP task runs across frames */
+         rsp_wait_task(&g_dev.sp);
          vi_vertical_interrupt_event(&g_dev.vi);
          retro_return(false);
          break;
@@ -613,3 +616,14 @@ void gen_interrupt(void)
    }
 }
 
+/* r4300 execution is traced in batches, from one interrupt to the next */
+static int64_t r4300_batch;
+
+void gen_interrupt(void)
+{
+   trace_end(TRACE_R4300, r4300_batch);
+
+   do_interrupt();
+
+   r4300_batch = trace_begin();
+}
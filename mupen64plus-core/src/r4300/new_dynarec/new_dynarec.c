@@ -47,6 +47,7 @@ extern "C" {
 #endif
 #include "../../main/main.h"
 #include "../../main/device.h"
+#include "../../main/trace.h"
 #include "../../memory/memory.h"
 #include "../../rsp/rsp_core.h"
 #include "../cached_interp.h"
@@ -7842,7 +7843,7 @@ static void end_block(void *start)
   end_tcache_write(start, out);
 }
 
-int new_recompile_block(int addr)
+static int recompile_block_at(int addr)
 {
 /*
   if(addr==0x800cd050) {
@@ -11131,6 +11132,14 @@ int new_recompile_block(int addr)
   return 0;
 }
 
+int new_recompile_block(int addr)
+{
+  int64_t start=trace_begin();
+  int r=recompile_block_at(addr);
+  trace_end(TRACE_RECOMPILE,start);
+  return r;
+}
+
 void TLBWI_new(void)
 {
   unsigned int i;
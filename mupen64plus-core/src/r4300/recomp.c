@@ -44,6 +44,7 @@
 #include "main/main.h"
 #include "main/device.h"
 #include "main/profile.h"
+#include "main/trace.h"
 #include "memory/memory.h"
 #include "ops.h"
 #include "r4300.h"
@@ -123,6 +124,203 @@ static void recompile_standard_cf_type(void)
    dst->f.cf.fd = (src >>  6) & 0x1F;
 }
 
+//-------------------------------------------------------------------------
+//                              POLLING LOOPS
+//-------------------------------------------------------------------------
+
+/* A short backward branch that only loads, computes and compares spins
+ * until something outside the CPU changes what it reads. When all of it
+ * comes from RDRAM or status registers, nothing changes before the next
+ * interrupt event and the loop can skip there like an idle loop does. */
+#define POLL_LOOP_MAX_LENGTH  16
+#define POLL_LOOP_SPINS       32
+
+enum { POLL_OP_NONE, POLL_OP_ALU, POLL_OP_LOAD, POLL_OP_BRANCH };
+
+unsigned int poll_spins = POLL_LOOP_SPINS;
+
+/* Registers read and written by an instruction allowed in a polling loop,
+ * as masks. Anything with a side effect or reading Count is refused. */
+static int decode_poll_op(uint32_t op, uint32_t *read, uint32_t *written)
+{
+   uint32_t rs = UINT32_C(1) << ((op >> 21) & 0x1F);
+   uint32_t rt = UINT32_C(1) << ((op >> 16) & 0x1F);
+   uint32_t rd = UINT32_C(1) << ((op >> 11) & 0x1F);
+
+   *read = 0;
+   *written = 0;
+
+   switch (op >> 26)
+   {
+      case 0x00:
+         switch (op & 0x3F)
+         {
+            case 0x00: case 0x02: case 0x03: /* SLL, SRL, SRA */
+            case 0x38: case 0x3A: case 0x3B: /* DSLL, DSRL, DSRA */
+            case 0x3C: case 0x3E: case 0x3F: /* DSLL32, DSRL32, DSRA32 */
+               *read = rt;
+               *written = rd;
+               return POLL_OP_ALU;
+            case 0x04: case 0x06: case 0x07: /* SLLV, SRLV, SRAV */
+            case 0x21: case 0x23: case 0x24: /* ADDU, SUBU, AND */
+            case 0x25: case 0x26: case 0x27: /* OR, XOR, NOR */
+            case 0x2A: case 0x2B:            /* SLT, SLTU */
+            case 0x2D: case 0x2F:            /* DADDU, DSUBU */
+               *read = rs | rt;
+               *written = rd;
+               return POLL_OP_ALU;
+            case 0x0F:                       /* SYNC */
+               return POLL_OP_ALU;
+         }
+         break;
+      case 0x01:                             /* BLTZ, BGEZ, BLTZL, BGEZL */
+         if (((op >> 16) & 0x1F) > 3)
+            break;
+         *read = rs;
+         return POLL_OP_BRANCH;
+      case 0x04: case 0x05:                  /* BEQ, BNE */
+      case 0x14: case 0x15:                  /* BEQL, BNEL */
+         *read = rs | rt;
+         return POLL_OP_BRANCH;
+      case 0x06: case 0x07:                  /* BLEZ, BGTZ */
+      case 0x16: case 0x17:                  /* BLEZL, BGTZL */
+         *read = rs;
+         return POLL_OP_BRANCH;
+      case 0x09: case 0x0A: case 0x0B:       /* ADDIU, SLTI, SLTIU */
+      case 0x0C: case 0x0D: case 0x0E:       /* ANDI, ORI, XORI */
+      case 0x19:                             /* DADDIU */
+         *read = rs;
+         *written = rt;
+         return POLL_OP_ALU;
+      case 0x0F:                             /* LUI */
+         *written = rt;
+         return POLL_OP_ALU;
+      case 0x20: case 0x21: case 0x23:       /* LB, LH, LW */
+      case 0x24: case 0x25: case 0x27:       /* LBU, LHU, LWU */
+      case 0x37:                             /* LD */
+         *read = rs;
+         *written = rt;
+         return POLL_OP_LOAD;
+   }
+
+   return POLL_OP_NONE;
+}
+
+/* code holds one pass through the loop, ending with the branch and its
+ * delay slot. Every pass must compute the same thing from the same memory,
+ * so a register read before the pass writes it may not be written anywhere
+ * in the loop. Load bases must be left alone after the load, poll_loop
+ * finds the addresses in them once the branch is taken. */
+static int is_poll_loop(const uint32_t *code, unsigned int length)
+{
+   uint32_t read[POLL_LOOP_MAX_LENGTH], written[POLL_LOOP_MAX_LENGTH];
+   int kind[POLL_LOOP_MAX_LENGTH];
+   uint32_t loop_written = 0, pass_written = 0, later_written = 0;
+   unsigned int i;
+
+   if (length < 2 || length > POLL_LOOP_MAX_LENGTH)
+      return 0;
+
+   for (i = 0; i < length; i++)
+   {
+      kind[i] = decode_poll_op(code[i], &read[i], &written[i]);
+
+      if (kind[i] == POLL_OP_NONE || (kind[i] == POLL_OP_BRANCH) != (i == length - 2))
+         return 0;
+
+      /* r0 is never written */
+      read[i] &= ~UINT32_C(1);
+      written[i] &= ~UINT32_C(1);
+      loop_written |= written[i];
+   }
+
+   for (i = 0; i < length; i++)
+   {
+      if (read[i] & ~pass_written & loop_written)
+         return 0;
+      pass_written |= written[i];
+   }
+
+   for (i = length; i-- > 0; )
+   {
+      later_written |= written[i];
+      if (kind[i] == POLL_OP_LOAD && (read[i] & later_written))
+         return 0;
+   }
+
+   return 1;
+}
+
+/* RDRAM and these registers only change when the CPU writes them or an
+ * interrupt event runs, SP tasks on the RSP thread included as SP_INT
+ * fences them. VI_CURRENT and AI_LEN follow Count and aren't listed. */
+static int is_event_driven(uint32_t address)
+{
+   /* TLB mapped loads may miss */
+   if ((address & UINT32_C(0xC0000000)) != UINT32_C(0x80000000))
+      return 0;
+
+   address &= UINT32_C(0x1FFFFFFC);
+
+   if (address < UINT32_C(0x00800000))
+      return 1;
+
+   switch (address)
+   {
+      case UINT32_C(0x04040010): /* SP_STATUS */
+      case UINT32_C(0x04040018): /* SP_DMA_BUSY */
+      case UINT32_C(0x0410000C): /* DPC_STATUS */
+      case UINT32_C(0x04300008): /* MI_INTR */
+      case UINT32_C(0x0450000C): /* AI_STATUS */
+      case UINT32_C(0x04600010): /* PI_STATUS */
+      case UINT32_C(0x04800018): /* SI_STATUS */
+         return 1;
+   }
+
+   return 0;
+}
+
+/* Backward branch closing a polling loop, only the dynarec counts them. */
+static int is_poll_branch(uint32_t target)
+{
+   uint32_t length = (dst->addr - target) / 4;
+
+   return r4300emu == CORE_DYNAREC && target < dst->addr &&
+      is_poll_loop(SRC - length, length + 2);
+}
+
+/* Called from the recompiled code with PC on the branch once polling loops
+ * have been taken POLL_LOOP_SPINS times. If this one only reads event
+ * driven state, Count skips to the next interrupt as in the idle loops. */
+void poll_loop(void)
+{
+   uint32_t start = PC->addr + 4 + PC->f.i.immediate * 4;
+   unsigned int length = (PC->addr - start) / 4 + 2;
+   const uint32_t *code;
+   unsigned int i;
+   int skip;
+
+   poll_spins = POLL_LOOP_SPINS;
+
+   /* the code is checked again as it is in memory now */
+   code = fast_mem_access(start);
+   if (code == NULL || !is_poll_loop(code, length))
+      return;
+
+   for (i = 0; i < length; i++)
+   {
+      uint32_t read, written;
+
+      if (decode_poll_op(code[i], &read, &written) == POLL_OP_LOAD &&
+            !is_event_driven((uint32_t)reg[(code[i] >> 21) & 0x1F] + (int16_t)code[i]))
+         return;
+   }
+
+   skip = next_interrupt - g_cp0_regs[CP0_COUNT_REG];
+   if (skip > 3)
+      g_cp0_regs[CP0_COUNT_REG] += skip & UINT32_C(0xFFFFFFFC);
+}
+
 //-------------------------------------------------------------------------
 //                                  SPECIAL                                
 //-------------------------------------------------------------------------
@@ -556,6 +754,10 @@ static void RBLTZ(void)
       dst->ops = current_instruction_table.BLTZ_OUT;
       recomp_func = genbltz_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbltz_poll;
+   }
 }
 
 static void RBGEZ(void)
@@ -578,6 +780,10 @@ static void RBGEZ(void)
       dst->ops = current_instruction_table.BGEZ_OUT;
       recomp_func = genbgez_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbgez_poll;
+   }
 }
 
 static void RBLTZL(void)
@@ -600,6 +806,10 @@ static void RBLTZL(void)
       dst->ops = current_instruction_table.BLTZL_OUT;
       recomp_func = genbltzl_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbltzl_poll;
+   }
 }
 
 static void RBGEZL(void)
@@ -622,6 +832,10 @@ static void RBGEZL(void)
       dst->ops = current_instruction_table.BGEZL_OUT;
       recomp_func = genbgezl_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbgezl_poll;
+   }
 }
 
 static void RTGEI(void)
@@ -1683,6 +1897,10 @@ static void RBEQ(void)
       dst->ops = current_instruction_table.BEQ_OUT;
       recomp_func = genbeq_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbeq_poll;
+   }
 }
 
 static void RBNE(void)
@@ -1705,6 +1923,10 @@ static void RBNE(void)
       dst->ops = current_instruction_table.BNE_OUT;
       recomp_func = genbne_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbne_poll;
+   }
 }
 
 static void RBLEZ(void)
@@ -1727,6 +1949,10 @@ static void RBLEZ(void)
       dst->ops = current_instruction_table.BLEZ_OUT;
       recomp_func = genblez_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genblez_poll;
+   }
 }
 
 static void RBGTZ(void)
@@ -1749,6 +1975,10 @@ static void RBGTZ(void)
       dst->ops = current_instruction_table.BGTZ_OUT;
       recomp_func = genbgtz_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbgtz_poll;
+   }
 }
 
 static void RADDI(void)
@@ -1845,6 +2075,10 @@ static void RBEQL(void)
       dst->ops = current_instruction_table.BEQL_OUT;
       recomp_func = genbeql_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbeql_poll;
+   }
 }
 
 static void RBNEL(void)
@@ -1867,6 +2101,10 @@ static void RBNEL(void)
       dst->ops = current_instruction_table.BNEL_OUT;
       recomp_func = genbnel_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbnel_poll;
+   }
 }
 
 static void RBLEZL(void)
@@ -1889,6 +2127,10 @@ static void RBLEZL(void)
       dst->ops = current_instruction_table.BLEZL_OUT;
       recomp_func = genblezl_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genblezl_poll;
+   }
 }
 
 static void RBGTZL(void)
@@ -1911,6 +2153,10 @@ static void RBGTZL(void)
       dst->ops = current_instruction_table.BGTZL_OUT;
       recomp_func = genbgtzl_out;
    }
+   else if (is_poll_branch(target))
+   {
+      recomp_func = genbgtzl_poll;
+   }
 }
 
 static void RDADDI(void)
@@ -2339,6 +2585,7 @@ void recompile_block(const uint32_t *source, struct precomp_block *block, uint32
 {
    uint32_t i;
    int length, finished=0;
+   int64_t trace_start = trace_begin();
    timed_section_start(TIMED_SECTION_COMPILER);
    length = (block->end-block->start)/4;
    dst_block = block;
@@ -2437,6 +2684,7 @@ void recompile_block(const uint32_t *source, struct precomp_block *block, uint32
    DebugMessage(M64MSG_INFO, "block recompiled (%" PRIX32 "-%" PRIX32 ")", func, block->start+i*4);
 #endif
    timed_section_end(TIMED_SECTION_COMPILER);
+   trace_end(TRACE_RECOMPILE, trace_start);
 }
 
 static int is_jump(void)
@@ -45,6 +45,10 @@ extern struct precomp_instr *dst; /* precomp_instr structure for instruction bei
 
 extern int no_compiled_jump;
 
+/* taken polling loop branches left before poll_loop checks one */
+extern unsigned int poll_spins;
+void poll_loop(void);
+
 #ifdef DYNAREC
 #include "hacktarux_dynarec/assemble.h"
 #endif
@@ -284,6 +284,18 @@ void gentest_out(void);
 void gentest_idle(void);
 void gentestl(void);
 void gentestl_out(void);
+void genbeq_poll(void);
+void genbne_poll(void);
+void genblez_poll(void);
+void genbgtz_poll(void);
+void genbeql_poll(void);
+void genbnel_poll(void);
+void genblezl_poll(void);
+void genbgtzl_poll(void);
+void genbltz_poll(void);
+void genbgez_poll(void);
+void genbltzl_poll(void);
+void genbgezl_poll(void);
 void gencheck_cop1_unusable(void);
 void genll(void);
 
@@ -29,6 +29,10 @@
 
 #include <string.h>
 
+#ifdef HAVE_THR_AL
+extern unsigned angrylion_async_active(void);
+#endif
+
 void poweron_fb(struct fb* fb)
 {
     memset(fb, 0, sizeof(*fb));
@@ -111,6 +115,16 @@ void protect_framebuffers(struct rdp_core* dp)
     if (fb->infos[0].addr)
     {
        size_t i;
+       int async = 0;
+
+#ifdef HAVE_THR_AL
+       /* only the asynchronous angrylion RDP needs FBRead to wait for it,
+        * other plugins would copy their framebuffer back on CPU reads */
+       async = angrylion_async_active();
+       if (async)
+          memset(fb->dirty_page, 0, sizeof(fb->dirty_page));
+#endif
+
        for(i = 0; i < FB_INFOS_COUNT; ++i)
        {
           if (fb->infos[i].addr)
@@ -132,15 +146,24 @@ void protect_framebuffers(struct rdp_core* dp)
                 map_region(0xa000+j, M64P_MEM_RDRAM, RW(rdramFB));
              }
 
-             start <<= 4;
-             end   <<= 4;
-
-             for (j=start; j<=end; j++)
+             if (async)
              {
-                if (j >= start1 && j <= end1)
+                /* dirty_page is indexed by 4 KB page, the regions above by 64 KB */
+                for (j = start1 >> 12; j <= (end1 >> 12) && j < FB_DIRTY_PAGES_COUNT; j++)
                    fb->dirty_page[j] = 1;
-                else
-                   fb->dirty_page[j] = 0;
+             }
+             else
+             {
+                start <<= 4;
+                end   <<= 4;
+
+                for (j=start; j<=end; j++)
+                {
+                   if (j >= start1 && j <= end1)
+                      fb->dirty_page[j] = 1;
+                   else
+                      fb->dirty_page[j] = 0;
+                }
              }
 
              /* disable "fast memory" if framebuffer handlers are used */
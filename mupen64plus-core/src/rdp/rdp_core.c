@@ -23,11 +23,18 @@
 
 #include "../memory/memory.h"
 #include "../plugin/plugin.h"
+#include "../r4300/cp0.h"
+#include "../r4300/interrupt.h"
 #include "../r4300/r4300_core.h"
 #include "../rsp/rsp_core.h"
 
 #include <string.h>
 
+#ifdef HAVE_THR_AL
+extern unsigned angrylion_dp_sync_pending(void);
+extern void angrylion_dp_sync_wait(void);
+#endif
+
 static int update_dpc_status(struct rdp_core* dp, uint32_t w)
 {
    /* see do_SP_Task for more info */
@@ -112,6 +119,19 @@ int write_dpc_regs(void* opaque, uint32_t address, uint32_t value, uint32_t mask
          break;
       case DPC_END_REG:
          gfx.processRDPList();
+#ifdef HAVE_THR_AL
+         /* the asynchronous RDP thread may not have run the full sync yet,
+          * the interrupt event waits for it */
+         if (angrylion_dp_sync_pending())
+         {
+            if (!get_event(DP_INT))
+            {
+               cp0_update_count();
+               add_interrupt_event(DP_INT, 4000);
+            }
+            break;
+         }
+#endif
          signal_rcp_interrupt(dp->r4300, MI_INTR_DP);
          break;
    }
@@ -142,5 +162,8 @@ int write_dps_regs(void* opaque, uint32_t address, uint32_t value, uint32_t mask
 
 void rdp_interrupt_event(struct rdp_core* dp)
 {
+#ifdef HAVE_THR_AL
+   angrylion_dp_sync_wait();
+#endif
    raise_rcp_interrupt(dp->r4300, MI_INTR_DP);
 }
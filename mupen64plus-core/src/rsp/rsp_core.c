@@ -20,19 +20,58 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include "rsp_core.h"
+#include "rsp_imem.h"
+#include "rsp_profile.h"
 
 #include "main/main.h"
 #include "main/profile.h"
 #include "main/rom.h"
+#include "main/trace.h"
 #include "memory/memory.h"
 #include "plugin/plugin.h"
 #include "r4300/r4300_core.h"
 #include "../rdp/rdp_core.h"
 #include "../ri/ri_controller.h"
 
+#ifdef HAVE_RSP_THREAD
+#include "rsp_thread.h"
+#endif
+
 #include <stdio.h>
 #include <string.h>
 
+/* Cycles the CPU may run ahead of an audio task on the RSP thread before it
+ * waits for the task to end, about the time such a task takes on hardware. */
+#define RSP_ASYNC_TASK_DELAY 40000
+
+static unsigned async_tasks;
+
+/* IMEM blocks written since a plugin last asked, nothing is compiled yet */
+static uint32_t imem_written;
+
+void rsp_imem_written(uint32_t offset, uint32_t length)
+{
+    uint32_t first, last;
+
+    if (offset >= 0x1000 || !length)
+        return;
+
+    if (length > 0x1000 - offset)
+        length = 0x1000 - offset;
+
+    first = offset >> RSP_IMEM_BLOCK_SHIFT;
+    last  = (offset + length - 1) >> RSP_IMEM_BLOCK_SHIFT;
+
+    imem_written |= (2u << last) - (1u << first);
+}
+
+uint32_t rsp_imem_take_written(void)
+{
+    uint32_t written = imem_written;
+    imem_written = 0;
+    return written;
+}
+
 static void dma_sp_write(struct rsp_core* sp, unsigned length, unsigned count, unsigned skip)
 {
     unsigned int i,j;
@@ -42,6 +81,17 @@ static void dma_sp_write(struct rsp_core* sp, unsigned length, unsigned count, u
     unsigned char *spmem  = (unsigned char*)sp->mem + (sp->regs[SP_MEM_ADDR_REG] & 0x1000);
     unsigned char *dram   = (unsigned char*)sp->ri->rdram.dram;
 
+    /* a DMA into DMEM running past its end lands in IMEM as well */
+    unsigned int start    = sp->regs[SP_MEM_ADDR_REG] & 0x1fff;
+    unsigned int end      = start + length * count;
+
+    if (end > 0x1000)
+    {
+        if (start < 0x1000)
+            start = 0x1000;
+        rsp_imem_written(start - 0x1000, end - start);
+    }
+
     for(j = 0; j < count; j++)
     {
         for(i = 0; i < length; i++)
@@ -159,7 +209,10 @@ void init_rsp(struct rsp_core* sp,
 
 void poweron_rsp(struct rsp_core* sp)
 {
+    rsp_wait_task(sp);
+
     memset(sp->mem, 0, SP_MEM_SIZE);
+    rsp_imem_written(0, 0x1000);
     memset(sp->regs, 0, SP_REGS_COUNT*sizeof(uint32_t));
     memset(sp->regs2, 0, SP_REGS2_COUNT*sizeof(uint32_t));
 
@@ -173,6 +226,8 @@ int read_rsp_mem(void* opaque, uint32_t address, uint32_t* value)
     struct rsp_core* sp = (struct rsp_core*)opaque;
     uint32_t addr       = RSP_MEM_ADDR(address);
 
+    rsp_wait_task(sp);
+
     *value = sp->mem[addr];
 
     return 0;
@@ -183,8 +238,13 @@ int write_rsp_mem(void* opaque, uint32_t address, uint32_t value, uint32_t mask)
     struct rsp_core* sp = (struct rsp_core*)opaque;
     uint32_t addr       = RSP_MEM_ADDR(address);
 
+    rsp_wait_task(sp);
+
     sp->mem[addr] = MASKED_WRITE(&sp->mem[addr], value, mask);
 
+    if (addr >= 0x1000/4)
+        rsp_imem_written((addr << 2) - 0x1000, 4);
+
     return 0;
 }
 
@@ -194,6 +254,8 @@ int read_rsp_regs(void* opaque, uint32_t address, uint32_t* value)
     struct rsp_core* sp = (struct rsp_core*)opaque;
     uint32_t reg        = RSP_REG(address);
 
+    rsp_wait_task(sp);
+
     *value = sp->regs[reg];
 
     if (reg == SP_SEMAPHORE_REG)
@@ -208,6 +270,8 @@ int write_rsp_regs(void* opaque, uint32_t address, uint32_t value, uint32_t mask
    struct rsp_core* sp = (struct rsp_core*)opaque;
    uint32_t reg        = RSP_REG(address);
 
+    rsp_wait_task(sp);
+
     switch(reg)
     {
        case SP_STATUS_REG:
@@ -250,6 +314,8 @@ int read_rsp_regs2(void* opaque, uint32_t address, uint32_t* value)
     struct rsp_core* sp = (struct rsp_core*)opaque;
     uint32_t reg        = RSP_REG2(address);
 
+    rsp_wait_task(sp);
+
     *value = sp->regs2[reg];
 
     return 0;
@@ -260,15 +326,58 @@ int write_rsp_regs2(void* opaque, uint32_t address, uint32_t value, uint32_t mas
     struct rsp_core* sp = (struct rsp_core*)opaque;
     uint32_t reg        = RSP_REG2(address);
 
+    rsp_wait_task(sp);
+
     sp->regs2[reg] = MASKED_WRITE(&sp->regs2[reg], value, mask);
 
     return 0;
 }
 
+static void run_task(void* opaque)
+{
+    struct rsp_core* sp = (struct rsp_core*)opaque;
+    uint32_t type = sp->mem[0xfc0/4];
+    int64_t start = trace_begin();
+
+    rsp_profile_begin_task(sp);
+    rsp.doRspCycles(0xffffffff);
+    rsp_profile_end_task();
+
+    trace_end(type == 1 ? TRACE_SP_GFX_TASK : type == 2 ? TRACE_SP_AUDIO_TASK : TRACE_SP_TASK, start);
+}
+
+static void begin_task(struct rsp_core* sp)
+{
+    sp->mi_intr = sp->r4300->mi.regs[MI_INTR_REG];
+    sp->regs2[SP_PC_REG] &= 0xfff;
+}
+
+static void end_task(struct rsp_core* sp, uint32_t save_pc)
+{
+    uint32_t* mi_intr = &sp->r4300->mi.regs[MI_INTR_REG];
+
+    sp->regs2[SP_PC_REG] |= save_pc;
+    *mi_intr = (*mi_intr & ~MI_INTR_SP) | (sp->mi_intr & MI_INTR_SP);
+}
+
+static void check_task_halted(struct rsp_core* sp)
+{
+    sp->rsp_task_locked = 0;
+     if ((sp->regs[SP_STATUS_REG] & (SP_STATUS_HALT | SP_STATUS_BROKE)) == 0)
+     {
+        cp0_update_count();
+
+	sp->rsp_task_locked = 1;
+	add_interrupt_event(SP_INT, 1000);
+    }
+}
+
 void do_SP_Task(struct rsp_core* sp)
 {
     uint32_t save_pc = sp->regs2[SP_PC_REG] & ~0xfff;
 
+    rsp_wait_task(sp);
+
     if (sp->mem[0xfc0/4] == 1)
     {
 	if (ROM_PARAMS.special_rom != PERFECT_DARK)
@@ -283,11 +392,11 @@ void do_SP_Task(struct rsp_core* sp)
 
         unprotect_framebuffers(sp->dp);
 
-        sp->regs2[SP_PC_REG] &= 0xfff;
+        begin_task(sp);
         timed_section_start(TIMED_SECTION_GFX);
-        rsp.doRspCycles(0xffffffff);
+        run_task(sp);
         timed_section_end(TIMED_SECTION_GFX);
-        sp->regs2[SP_PC_REG] |= save_pc;
+        end_task(sp, save_pc);
         new_frame();
 
         if (sp->r4300->mi.regs[MI_INTR_REG] & MI_INTR_DP)
@@ -302,32 +411,73 @@ void do_SP_Task(struct rsp_core* sp)
     else if (sp->mem[0xfc0/4] == 2)
     {
        /* Audio List */
-        sp->regs2[SP_PC_REG] &= 0xfff;
+        begin_task(sp);
+#ifdef HAVE_RSP_THREAD
+        if (async_tasks)
+        {
+            /* Audio tasks only use SP memory and RDRAM, so the CPU runs on
+             * until it touches the SP or the SP_INT event fences the task. */
+            sp->task_save_pc = save_pc;
+            sp->task_async   = 1;
+            rsp_thread_run(run_task, sp);
+
+            if (!get_event(SP_INT))
+            {
+                cp0_update_count();
+                add_interrupt_event(SP_INT, RSP_ASYNC_TASK_DELAY);
+            }
+            return;
+        }
+#endif
         timed_section_start(TIMED_SECTION_AUDIO);
-        rsp.doRspCycles(0xffffffff);
+        run_task(sp);
         timed_section_end(TIMED_SECTION_AUDIO);
-        sp->regs2[SP_PC_REG] |= save_pc;
+        end_task(sp, save_pc);
     }
     else
     {
        /* Unknown list */
-        sp->regs2[SP_PC_REG] &= 0xfff;
-        rsp.doRspCycles(0xffffffff);
-        sp->regs2[SP_PC_REG] |= save_pc;
+        begin_task(sp);
+        run_task(sp);
+        end_task(sp, save_pc);
     }
 
-    sp->rsp_task_locked = 0;
-     if ((sp->regs[SP_STATUS_REG] & (SP_STATUS_HALT | SP_STATUS_BROKE)) == 0)
-     {
-        cp0_update_count();
+    check_task_halted(sp);
+}
 
-	sp->rsp_task_locked = 1;
-	add_interrupt_event(SP_INT, 1000);
-    }
+void rsp_set_async_tasks(unsigned value)
+{
+    async_tasks = value;
+}
+
+/* Waits for a task running on the RSP thread and finishes it as do_SP_Task
+ * would have. Anything reading or writing SP state calls this first. */
+void rsp_wait_task(struct rsp_core* sp)
+{
+#ifdef HAVE_RSP_THREAD
+    if (!sp->task_async)
+        return;
+
+    rsp_thread_wait();
+    sp->task_async = 0;
+
+    remove_event(SP_INT);
+    end_task(sp, sp->task_save_pc);
+    check_task_halted(sp);
+#endif
 }
 
 void rsp_interrupt_event(struct rsp_core* sp)
 {
+   if (sp->task_async)
+   {
+      /* end of an asynchronous task, deliver what its BREAK raised */
+      rsp_wait_task(sp);
+      if (sp->r4300->mi.regs[MI_INTR_REG] & MI_INTR_SP)
+         raise_rcp_interrupt(sp->r4300, MI_INTR_SP);
+      return;
+   }
+
    if ((sp->regs[SP_STATUS_REG] & SP_STATUS_INTR_BREAK) != 0)
       raise_rcp_interrupt(sp->r4300, MI_INTR_SP);
 }
@@ -93,6 +93,13 @@ struct rsp_core
     uint32_t rsp_task_locked;
     uint32_t audio_signal;
 
+    /* MI_INTR_REG as seen by the RSP plugin, merged into the MI after each
+     * task so that a task on the RSP thread never races the CPU on it */
+    uint32_t mi_intr;
+    /* set while a task runs on the RSP thread */
+    uint32_t task_async;
+    uint32_t task_save_pc;
+
     struct r4300_core* r4300;
     struct rdp_core* dp;
     struct ri_controller* ri;
@@ -117,6 +124,9 @@ int write_rsp_regs2(void* opaque, uint32_t address, uint32_t value, uint32_t mas
 
 void do_SP_Task(struct rsp_core* sp);
 
+void rsp_set_async_tasks(unsigned value);
+void rsp_wait_task(struct rsp_core* sp);
+
 void rsp_interrupt_event(struct rsp_core* sp);
 
 #endif
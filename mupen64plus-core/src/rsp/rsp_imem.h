@@ -0,0 +1,45 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - rsp_imem.h                                              *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_RSP_RSP_IMEM_H
+#define M64P_RSP_RSP_IMEM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* IMEM is tracked in 16 blocks of 256 bytes, bit n covering IMEM[n << 8] */
+#define RSP_IMEM_BLOCK_SHIFT    8
+
+/* Marks IMEM bytes [offset, offset + length) as written from outside the
+ * RSP: CPU stores, SP DMA, resets and savestates. */
+void rsp_imem_written(uint32_t offset, uint32_t length);
+
+/* Blocks written since the last call, recompiling LLE plugins fetch them
+ * once per DoRspCycles instead of comparing all of IMEM. */
+uint32_t rsp_imem_take_written(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
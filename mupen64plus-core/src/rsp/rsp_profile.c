@@ -0,0 +1,288 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - rsp_profile.c                                           *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "rsp_profile.h"
+#include "rsp_core.h"
+
+#include "api/callbacks.h"
+#include "api/m64p_types.h"
+#include "ri/ri_controller.h"
+
+#include "../../../libretro/libretro_perf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TASK_TYPE           (0xfc0 / 4)
+#define TASK_UCODE          (0xfd0 / 4)
+#define TASK_UCODE_SIZE     (0xfd4 / 4)
+
+/* ucodes beyond that are counted with the last one */
+#define MAX_UCODES          64
+
+struct ucode_profile
+{
+    uint32_t type;
+    uint32_t sum;
+    uint32_t ucode;
+    uint64_t tasks;
+    long long int time;
+    long long int max_time;
+    struct rsp_profile_regions regions;
+};
+
+static int enabled;
+static struct ucode_profile ucodes[MAX_UCODES];
+static unsigned ucode_count;
+static struct ucode_profile* current;
+static long long int task_start;
+
+/* also shown by the frontend's own performance log */
+static struct retro_perf_counter perf_gfx = { "rsp_gfx_task" };
+static struct retro_perf_counter perf_audio = { "rsp_audio_task" };
+static struct retro_perf_counter perf_other = { "rsp_other_task" };
+
+#if defined(WIN32) && !defined(__MINGW32__)
+  #include <windows.h>
+  static long long int get_time(void)
+  {
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+      return counter.QuadPart;
+  }
+  static long long int time_to_nsec(long long int time)
+  {
+      static LARGE_INTEGER freq = { 0 };
+      if (freq.QuadPart == 0)
+          QueryPerformanceFrequency(&freq);
+      return time * 1000000000 / freq.QuadPart;
+  }
+#else
+  #include <time.h>
+  static long long int get_time(void)
+  {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (long long int)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+  static long long int time_to_nsec(long long int time)
+  {
+      return time;
+  }
+#endif
+
+/* same checksum as sum_bytes in the HLE plugin, so the keys can be looked
+ * up in its task dispatching tables */
+static uint32_t ucode_sum(const struct rsp_core* sp)
+{
+    const uint8_t* dram = (const uint8_t*)sp->ri->rdram.dram;
+    uint32_t address = sp->mem[TASK_UCODE] & 0xffffff;
+    uint32_t size = sp->mem[TASK_UCODE_SIZE];
+    uint32_t sum = 0;
+    uint32_t i;
+
+    if (size > 0xf80)
+        size = 0xf80;
+    size >>= 1;
+
+    if (address + size > sp->ri->rdram.dram_size)
+        return 0;
+
+    for (i = 0; i < size; i++)
+        sum += dram[address + i];
+
+    return sum;
+}
+
+static struct ucode_profile* find_ucode(uint32_t type, uint32_t sum, uint32_t ucode)
+{
+    struct ucode_profile* entry;
+    unsigned i;
+
+    for (i = 0; i < ucode_count; i++)
+    {
+        if (ucodes[i].type == type && ucodes[i].sum == sum)
+            return &ucodes[i];
+    }
+
+    if (ucode_count == MAX_UCODES)
+        return &ucodes[MAX_UCODES - 1];
+
+    entry = &ucodes[ucode_count++];
+    entry->type = type;
+    entry->sum = sum;
+    entry->ucode = ucode;
+    return entry;
+}
+
+static struct retro_perf_counter* perf_counter(uint32_t type)
+{
+    struct retro_perf_counter* counter;
+
+    switch (type)
+    {
+        case 1: counter = &perf_gfx; break;
+        case 2: counter = &perf_audio; break;
+        default: counter = &perf_other; break;
+    }
+
+    if (!counter->registered)
+        perf_cb.perf_register(counter);
+
+    return counter;
+}
+
+void rsp_profile_enable(int enable)
+{
+    if (enable && !enabled)
+        rsp_profile_reset();
+
+    enabled = enable;
+}
+
+int rsp_profile_enabled(void)
+{
+    return enabled;
+}
+
+void rsp_profile_reset(void)
+{
+    memset(ucodes, 0, sizeof(ucodes));
+    ucode_count = 0;
+    current = NULL;
+}
+
+void rsp_profile_begin_task(const struct rsp_core* sp)
+{
+    uint32_t type;
+
+    if (!enabled)
+        return;
+
+    type = sp->mem[TASK_TYPE];
+    current = find_ucode(type, ucode_sum(sp), sp->mem[TASK_UCODE]);
+
+    if (perf_cb.perf_register)
+        perf_cb.perf_start(perf_counter(type));
+
+    task_start = get_time();
+}
+
+void rsp_profile_end_task(void)
+{
+    long long int time;
+
+    if (!current)
+        return;
+
+    time = get_time() - task_start;
+
+    if (perf_cb.perf_register)
+        perf_cb.perf_stop(perf_counter(current->type));
+
+    current->tasks++;
+    current->time += time;
+    if (time > current->max_time)
+        current->max_time = time;
+
+    current = NULL;
+}
+
+struct rsp_profile_regions* rsp_profile_regions(void)
+{
+    return current ? &current->regions : NULL;
+}
+
+static int compare_time(const void* a, const void* b)
+{
+    const struct ucode_profile* x = *(const struct ucode_profile* const*)a;
+    const struct ucode_profile* y = *(const struct ucode_profile* const*)b;
+
+    return (x->time < y->time) - (x->time > y->time);
+}
+
+/* only the regions the LLE plugin actually ran */
+static void write_histogram(FILE* f, const char* name, const uint64_t* regions)
+{
+    int first = 1;
+    unsigned i;
+
+    fprintf(f, "      \"%s\": {", name);
+
+    for (i = 0; i < RSP_PROFILE_REGIONS; i++)
+    {
+        if (!regions[i])
+            continue;
+
+        fprintf(f, "%s\"0x%03x\": %llu", first ? "" : ", ",
+            i << RSP_PROFILE_REGION_SHIFT, (unsigned long long)regions[i]);
+        first = 0;
+    }
+
+    fprintf(f, "}");
+}
+
+int rsp_profile_dump(const char* path)
+{
+    const struct ucode_profile* sorted[MAX_UCODES];
+    long long int total = 0;
+    unsigned i;
+    FILE* f;
+
+    f = fopen(path, "w");
+    if (f == NULL)
+    {
+        DebugMessage(M64MSG_WARNING, "Couldn't write RSP profile to %s", path);
+        return 0;
+    }
+
+    for (i = 0; i < ucode_count; i++)
+        sorted[i] = &ucodes[i];
+    qsort(sorted, ucode_count, sizeof(sorted[0]), compare_time);
+
+    fprintf(f, "{\n  \"region_size\": %u,\n  \"ucodes\": [", 1 << RSP_PROFILE_REGION_SHIFT);
+
+    for (i = 0; i < ucode_count; i++)
+    {
+        const struct ucode_profile* entry = sorted[i];
+
+        total += entry->time;
+
+        fprintf(f, "%s\n    {\n", i ? "," : "");
+        fprintf(f, "      \"type\": %u,\n", entry->type);
+        fprintf(f, "      \"sum\": \"0x%x\",\n", entry->sum);
+        fprintf(f, "      \"ucode\": \"0x%08x\",\n", entry->ucode);
+        fprintf(f, "      \"tasks\": %llu,\n", (unsigned long long)entry->tasks);
+        fprintf(f, "      \"total_ns\": %lld,\n", time_to_nsec(entry->time));
+        fprintf(f, "      \"max_ns\": %lld,\n", time_to_nsec(entry->max_time));
+        write_histogram(f, "instructions", entry->regions.instructions);
+        fprintf(f, ",\n");
+        write_histogram(f, "entries", entry->regions.entries);
+        fprintf(f, "\n    }");
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+
+    DebugMessage(M64MSG_INFO, "RSP profile: %u ucodes, %lld ms in tasks, written to %s",
+        ucode_count, time_to_nsec(total) / 1000000, path);
+    return 1;
+}
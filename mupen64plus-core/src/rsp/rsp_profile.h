@@ -0,0 +1,65 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - rsp_profile.h                                           *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_RSP_RSP_PROFILE_H
+#define M64P_RSP_RSP_PROFILE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rsp_core;
+
+/* IMEM is split in 64 regions of 16 instructions for the PC histograms */
+#define RSP_PROFILE_REGION_SHIFT    6
+#define RSP_PROFILE_REGIONS         (0x1000 >> RSP_PROFILE_REGION_SHIFT)
+
+/* Per-task RSP timing, keyed by task type and the same ucode byte sum the
+ * HLE plugin dispatches on.  Everything is a no-op until enabled. */
+void rsp_profile_enable(int enable);
+int rsp_profile_enabled(void);
+void rsp_profile_reset(void);
+
+void rsp_profile_begin_task(const struct rsp_core* sp);
+void rsp_profile_end_task(void);
+
+/* PC histograms of one ucode, indexed by (PC >> RSP_PROFILE_REGION_SHIFT).
+ * Interpreters count every instruction they execute, recompilers count the
+ * blocks they enter since they can't see single instructions. */
+struct rsp_profile_regions
+{
+    uint64_t instructions[RSP_PROFILE_REGIONS];
+    uint64_t entries[RSP_PROFILE_REGIONS];
+};
+
+/* Histograms of the running task's ucode, or NULL when profiling is off.
+ * LLE plugins fetch it once per DoRspCycles and count into it. */
+struct rsp_profile_regions* rsp_profile_regions(void);
+
+/* Writes everything gathered so far as JSON, returns 0 on failure */
+int rsp_profile_dump(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - rsp_thread.cpp                                          *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "rsp_thread.h"
+
+#include "main/trace.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable signal_work;
+static std::condition_variable signal_done;
+
+static void (*task)(void*);
+static void* task_opaque;
+static bool busy;
+static bool exiting;
+
+static void rsp_thread_main(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    trace_thread_name("rsp");
+
+    for (;;)
+    {
+        signal_work.wait(lock, [] { return busy || exiting; });
+
+        if (exiting)
+            break;
+
+        lock.unlock();
+        task(task_opaque);
+        lock.lock();
+
+        busy = false;
+        signal_done.notify_all();
+    }
+}
+
+void rsp_thread_run(void (*run)(void*), void* opaque)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    signal_done.wait(lock, [] { return !busy; });
+
+    if (!thread.joinable())
+    {
+        exiting = false;
+        thread = std::thread(rsp_thread_main);
+    }
+
+    task = run;
+    task_opaque = opaque;
+    busy = true;
+    signal_work.notify_one();
+}
+
+void rsp_thread_wait(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    signal_done.wait(lock, [] { return !busy; });
+}
+
+void rsp_thread_close(void)
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        signal_done.wait(lock, [] { return !busy; });
+        exiting = true;
+        signal_work.notify_one();
+    }
+
+    thread.join();
+}
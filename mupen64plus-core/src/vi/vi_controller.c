@@ -23,6 +23,7 @@
 
 #include "main/main.h"
 #include "main/rom.h"
+#include "main/trace.h"
 #include "memory/memory.h"
 #include "plugin/plugin.h"
 #include "r4300/r4300_core.h"
@@ -146,7 +147,9 @@ int write_vi_regs(void* opaque, uint32_t address,
 
 void vi_vertical_interrupt_event(struct vi_controller* vi)
 {
+   int64_t start = trace_begin();
    gfx.updateScreen();
+   trace_end(TRACE_VI_UPDATE, start);
 
    /* allow main module to do things on VI event */
    new_vi();
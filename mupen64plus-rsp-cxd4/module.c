@@ -234,6 +234,7 @@ EXPORT void CALL API_PREFIX(InitiateRSP)(RSP_INFO Rsp_Info, pu32 CycleCount)
     if (CycleCount != NULL) /* cycle-accuracy not doable with today's hosts */
         *CycleCount = 0;
     update_conf(CFG_FILE);
+    select_multiply_kernels();
 
     RSP_INFO_NAME = Rsp_Info;
     DRAM = GET_RSP_INFO(RDRAM);
@@ -21,6 +21,10 @@
  */
 #include "module.h"
 
+#ifdef __LIBRETRO__
+#include "rsp/rsp_profile.h"
+#endif
+
 u32 inst_word;
 
 u32 SR[32];
@@ -30,6 +34,41 @@ pu8 DRAM;
 pu8 DMEM;
 pu8 IMEM;
 
+/*
+ * predecoded IMEM
+ *
+ * Every IMEM slot keeps its instruction word along with the handler and the
+ * operand fields of vector computational ops and LWC2/SWC2, which otherwise
+ * are decoded again through two levels of switches each time they execute.
+ * SP DMA into IMEM marks the slots it overwrites as stale, and run_task
+ * checks the words against IMEM before it starts, as the CPU host may write
+ * IMEM directly between tasks.  Scalar unit stores only address DMEM.
+ */
+enum {
+    PREDECODE_NONE = 0, /* stale, decoded again on the next fetch */
+    PREDECODE_SCALAR,
+    PREDECODE_VECTOR,
+    PREDECODE_MWC2
+};
+
+typedef struct {
+    u32 word;
+    u8 type;
+    u8 op; /* COP2 inst.R.rs, selects the element of vt */
+    u8 vd;
+    u8 vs;
+    u8 vt;
+    u8 element;
+    u8 base;
+    s16 offset;
+    union {
+        p_vector_func vector;
+        mwc2_func mwc2;
+    } handler;
+} predecoded_inst;
+
+static predecoded_inst predecoded[0x1000 / 4];
+
 NOINLINE void res_S(void)
 {
     message("RESERVED.");
@@ -233,6 +272,10 @@ void SP_DMA_READ(void)
                 *(pi64)(DRAM + offD)
               & (offD & ~MAX_DRAM_DMA_ADDR ? 0 : ~0) /* 0 if (addr > limit) */
             ;
+            if (offC & 0x1000) {
+                predecoded[(offC & 0xFF8) / 4 + 0].type = PREDECODE_NONE;
+                predecoded[(offC & 0xFF8) / 4 + 1].type = PREDECODE_NONE;
+            }
             i += 0x008;
         } while (i < length);
     } while (count);
@@ -1821,39 +1864,6 @@ static INLINE int REGIMM(u32 inst, u32 PC)
     return 1;
 }
 
-static INLINE void MWC2_load(u32 inst)
-{
-    s16 offset;
-    const unsigned int base    = (inst >> 21) % (1 << 5);
-    const unsigned int vt      = (inst >> 16) % (1 << 5);
-    const unsigned int element = (inst >>  7) % (1 << 4);
-
-#if defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
-    offset   = (s16)inst;
-    offset <<= 5 + 4; /* safe on x86, skips 5-bit rd, 4-bit element */
-    offset >>= 5 + 4;
-#else
-    offset = (inst & 64) ? -(s16)(~inst%64 + 1) : inst % 64;
-#endif
-    LWC2[IW_RD(inst)](vt, element, offset, base);
-}
-static INLINE void MWC2_store(u32 inst)
-{
-    s16 offset;
-    const unsigned int base    = (inst >> 21) % (1 << 5);
-    const unsigned int vt      = (inst >> 16) % (1 << 5);
-    const unsigned int element = (inst >>  7) % (1 << 4);
-
-#if defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
-    offset = (s16)inst;
-    offset <<= 5 + 4; /* safe on x86, skips 5-bit rd, 4-bit element */
-    offset >>= 5 + 4;
-#else
-    offset = (inst & 64) ? -(s16)(~inst%64 + 1) : inst % 64;
-#endif
-    SWC2[IW_RD(inst)](vt, element, offset, base);
-}
-
 static INLINE void COP0(u32 inst)
 {
     const unsigned int rd = IW_RD(inst);
@@ -1878,18 +1888,8 @@ static INLINE void COP2(u32 inst)
     const unsigned int vt = (inst >> 16) % (1 << 5); /* inst.R.rt */
     const unsigned int vs = IW_RD(inst);
     const unsigned int vd = (inst >>  6) % (1 << 5); /* inst.R.sa */
-    const unsigned int func = inst % (1 << 6);
-#ifndef ARCH_MIN_SSE2
-    const unsigned int e  = op & 0xF; /* With Intel, LEA offsets beat ANDing. */
-#endif
-
-    switch (op) {
-#ifdef ARCH_MIN_SSE2
-        v16 target;
-#else
-        register unsigned int i;
-#endif
 
+    switch (op) { /* Vector computational ops are predecoded. */
     case 000:
         MFC2(vt, vs, vd >> 1);
         break;
@@ -1902,12 +1902,35 @@ static INLINE void COP2(u32 inst)
     case 006:
         CTC2(vt, vs);
         break;
+    default:
+        res_S();
+    }
+}
+
+static INLINE void COP2_vector(const predecoded_inst* inst)
+{
+    const unsigned int op = inst->op;
+    const unsigned int vt = inst->vt;
+    const unsigned int vs = inst->vs;
+    const unsigned int vd = inst->vd;
+    const p_vector_func func = inst->handler.vector;
+#ifndef ARCH_MIN_SSE2
+    const unsigned int e  = op & 0xF; /* With Intel, LEA offsets beat ANDing. */
+#endif
+
+    switch (op) {
+#ifdef ARCH_MIN_SSE2
+        v16 target;
+#else
+        register unsigned int i;
+#endif
+
     case 020:
     case 021:
 #ifdef ARCH_MIN_SSE2
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], *(v16 *)VR[vt]);
+        *(v16 *)(VR[vd]) = func(*(v16 *)VR[vs], *(v16 *)VR[vt]);
 #else
-        COP2_C2[func](&VR[vs][0], &VR[vt][0]);
+        func(&VR[vs][0], &VR[vt][0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
@@ -1928,11 +1951,11 @@ static INLINE void COP2(u32 inst)
         target = _mm_shufflehi_epi16(target, _MM_SHUFFLE(2, 2, 0, 0));
         target = _mm_shufflelo_epi16(target, _MM_SHUFFLE(2, 2, 0, 0));
 #endif
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], target);
+        *(v16 *)(VR[vd]) = func(*(v16 *)VR[vs], target);
 #else
         for (i = 0; i < N; i++)
             shuffle_temporary[i] = VR[vt][(i & 0xE) + (e & 0x1)];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
+        func(&VR[vs][0], &shuffle_temporary[0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
@@ -1951,11 +1974,11 @@ static INLINE void COP2(u32 inst)
         target = _mm_shufflehi_epi16(target, _MM_SHUFFLE(0, 0, 0, 0));
         target = _mm_shufflelo_epi16(target, _MM_SHUFFLE(0, 0, 0, 0));
 #endif
-        *(v16 *)(VR[vd]) = COP2_C2[func](*(v16 *)VR[vs], target);
+        *(v16 *)(VR[vd]) = func(*(v16 *)VR[vs], target);
 #else
         for (i = 0; i < N; i++)
             shuffle_temporary[i] = VR[vt][(i & 0xC) + (e & 0x3)];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
+        func(&VR[vs][0], &shuffle_temporary[0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
@@ -1968,14 +1991,14 @@ static INLINE void COP2(u32 inst)
     case 036:
     case 037:
 #ifdef ARCH_MIN_SSE2
-        *(v16 *)(VR[vd]) = COP2_C2[func](
+        *(v16 *)(VR[vd]) = func(
             *(v16 *)VR[vs],
             _mm_set1_epi16(VR[vt][op - 0x18])
         );
 #else
         for (i = 0; i < N; i++)
             shuffle_temporary[i] = VR[vt][e % N];
-        COP2_C2[func](&VR[vs][0], &shuffle_temporary[0]);
+        func(&VR[vs][0], &shuffle_temporary[0]);
         vector_copy(&VR[vd][0], &V_result[0]);
 #endif
         break;
@@ -1984,13 +2007,70 @@ static INLINE void COP2(u32 inst)
     }
 }
 
+static NOINLINE void predecode(predecoded_inst* inst, u32 word)
+{
+    const unsigned int op = (word >> 21) % (1 << 5);
+
+    inst->word = word;
+    inst->type = PREDECODE_SCALAR;
+
+    switch (word >> 26) {
+    case 022: /* COP2 */
+        if (op < 020)
+            break;
+        inst->type = PREDECODE_VECTOR;
+        inst->op = op;
+        inst->vt = (word >> 16) % (1 << 5);
+        inst->vs = IW_RD(word);
+        inst->vd = (word >>  6) % (1 << 5);
+        inst->handler.vector = COP2_C2[word % (1 << 6)];
+        break;
+    case 062: /* LWC2 */
+    case 072: /* SWC2 */
+        inst->type = PREDECODE_MWC2;
+        inst->base    = (word >> 21) % (1 << 5);
+        inst->vt      = (word >> 16) % (1 << 5);
+        inst->element = (word >>  7) % (1 << 4);
+        inst->offset  = (word & 64) ? -(s16)(~word%64 + 1) : word % 64;
+        inst->handler.mwc2 =
+            (word >> 26 == 062 ? LWC2 : SWC2)[IW_RD(word)];
+        break;
+    }
+}
+
+static INLINE predecoded_inst* fetch(u32 PC)
+{
+    predecoded_inst* inst;
+
+    inst = &predecoded[FIT_IMEM(PC) / 4];
+    if (inst->type == PREDECODE_NONE)
+        predecode(inst, *(pi32)(IMEM + FIT_IMEM(PC)));
+    return inst;
+}
+
 NOINLINE void run_task(void)
 {
     register u32 PC;
+    register predecoded_inst* inst;
+    register unsigned int i;
+#ifdef __LIBRETRO__
+    struct rsp_profile_regions* regions;
+
+    regions = rsp_profile_regions(); /* NULL unless the core is profiling */
+#endif
+
+    for (i = 0; i < 0x1000 / 4; i++)
+        if (predecoded[i].word != *(pi32)(IMEM + 4*i))
+            predecoded[i].type = PREDECODE_NONE;
 
     PC = FIT_IMEM(GET_RCP_REG(SP_PC_REG));
     for (;;) {
-        inst_word = *(pi32)(IMEM + FIT_IMEM(PC));
+        inst = fetch(PC);
+        inst_word = inst->word;
+#ifdef __LIBRETRO__
+        if (regions != NULL)
+            ++regions->instructions[FIT_IMEM(PC) >> RSP_PROFILE_REGION_SHIFT];
+#endif
 #ifdef EMULATE_STATIC_PC
         PC = (PC + 0x004);
 EX:
@@ -2067,7 +2147,10 @@ EX:
                 goto RSP_halted_CPU_exit_point;
             break;
         case 022:
-            COP2(inst_word);
+            if (inst->type == PREDECODE_VECTOR)
+                COP2_vector(inst);
+            else
+                COP2(inst_word);
             break;
         case 040:
             LB(inst_word);
@@ -2094,10 +2177,9 @@ EX:
             SW(inst_word);
             break;
         case 062: /* LWC2 */
-            MWC2_load(inst_word);
-            break;
         case 072: /* SWC2 */
-            MWC2_store(inst_word);
+            inst->handler.mwc2(
+                inst->vt, inst->element, inst->offset, inst->base);
             break;
         default:
             res_S();
@@ -2116,7 +2198,12 @@ EX:
 #else
         continue;
 set_branch_delay:
-        inst_word = *(pi32)(IMEM + FIT_IMEM(PC));
+        inst = fetch(PC);
+        inst_word = inst->word;
+#ifdef __LIBRETRO__
+        if (regions != NULL)
+            ++regions->instructions[FIT_IMEM(PC) >> RSP_PROFILE_REGION_SHIFT];
+#endif
         PC = FIT_IMEM(temp_PC);
         goto EX;
 #endif
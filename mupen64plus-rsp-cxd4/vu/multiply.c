@@ -752,3 +752,145 @@ VECTOR_OPERATION VMADH(v16 vs, v16 vt)
     return;
 #endif
 }
+
+#ifdef ARCH_HAVE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET     __attribute__((target("avx2")))
+#endif
+
+/*
+ * The AVX2 kernels widen each element to a 32-bit lane and keep the 48-bit
+ * accumulator as two of them:  bits 47..16 (VACC_H:VACC_M) in one ymm, and
+ * bits 15..0 in another whose bit 16 carries into the first.  The product
+ * is split the same way, so VMACF and VMACU are a single add with carry,
+ * and the signed clamp of bits 47..16 is one 32-to-16 pack.
+ *
+ * Only the fractional MACs are worth it:  VMADx already stay in 16-bit lanes
+ * with SSE2, and the widening and narrowing cost about what AVX2 saves.
+ */
+AVX2_TARGET static INLINE __m256i widen_s16(v16 vs)
+{
+    return _mm256_cvtepi16_epi32(vs);
+}
+
+AVX2_TARGET static INLINE __m256i widen_u16(v16 vs)
+{
+    return _mm256_cvtepu16_epi32(vs);
+}
+
+/*
+ * (VS * VT) for signed halfwords.  With the upper halfword of every lane
+ * zeroed, PMADDWD's pair sum is just the signed 16x16 product.
+ */
+AVX2_TARGET static INLINE __m256i mul_s16_s16(v16 vs, v16 vt)
+{
+    return _mm256_madd_epi16(widen_u16(vs), widen_u16(vt));
+}
+
+AVX2_TARGET static INLINE v16 pack_low_halves(__m256i x)
+{
+    x = _mm256_and_si256(x, _mm256_set1_epi32(0x0000FFFF));
+    x = _mm256_packus_epi32(x, x);
+    x = _mm256_permute4x64_epi64(x, 0xD8);
+    return _mm256_castsi256_si128(x);
+}
+
+AVX2_TARGET static INLINE v16 pack_signed(__m256i x)
+{
+    return _mm_packs_epi32(
+        _mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1)
+    );
+}
+
+/*
+ * acc += (prod_hi << 16) + prod_lo, where prod_lo must be within 0..0xFFFF.
+ * Writes back all three accumulator slices and returns bits 47..16.
+ */
+AVX2_TARGET static INLINE __m256i accumulate(__m256i prod_hi, __m256i prod_lo)
+{
+    __m256i acc_hm, acc_lo;
+
+    acc_hm = _mm256_or_si256(
+        _mm256_slli_epi32(widen_s16(*(v16 *)VACC_H), 16),
+        widen_u16(*(v16 *)VACC_M)
+    );
+    acc_lo = _mm256_add_epi32(widen_u16(*(v16 *)VACC_L), prod_lo);
+    acc_hm = _mm256_add_epi32(acc_hm, prod_hi);
+    acc_hm = _mm256_add_epi32(acc_hm, _mm256_srli_epi32(acc_lo, 16));
+
+    *(v16 *)VACC_L = pack_low_halves(acc_lo);
+    *(v16 *)VACC_M = pack_low_halves(acc_hm);
+    *(v16 *)VACC_H = pack_low_halves(_mm256_srli_epi32(acc_hm, 16));
+    return (acc_hm);
+}
+
+/*
+ * acc += (VS * VT) << 1, returning bits 47..16 of the new accumulator
+ */
+AVX2_TARGET static INLINE __m256i do_mac_avx2(v16 vs, v16 vt)
+{
+    __m256i product;
+
+    product = mul_s16_s16(vs, vt);
+    return accumulate(
+        _mm256_srai_epi32(product, 15),
+        _mm256_and_si256(
+            _mm256_slli_epi32(product, 1), _mm256_set1_epi32(0x0000FFFF))
+    );
+}
+
+AVX2_TARGET static v16 VMACF_AVX2(v16 vs, v16 vt)
+{
+    return pack_signed(do_mac_avx2(vs, vt));
+}
+
+AVX2_TARGET static v16 VMACU_AVX2(v16 vs, v16 vt)
+{
+    v16 cond;
+
+/*
+ * same as UNSIGNED_CLAMP, including that a positive overflow whose middle
+ * slice happens to read +32767 is left at +32767 instead of 0xFFFF
+ */
+    vs = pack_signed(do_mac_avx2(vs, vt));
+    cond = _mm_cmpgt_epi16(vs, *(v16 *)VACC_M);
+    vs = _mm_andnot_si128(_mm_srai_epi16(vs, 15), vs);
+    return _mm_or_si128(vs, cond);
+}
+
+static int cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+    int regs[4];
+
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return 0;
+    __cpuid(regs, 1);
+    if ((regs[2] & (1 << 27)) == 0) /* OSXSAVE:  OS saves the ymm registers */
+        return 0;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return 0;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] >> 5) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+void select_multiply_kernels(void)
+{
+#ifdef ARCH_HAVE_AVX2
+    if (!cpu_has_avx2())
+        return;
+    COP2_C2[010] = VMACF_AVX2;
+    COP2_C2[011] = VMACU_AVX2;
+#endif
+    return;
+}
@@ -82,4 +82,19 @@ VECTOR_EXTERN
 #define SEMIFRAC    (VS[i]*VT[i]*2/2 + 0x8000/2)
 #endif
 
+/*
+ * x86 builds also carry AVX2 versions of VMACF and VMACU, which
+ * get swapped into the COP2 table only if the host CPU turns out to have it.
+ */
+#if defined(ARCH_MIN_SSE2) && !defined(SSE2NEON)
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(__clang__) || defined(_MSC_VER) && (_MSC_VER >= 1800) || \
+    defined(__GNUC__) && (__GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define ARCH_HAVE_AVX2
+#endif
+#endif
+#endif
+
+extern void select_multiply_kernels(void);
+
 #endif
@@ -4,6 +4,11 @@
 #include "Rsp_#1.1.h"
 #include "m64p_plugin.h"
 
+#ifdef PARALLEL_INTEGRATION
+#include "rsp/rsp_imem.h"
+#include "rsp/rsp_profile.h"
+#endif
+
 #define RSP_PARALLEL_VERSION 0x0101
 #define RSP_PLUGIN_API_VERSION 0x020000
 
@@ -38,12 +43,23 @@ EXPORT unsigned int CALL parallelRSPDoRspCycles(unsigned int cycles)
    if (*RSP::rsp.SP_STATUS_REG & (SP_STATUS_HALT | SP_STATUS_BROKE))
       return 0;
 
+#ifdef PARALLEL_INTEGRATION
+   // The core tracks its own writes to IMEM.
+   static_assert(CODE_BLOCK_SIZE_LOG2 == RSP_IMEM_BLOCK_SHIFT, "IMEM block sizes differ.");
+   RSP::cpu.invalidate_imem_blocks(rsp_imem_take_written());
+#else
    // We don't know if Mupen from the outside invalidated our IMEM.
    RSP::cpu.invalidate_imem();
+#endif
 
    // Run CPU until we either break or we need to fire an IRQ.
    RSP::cpu.get_state().pc = *RSP::rsp.SP_PC_REG & 0xfff;
 
+#ifdef PARALLEL_INTEGRATION
+   struct rsp_profile_regions *regions = rsp_profile_regions();
+   RSP::cpu.set_entry_counts(regions ? regions->entries : nullptr, RSP_PROFILE_REGION_SHIFT);
+#endif
+
 #ifdef INTENSE_DEBUG
    fprintf(stderr, "RUN TASK: %u\n", RSP::cpu.get_state().pc);
    log_rsp_mem_parallel();
@@ -37,6 +37,7 @@ namespace RSP
 {
 CPU::CPU()
 {
+   state.blocks = blocks;
    init_symbol_table();
 }
 
@@ -171,6 +172,15 @@ void CPU::invalidate_imem()
          state.dirty_blocks |= (0x3 << i) >> 1;
 }
 
+// For callers that know which blocks of IMEM were written, bit i covering
+// CODE_BLOCK_SIZE bytes at i * CODE_BLOCK_SIZE.
+void CPU::invalidate_imem_blocks(uint32_t written)
+{
+   for (unsigned i = 0; i < CODE_BLOCKS; i++)
+      if (written & (1u << i))
+         state.dirty_blocks |= (0x3 << i) >> 1;
+}
+
 void CPU::invalidate_code()
 {
    if (!state.dirty_blocks)
@@ -339,15 +349,35 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
 
    uint32_t branch_delay = 0;
    uint32_t pipe_branch_delay = 0;
+
+   // Scalar registers live in locals, these are loaded on entry and
+   // the written ones are stored back whenever the block is left.
+   uint32_t used_regs = 0;
+   uint32_t written_regs = 0;
+
    char buf[256];
 #define APPEND(...) do { \
    sprintf(buf, __VA_ARGS__); body += buf; \
 } while(0)
 #define APPEND_RD_NOT_R0(...) if (rd != 0) do { \
    APPEND(__VA_ARGS__); \
+   written_regs |= 1u << rd; \
 } while(0)
 #define APPEND_RT_NOT_R0(...) if (rt != 0) do { \
    APPEND(__VA_ARGS__); \
+   written_regs |= 1u << rt; \
+} while(0)
+
+   // Helpers work on STATE->sr, so registers are synced around them.
+#define STORE_REG(reg) do { \
+   if (reg != 0) \
+      APPEND("STATE->sr[%u] = r%u;\n", reg, reg); \
+} while(0)
+#define LOAD_REG(reg) do { \
+   if (reg != 0) { \
+      APPEND("r%u = STATE->sr[%u];\n", reg, reg); \
+      written_regs |= 1u << reg; \
+   } \
 } while(0)
 
 #define DISASM(...) do { \
@@ -392,17 +422,24 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
 #define CHECK_BRANCH_DELAY() do { \
    if (pending_call && !pipe_pending_local_branch_delay && !pipe_pending_branch_delay) { \
       APPEND("if (LIKELY(branch)) {\n"); \
+      APPEND("  FLUSH_REGS();\n"); \
       APPEND("  RSP_CALL(opaque, 0x%03x, 0x%03x);\n", \
             branch_delay * 4, ((pc + i + 1) << 2) & (IMEM_SIZE - 1)); \
+      APPEND("  RELOAD_REGS();\n"); \
       APPEND("}\n"); \
    } else if (pending_indirect_call && !pipe_pending_local_branch_delay && !pipe_pending_branch_delay) { \
       APPEND("if (LIKELY(branch)) {\n"); \
+      APPEND("  FLUSH_REGS();\n"); \
       APPEND("  RSP_CALL(opaque, (branch_delay << 2) & %u, 0x%03x);\n", \
             IMEM_SIZE - 1, ((pc + i + 1) << 2) & (IMEM_SIZE - 1)); \
+      APPEND("  RELOAD_REGS();\n"); \
       APPEND("}\n"); \
    } else if (pending_return && !pipe_pending_local_branch_delay && !pipe_pending_branch_delay) { \
       APPEND("if (LIKELY(branch)) {\n"); \
-      APPEND("  if (RSP_RETURN(opaque, (branch_delay << 2) & %u)) return;\n", IMEM_SIZE - 1); \
+      APPEND("  if (RSP_RETURN(opaque, (branch_delay << 2) & %u)) {\n", IMEM_SIZE - 1); \
+      APPEND("    FLUSH_REGS();\n"); \
+      APPEND("    return;\n"); \
+      APPEND("  }\n"); \
       APPEND("  STATE->pc = (branch_delay << 2) & %u;\n", IMEM_SIZE - 1); \
       APPEND("  EXIT(MODE_CONTINUE);\n"); \
       APPEND("}\n"); \
@@ -411,13 +448,19 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
          APPEND("if (branch && pipe_branch) {\n"); \
          APPEND("  STATE->pc = %u;\n", branch_delay * 4); \
          APPEND("  PROMOTE_DELAY_SLOT();\n"); \
-         APPEND("  EXIT(MODE_CONTINUE);\n"); \
+         APPEND("  CHAIN(%u);\n", branch_delay * 4); \
          APPEND("} else if (branch) {\n"); \
          APPEND("  goto pc_%03x;\n", branch_delay * 4); \
          APPEND("}\n"); \
       } else { \
          APPEND("if (branch) goto pc_%03x;\n", branch_delay * 4); \
       } \
+   } else if (pending_branch_delay && !pending_return && !pending_indirect_call) { \
+      APPEND("if (branch) {\n"); \
+      APPEND("  STATE->pc = %u;\n", branch_delay * 4); \
+      PROMOTE_DELAY_SLOT(); \
+      APPEND("  CHAIN(%u);\n", branch_delay * 4); \
+      APPEND("}\n"); \
    } else if (pending_branch_delay) { \
       APPEND("if (branch) {\n"); \
       APPEND("  STATE->pc = (branch_delay << 2) & %u;\n", IMEM_SIZE - 1); \
@@ -544,7 +587,9 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
       }
       else
       {
-         // Everything else.
+         // Everything else, conservatively using all register fields.
+         used_regs |= (1u << ((instr >> 21) & 31)) | (1u << ((instr >> 16) & 31)) | (1u << ((instr >> 11) & 31));
+
          switch (type)
          {
             case 000:
@@ -594,6 +639,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                         if (rd != 0)
                         {
                            APPEND("r%u = %u;\n", rd, ((pc + i + 2) << 2) & 0xffc);
+                           written_regs |= 1u << rd;
                         }
                         set_pc_indirect(rs);
                         pipe_pending_indirect_call = true;
@@ -670,6 +716,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                {
                   case 020: // BLTZAL
                      APPEND("r31 = %u;\n", ((pc + i + 2) << 2) & 0xffc);
+                     written_regs |= 1u << 31;
                      rs = (instr >> 21) & 31;
                      set_pc(pc + i + 1 + instr);
                      APPEND("BRANCH_IF((int)r%u < 0);\n", rs);
@@ -685,6 +732,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
 
                   case 021: // BGEZAL
                      APPEND("r31 = %u;\n", ((pc + i + 2) << 2) & 0xffc);
+                     written_regs |= 1u << 31;
                      rs = (instr >> 21) & 31;
                      set_pc(pc + i + 1 + instr);
                      APPEND("BRANCH_IF((int)r%u >= 0);\n", rs);
@@ -705,6 +753,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
 
             case 003: // JAL
                APPEND("r31 = %u;\n", ((pc + i + 2) << 2) & 0xffc);
+               written_regs |= 1u << 31;
                imm = instr & 0x3ff;
                set_pc(imm);
                pipe_pending_call = true;
@@ -820,6 +869,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                {
                   case 000: // MFC0
                      APPEND("cp0_result = RSP_MFC0(STATE, %u, %u);\n", rt, rd);
+                     LOAD_REG(rt);
                      DISASM("mfc0 %u, %u\n", rt, rd);
 
                      APPEND("if (UNLIKELY(cp0_result != MODE_CONTINUE)) {\n");
@@ -828,6 +878,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                      break;
 
                   case 004: // MTC0
+                     STORE_REG(rt);
                      APPEND("cp0_result = RSP_MTC0(STATE, %u, %u);\n", rd, rt);
                      DISASM("mtc0 %u, %u\n", rd, rt);
 
@@ -850,15 +901,18 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                {
                   case 000: // MFC2
                      APPEND("RSP_MFC2(STATE, %u, %u, %u);\n", rt, rd, imm);
+                     LOAD_REG(rt);
                      DISASM("mfc2 %u, %u, %u\n", rt, rd, imm);
                      break;
 
                   case 002: // CFC2
                      APPEND("RSP_CFC2(STATE, %u, %u);\n", rt, rd);
+                     LOAD_REG(rt);
                      DISASM("cfc2 %u, %u\n", rt, rd);
                      break;
 
                   case 004: // MTC2
+                     STORE_REG(rt);
                      APPEND("RSP_MTC2(STATE, %u, %u, %u);\n", rt, rd, imm);
                      DISASM("mtc2 %u, %u, %u\n", rt, rd, imm);
 #ifdef INTENSE_DEBUG
@@ -867,6 +921,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                      break;
 
                   case 006: // CTC2
+                     STORE_REG(rt);
                      APPEND("RSP_CTC2(STATE, %u, %u);\n", rt, rd);
                      DISASM("mtc2 %u, %u\n", rt, rd);
                      break;
@@ -882,6 +937,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                rs = (instr >> 21) & 31;
                if (rt != 0)
                {
+                  written_regs |= 1u << rt;
                   APPEND("r%u = (signed char)READ_MEM_U8(dmem, (r%u + (%d)) & 0xfff);\n",
                         rt, rs, simm);
                }
@@ -894,6 +950,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                rs = (instr >> 21) & 31;
                if (rt != 0)
                {
+                  written_regs |= 1u << rt;
                   APPEND("addr = (r%u + (%d)) & 0xfff;\n", rs, simm);
                   APPEND("if (UNLIKELY(addr & 1))\n");
                   APPEND("  r%u = (signed short)READ_MEM_U16_UNALIGNED(dmem, addr);\n", rt);
@@ -909,6 +966,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                rs = (instr >> 21) & 31;
                if (rt != 0)
                {
+                  written_regs |= 1u << rt;
                   APPEND("addr = (r%u + (%d)) & 0xfff;\n", rs, simm);
                   APPEND("if (UNLIKELY(addr & 3))\n");
                   APPEND("  r%u = READ_MEM_U32_UNALIGNED(dmem, addr);\n", rt);
@@ -924,6 +982,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                rs = (instr >> 21) & 31;
                if (rt != 0)
                {
+                  written_regs |= 1u << rt;
                   APPEND("r%u = READ_MEM_U8(dmem, (r%u + (%d)) & 0xfff);\n", rt, rs, simm);
                }
                DISASM("lbu %s, %d(%s)\n", NAME(rt), simm, NAME(rs));
@@ -935,7 +994,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                rs = (instr >> 21) & 31;
                if (rt != 0)
                {
-
+                  written_regs |= 1u << rt;
                   APPEND("addr = (r%u + (%d)) & 0xfff;\n", rs, simm);
                   APPEND("if (UNLIKELY(addr & 1))\n");
                   APPEND("  r%u = READ_MEM_U16_UNALIGNED(dmem, addr);\n", rt);
@@ -996,6 +1055,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                auto *op = lwc2_ops[rd];
                if (op)
                {
+                  STORE_REG(rs);
                   APPEND("RSP_%s(STATE, %u, %u, %d, %u);\n", op, rt, imm, simm, rs);
                   DISASM("%s %u, %u, %d, %u\n", op, rt, imm, simm, rs);
                }
@@ -1025,6 +1085,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
                auto *op = swc2_ops[rd];
                if (op)
                {
+                  STORE_REG(rs);
                   APPEND("RSP_%s(STATE, %u, %u, %d, %u);\n", op, rt, imm, simm, rs);
                   DISASM("%s %u, %u, %d, %u\n", op, rt, imm, simm, rs);
                }
@@ -1052,10 +1113,13 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
    APPEND("STATE->pc = %u;\n",
          ((pc + count) << 2) & (IMEM_SIZE - 1));
    PROMOTE_DELAY_SLOT();
-   APPEND("EXIT(MODE_CONTINUE);\n");
+   APPEND("CHAIN(%u);\n", ((pc + count) << 2) & (IMEM_SIZE - 1));
 
    // Emit helper code.
    full_code += R"DELIM(
+struct cpu_state;
+typedef void (*block_func)(void *, struct cpu_state *);
+
 struct cpu_state
 {
    unsigned pc;
@@ -1065,6 +1129,9 @@ struct cpu_state
    unsigned sr[32];
    unsigned *dmem;
    unsigned *imem;
+   unsigned *rdram;
+   block_func *blocks;
+   unsigned chain_budget;
 };
 #define UNLIKELY(x) __builtin_expect(!!x, 0)
 #define LIKELY(x) __builtin_expect(!!x, 1)
@@ -1135,7 +1202,22 @@ DECL_LS(STV);
 extern void RSP_CALL(void *opaque, unsigned target, unsigned ret);
 extern int RSP_RETURN(void *opaque, unsigned pc);
 extern void RSP_EXIT(void *opaque, enum ReturnMode mode);
-#define EXIT(mode) RSP_EXIT(opaque, mode)
+#define EXIT(mode) do { \
+   FLUSH_REGS(); \
+   RSP_EXIT(opaque, mode); \
+} while(0)
+
+// Enters the block at pc directly if it is compiled already and IMEM is clean.
+#define CHAIN(pc) do { \
+   block_func next = STATE->blocks[(pc) >> 2]; \
+   FLUSH_REGS(); \
+   if (LIKELY(next && STATE->chain_budget && !STATE->dirty_blocks)) { \
+      STATE->chain_budget--; \
+      next(opaque, STATE); \
+      return; \
+   } \
+   RSP_EXIT(opaque, MODE_CONTINUE); \
+} while(0)
 
 extern void RSP_DEBUG(struct cpu_state *STATE, const char *tag, unsigned pc, unsigned value);
 
@@ -1226,12 +1308,30 @@ DECL_COP2(RESERVED);
    full_code += "void block_entry(void *opaque, struct cpu_state *STATE)\n";
    full_code += "{\n";
 
+   used_regs = (used_regs | written_regs) & ~1u;
+   written_regs &= ~1u;
+
+   string flush = "#define FLUSH_REGS() do { \\\n";
+   string reload = "#define RELOAD_REGS() do { \\\n";
    for (unsigned i = 1; i < 32; i++)
    {
-      char buf[32];
-      sprintf(buf, "#define r%u (STATE->sr[%u])\n", i, i);
-      full_code += buf;
+      char buf[64];
+      if (used_regs & (1u << i))
+      {
+         sprintf(buf, "unsigned r%u = STATE->sr[%u];\n", i, i);
+         full_code += buf;
+         sprintf(buf, "   r%u = STATE->sr[%u]; \\\n", i, i);
+         reload += buf;
+      }
+
+      if (written_regs & (1u << i))
+      {
+         sprintf(buf, "   STATE->sr[%u] = r%u; \\\n", i, i);
+         flush += buf;
+      }
    }
+   full_code += flush + "} while(0)\n";
+   full_code += reload + "} while(0)\n";
 
    // Emit fixup code.
 
@@ -1331,9 +1431,9 @@ void RSP_CALL(void *cpu, unsigned target, unsigned ret)
    static_cast<CPU *>(cpu)->call(target, ret);
 }
 
-void RSP_RETURN(void *cpu, unsigned pc)
+int RSP_RETURN(void *cpu, unsigned pc)
 {
-   static_cast<CPU *>(cpu)->ret(pc);
+   return static_cast<CPU *>(cpu)->ret(pc);
 }
 
 void RSP_EXIT(void *cpu, int mode)
@@ -1348,6 +1448,9 @@ void CPU::enter(uint32_t pc)
    uint32_t word_pc = pc >> 2;
    auto &block = blocks[word_pc];
 
+   if (entry_counts)
+      entry_counts[pc >> entry_count_shift]++;
+
    if (!block)
    {
       unsigned end = (pc + (CODE_BLOCK_SIZE * 2)) >> CODE_BLOCK_SIZE_LOG2;
@@ -1384,6 +1487,8 @@ ReturnMode CPU::run()
       switch (ret)
       {
          case MODE_ENTER:
+            // The region profile counts entries in enter(), so don't chain past it.
+            state.chain_budget = entry_counts ? 0 : CHAIN_BUDGET;
             enter(state.pc);
             break;
 
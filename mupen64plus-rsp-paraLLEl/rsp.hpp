@@ -57,6 +57,14 @@ namespace RSP
          }
 
          void invalidate_imem();
+         void invalidate_imem_blocks(uint32_t written);
+
+         // Block entries are counted per (pc >> shift) while counts is set.
+         void set_entry_counts(uint64_t *counts, unsigned shift)
+         {
+            entry_counts = counts;
+            entry_count_shift = shift;
+         }
 
          CPUState &get_state()
          {
@@ -96,6 +104,13 @@ namespace RSP
          sigjmp_buf env;
 #endif
 
+         uint64_t *entry_counts = nullptr;
+         unsigned entry_count_shift = 0;
+
+// Chained blocks nest on the host stack unless the compiler turns
+// the jump into a tail call, so they go back to run() now and then.
+#define CHAIN_BUDGET 1024
+
 #define CALL_STACK_SIZE 32
          uint32_t call_stack[CALL_STACK_SIZE] = {};
          unsigned call_stack_ptr = 0;
@@ -11,7 +11,7 @@ void RSP_CFC2(RSP::CPUState *rsp, unsigned rt, unsigned rd);
 void RSP_CTC2(RSP::CPUState *rsp, unsigned rt, unsigned rd);
 
 void RSP_CALL(void *opaque, unsigned target, unsigned ret);
-void RSP_RETURN(void *opaque, unsigned pc);
+int RSP_RETURN(void *opaque, unsigned pc);
 void RSP_EXIT(void *opaque, int mode);
 
 #define DECL_LS(op) \
@@ -128,6 +128,11 @@ namespace RSP
       uint32_t *imem = nullptr;
       uint32_t *rdram = nullptr;
 
+      // Compiled blocks by word address, blocks jump straight into
+      // each other through it while chain_budget lasts.
+      void (**blocks)(void *, void *) = nullptr;
+      uint32_t chain_budget = 0;
+
       CP2 cp2 = {};
       CP0 cp0;
    };
@@ -25,6 +25,10 @@ extern void DebugMessage(int level, const char *message, ...);
 #include "plugin.h"
 #include "msg.h"
 
+#ifdef HAVE_RDP_DUMP
+#include "../../mupen64plus-video-paraLLEl/rdp_dump.h"
+#endif
+
 int retro_return(int just_flipping);
 
 #ifdef __cplusplus
@@ -45,6 +49,7 @@ static struct core_config config;
 
 static unsigned angrylion_filtering = 0;
 static unsigned angrylion_dithering = 1;
+static unsigned angrylion_async = 0;
 
 static uint32_t rdram_size;
 static uint8_t rdram_hidden_bits[0x400000];
@@ -111,6 +116,29 @@ unsigned angrylion_get_dithering(void)
    return angrylion_dithering;
 }
 
+void angrylion_set_async(unsigned value)
+{
+   angrylion_async = value;
+}
+
+// whether the RDP thread of the asynchronous mode is running
+unsigned angrylion_async_active(void)
+{
+   return config.dp.async;
+}
+
+// the core holds back the DP interrupt while the RDP thread hasn't run a
+// full sync yet, and waits for it when the interrupt event fires
+unsigned angrylion_dp_sync_pending(void)
+{
+   return rdp_sync_pending();
+}
+
+void angrylion_dp_sync_wait(void)
+{
+   rdp_sync_wait();
+}
+
 void angrylionChangeWindow (void)
 {
 }
@@ -191,6 +219,14 @@ int angrylionRomOpen(void)
 	config.vi.mode = (vi_mode)0;
 	config.vi.widescreen = 0;
 	config.vi.overscan = 1;
+	config.dp.async = angrylion_async != 0;
+
+#ifdef HAVE_RDP_DUMP
+	// record all RDP command lists for replay with al-replay
+	const char *env = getenv("RDP_DUMP");
+	if (env)
+		config.dp.trace_record = rdp_dump_init(env, 8 * 1024 * 1024);
+#endif
 
 	core_init(&config);
    return 1;
@@ -227,16 +263,31 @@ void angrylionViWidthChanged (void)
 {
 }
 
+// the core only calls these for images reported below, which are only
+// reported in asynchronous mode while the RDP thread may still write them
 void angrylionFBWrite(unsigned int addr, unsigned int size)
 {
+   rdp_wait();
 }
 
 void angrylionFBRead(unsigned int addr)
 {
+   rdp_wait();
 }
 
 void angrylionFBGetFrameBufferInfo(void *pinfo)
 {
+   FrameBufferInfo* info = (FrameBufferInfo*)pinfo;
+   struct rdp_image images[6];
+   uint32_t i, num = rdp_get_pending_images(images, 6);
+
+   for (i = 0; i < 6; i++)
+   {
+      info[i].addr   = i < num ? images[i].addr : 0;
+      info[i].size   = i < num ? images[i].size : 0;
+      info[i].width  = i < num ? images[i].width : 0;
+      info[i].height = i < num ? images[i].height : 0;
+   }
 }
 
 m64p_error angrylionPluginGetVersion(m64p_plugin_type *PluginType, int *PluginVersion, int *APIVersion, const char **PluginNamePtr, int *Capabilities)
@@ -395,6 +446,14 @@ void core_dp_sync(void)
       }
    }
 
+   // in asynchronous mode the core raises the interrupt once the sync ran,
+   // see angrylion_dp_sync_pending
+   if (!config.dp.async)
+      core_dp_interrupt();
+}
+
+void core_dp_interrupt(void)
+{
    // signal plugin to handle interrupts
    *gfx_info.MI_INTR_REG |= DP_INTERRUPT;
    gfx_info.CheckInterrupts();
@@ -418,11 +477,19 @@ void core_dp_update(void)
 
 void core_vi_update(void)
 {
+    // the VI needs the finished frame
+    rdp_wait();
     vi_update();
 }
 
 void core_close(void)
 {
+#ifdef HAVE_RDP_DUMP
+    if (config.dp.trace_record)
+        rdp_dump_end();
+#endif
+
+    rdp_close();
     parallel_close();
     vi_close();
 }
@@ -48,6 +48,7 @@ struct core_config
 {
     struct {
         bool trace_record;
+        bool async;
     } dp;
     struct {
         enum vi_mode mode;
@@ -67,6 +68,7 @@ void core_close(void);
 void core_config_update(struct core_config* config);
 void core_config_defaults(struct core_config* config);
 void core_dp_sync(void);
+void core_dp_interrupt(void);
 void core_dp_update(void);
 void core_vi_update(void);
 void screen_swap(void);
@@ -1,5 +1,6 @@
 #include "parallel_c.hpp"
 #include "common.h"
+#include "main/trace.h"
 
 #include <functional>
 #include <vector>
@@ -26,8 +27,9 @@ private:
    std::mutex m_mutex;
    std::condition_variable m_signal_work;
    std::condition_variable m_signal_done;
-   std::atomic_size_t m_workers_active;
+   std::atomic_size_t m_workers_active{0};
    std::atomic_bool m_accept_work{true};
+   uint64_t m_task_id = 0;
 
    void do_work();
    void wait();
@@ -75,7 +77,10 @@ Parallel::~Parallel()
       m_task = []() {};
 
    // exit worker main loops
-   m_accept_work = false;
+   {
+      std::unique_lock<std::mutex> ul(m_mutex);
+      m_accept_work = false;
+   }
    m_signal_work.notify_all();
 
    // join worker threads to make sure they have finished
@@ -92,9 +97,14 @@ void Parallel::run(std::function<void(void)>&& task)
    if (!m_accept_work)
       throw std::runtime_error("Workers are exiting and no longer accept work");
 
-   // prepare task for workers and send signal so they start working
-   m_task           = task;
-   m_workers_active = m_workers.size();
+   // prepare task for workers and send signal so they start working, the
+   // task ID lets workers that weren't waiting yet still pick it up
+   {
+      std::unique_lock<std::mutex> ul(m_mutex);
+      m_task           = task;
+      m_workers_active = m_workers.size();
+      m_task_id++;
+   }
    m_signal_work.notify_all();
 
    // wait for all workers to finish
@@ -109,11 +119,21 @@ void Parallel::do_work()
       if (thread.m_thread.get_id() == std::this_thread::get_id())
          parallel_worker = &thread;
 
-   while (m_accept_work)
+   trace_thread_name("rdp worker");
+
+   uint64_t task_id = 0;
+
+   while (true)
    {
-      m_signal_work.wait(ul);
+      m_signal_work.wait(ul, [&] { return m_task_id != task_id || !m_accept_work; });
+      if (!m_accept_work)
+         break;
+
+      task_id = m_task_id;
       ul.unlock();
+      int64_t start = trace_begin();
       m_task();
+      trace_end(TRACE_RDP_WORKER, start);
       ul.lock();
       m_workers_active--;
       m_signal_done.notify_all();
@@ -151,6 +151,7 @@ public:
       void (*fbread2_ptr)(uint32_t, uint32_t*);
       void (*fbwrite_ptr)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
       void (*tcdiv_ptr)(int32_t, int32_t, int32_t, int32_t*, int32_t*);
+      void (*render_spans_ptr)(int, int, int, int);
 
       struct
       {
@@ -265,6 +266,13 @@ public:
          int32_t *alphasub_b[2];
          int32_t *alphamul[2];
          int32_t *alphaadd[2];
+
+         int rgb_op[2];
+         int alpha_op[2];
+         int32_t rgb_const_r[2];
+         int32_t rgb_const_g[2];
+         int32_t rgb_const_b[2];
+         int32_t alpha_const[2];
       } combiner;
 
    } globals;
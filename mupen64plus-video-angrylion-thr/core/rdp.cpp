@@ -1,6 +1,10 @@
 #include <memory.h>
 #include <string.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
 #include <retro_miscellaneous.h>
 
 #include "rdp.h"
@@ -15,6 +19,11 @@ extern "C" {
 
 #include "plugin.h"
 #include "msg.h"
+#include "main/trace.h"
+
+#ifdef HAVE_RDP_DUMP
+#include "../../mupen64plus-video-paraLLEl/rdp_dump.h"
+#endif
 
 #ifdef __cplusplus
 }
@@ -111,6 +120,10 @@ extern "C" {
 
 #define CMD_BUFFER_COUNT        1024
 
+// command words the asynchronous RDP thread can have queued, power of two
+#define ASYNC_QUEUE_SIZE        0x40000
+#define ASYNC_MAX_IMAGES        6
+
 #define CVG_CLAMP               0
 #define CVG_WRAP                1
 #define CVG_ZAP                 2
@@ -121,6 +134,22 @@ extern "C" {
 #define ZMODE_TRANSPARENT       2
 #define ZMODE_DECAL             3
 
+#define COMBINER_OP_FULL        0
+#define COMBINER_OP_ADD         1
+#define COMBINER_OP_CONST       2
+
+// template argument for a span renderer state bit that is left to run-time
+#define SPAN_ANY                -1
+#define SPAN_STATE(param, runtime)  ((param) == SPAN_ANY ? (runtime) : (param))
+
+// RDRAM accessors for span pixels; direct is set when the whole span was range
+// checked up front, which drops the masking and bounds check of every access
+#define SPAN_RREADIDX16(direct, rdst, in) {(rdst) = (direct) ? rdram_read_idx16_direct((in)) : rdram_read_idx16((in));}
+#define SPAN_RREADIDX32(direct, rdst, in) {(rdst) = (direct) ? rdram_read_idx32_direct((in)) : rdram_read_idx32((in));}
+#define SPAN_PAIRREAD16(direct, rdst, hdst, in) {if (direct) rdram_read_pair16_direct(&rdst, &hdst, (in)); else PAIRREAD16(rdst, hdst, in);}
+#define SPAN_PAIRWRITE16(direct, in, rval, hval) {if (direct) rdram_write_pair16_direct((in), (rval), (hval)); else PAIRWRITE16(in, rval, hval);}
+#define SPAN_PAIRWRITE32(direct, in, rval, hval0, hval1) {if (direct) rdram_write_pair32_direct((in), (rval), (hval0), (hval1)); else PAIRWRITE32(in, rval, hval0, hval1);}
+
 /* END OF DEFINES */
 
 /* START OF STRUCTS */
@@ -175,6 +204,10 @@ static uint32_t ptr_onstart = 0;
 static uint32_t rdp_cmd_buf[CMD_BUFFER_COUNT][CMD_MAX_INTS];
 static uint32_t rdp_cmd_buf_pos;
 
+#ifdef HAVE_RDP_DUMP
+static bool rdp_dump_active;
+#endif
+
 static const uint8_t bayer_matrix[16] =
 {
      0,  4,  1, 5,
@@ -430,7 +463,257 @@ void rdp_cmd(const uint32_t* arg, uint32_t length)
         rdp_cmd_push(arg, length);
 }
 
-void rdp_update(void)
+// Asynchronous mode: rdp_update only copies complete commands into a queue on
+// the CPU thread and a dedicated thread runs them. The queue is a ring of
+// command words; pending is private to rdp_update, head and tail are guarded
+// by the mutex.
+static struct
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable signal_work;
+    std::condition_variable signal_done;
+    std::vector<uint32_t> queue;
+    uint32_t pending;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t space;
+    bool exit;
+
+    // full syncs queued by the CPU thread and run by the RDP thread, the DP
+    // interrupt waits until both match
+    uint32_t syncs_queued;
+    uint32_t syncs_done;
+
+    // images written by commands that may still be queued, only used on the
+    // CPU thread
+    struct rdp_image images[ASYNC_MAX_IMAGES];
+    uint32_t num_images;
+    struct rdp_image color_image;
+    uint32_t zb_address;
+    bool images_changed;
+} rdp_async;
+
+static void rdp_async_run(Worker* worker)
+{
+    uint32_t cmd[CMD_MAX_INTS];
+    uint32_t i, pos, end, length, syncs;
+
+    // singlethreaded commands use the same worker as the thread that called
+    // rdp_init, like they would in synchronous mode
+    parallel_worker = worker;
+
+    trace_thread_name("rdp");
+
+    std::unique_lock<std::mutex> ul(rdp_async.mutex);
+
+    while (true)
+    {
+        rdp_async.signal_work.wait(ul, [] { return rdp_async.head != rdp_async.tail || rdp_async.exit; });
+
+        // finish everything queued before exiting
+        if (rdp_async.head == rdp_async.tail)
+            break;
+
+        pos = rdp_async.tail;
+        end = rdp_async.head;
+        syncs = 0;
+        ul.unlock();
+
+        int64_t start = trace_begin();
+
+        while (pos != end)
+        {
+            length = rdp_commands[CMD_ID(&rdp_async.queue[pos])].length >> 2;
+            for (i = 0; i < length; i++)
+                cmd[i] = rdp_async.queue[(pos + i) & (ASYNC_QUEUE_SIZE - 1)];
+
+            rdp_cmd(cmd, length);
+            pos = (pos + length) & (ASYNC_QUEUE_SIZE - 1);
+
+            if (CMD_ID(cmd) == CMD_ID_SYNC_FULL)
+                syncs++;
+        }
+
+        trace_end(TRACE_RDP_BATCH, start);
+
+        ul.lock();
+        rdp_async.tail = end;
+        rdp_async.syncs_done += syncs;
+        rdp_async.signal_done.notify_all();
+    }
+}
+
+static uint32_t rdp_async_space(void)
+{
+    // one word stays unused so that a full queue differs from an empty one
+    return (rdp_async.tail - rdp_async.pending - 1) & (ASYNC_QUEUE_SIZE - 1);
+}
+
+static void rdp_async_publish(void)
+{
+    {
+        std::unique_lock<std::mutex> ul(rdp_async.mutex);
+        rdp_async.head = rdp_async.pending;
+    }
+    rdp_async.signal_work.notify_one();
+}
+
+static void rdp_async_track_images(uint32_t cmd_id, const uint32_t* arg)
+{
+    struct rdp_image image;
+    uint32_t i;
+    int k;
+
+    switch (cmd_id)
+    {
+        case CMD_ID_SET_COLOR_IMAGE:
+        {
+            uint32_t size = (arg[0] >> 19) & 3;
+            rdp_async.color_image.addr = arg[1] & 0x0ffffff;
+            rdp_async.color_image.size = size ? 1 << (size - 1) : 1;
+            rdp_async.color_image.width = (arg[0] & 0x3ff) + 1;
+            rdp_async.images_changed = true;
+            return;
+        }
+        case CMD_ID_SET_MASK_IMAGE:
+            rdp_async.zb_address = arg[1] & 0x0ffffff;
+            rdp_async.images_changed = true;
+            return;
+        case CMD_ID_SET_SCISSOR:
+            // lower right corner, u10.2
+            rdp_async.color_image.height = ((arg[1] & 0xfff) + 3) >> 2;
+            rdp_async.images_changed = true;
+            return;
+        case CMD_ID_TEXTURE_RECTANGLE:
+        case CMD_ID_TEXTURE_RECTANGLE_FLIP:
+        case CMD_ID_FILL_RECTANGLE:
+            break;
+        default:
+            // anything else but triangles doesn't write to an image
+            if (cmd_id < CMD_ID_FILL_TRIANGLE || cmd_id > CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE)
+                return;
+    }
+
+    if (!rdp_async.images_changed)
+        return;
+
+    rdp_async.images_changed = false;
+
+    image = rdp_async.color_image;
+    for (k = 0; k < 2; k++)
+    {
+        for (i = 0; i < rdp_async.num_images; i++)
+        {
+            if (rdp_async.images[i].addr == image.addr)
+            {
+                rdp_async.images[i].size = MAX(rdp_async.images[i].size, image.size);
+                rdp_async.images[i].width = MAX(rdp_async.images[i].width, image.width);
+                rdp_async.images[i].height = MAX(rdp_async.images[i].height, image.height);
+                break;
+            }
+        }
+
+        // with too many images around, the last slot keeps the latest one
+        if (i == rdp_async.num_images)
+        {
+            if (rdp_async.num_images < ASYNC_MAX_IMAGES)
+                rdp_async.num_images++;
+            rdp_async.images[rdp_async.num_images - 1] = image;
+        }
+
+        // depth buffer, assuming that triangles may update it
+        if (cmd_id > CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE)
+            break;
+
+        image.addr = rdp_async.zb_address;
+        image.size = 2;
+    }
+}
+
+static void rdp_async_cmd(const uint32_t* arg, uint32_t length)
+{
+    uint32_t cmd_id = CMD_ID(arg);
+    uint32_t i;
+
+    rdp_async_track_images(cmd_id, arg);
+
+    if (rdp_async.space < length)
+    {
+        // let the thread work on what is queued so far until there's room
+        std::unique_lock<std::mutex> ul(rdp_async.mutex);
+        rdp_async.head = rdp_async.pending;
+        rdp_async.signal_work.notify_one();
+        rdp_async.signal_done.wait(ul, [length] { return rdp_async_space() >= length; });
+        rdp_async.space = rdp_async_space();
+    }
+
+    for (i = 0; i < length; i++)
+        rdp_async.queue[(rdp_async.pending + i) & (ASYNC_QUEUE_SIZE - 1)] = arg[i];
+
+    rdp_async.pending = (rdp_async.pending + length) & (ASYNC_QUEUE_SIZE - 1);
+    rdp_async.space -= length;
+
+    // games reuse texture, TLUT and list memory once they see the DP
+    // interrupt, so the core only raises it after the thread ran the sync
+    if (cmd_id == CMD_ID_SYNC_FULL)
+        rdp_async.syncs_queued++;
+}
+
+void rdp_wait(void)
+{
+    if (!rdp_async.thread.joinable())
+        return;
+
+    std::unique_lock<std::mutex> ul(rdp_async.mutex);
+    rdp_async.signal_done.wait(ul, [] { return rdp_async.head == rdp_async.tail; });
+
+    rdp_async.num_images = 0;
+    rdp_async.images_changed = true;
+}
+
+bool rdp_sync_pending(void)
+{
+    if (!rdp_async.thread.joinable())
+        return false;
+
+    std::unique_lock<std::mutex> ul(rdp_async.mutex);
+    return rdp_async.syncs_done != rdp_async.syncs_queued;
+}
+
+void rdp_sync_wait(void)
+{
+    if (!rdp_async.thread.joinable())
+        return;
+
+    std::unique_lock<std::mutex> ul(rdp_async.mutex);
+    rdp_async.signal_done.wait(ul, [] { return rdp_async.syncs_done == rdp_async.syncs_queued; });
+}
+
+uint32_t rdp_get_pending_images(struct rdp_image* images, uint32_t count)
+{
+    uint32_t num = MIN(count, rdp_async.num_images);
+    memcpy(images, rdp_async.images, num * sizeof(*images));
+    return num;
+}
+
+void rdp_close(void)
+{
+    if (!rdp_async.thread.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> ul(rdp_async.mutex);
+        rdp_async.exit = true;
+    }
+    rdp_async.signal_work.notify_one();
+    rdp_async.thread.join();
+
+    rdp_async.queue.clear();
+    rdp_async.queue.shrink_to_fit();
+}
+
+static void rdp_read_commands(void)
 {
     int i, length;
     uint32_t cmd, cmd_length;
@@ -489,6 +772,8 @@ void rdp_update(void)
         {
             if (!remaining_length)
             {
+                if (config->dp.async)
+                    rdp_async_publish();
 
                 *dp_reg[DP_START] = *dp_reg[DP_CURRENT] = *dp_reg[DP_END];
                 return;
@@ -501,16 +786,51 @@ void rdp_update(void)
             }
         }
 
-        rdp_cmd(rdp_cmd_data + rdp_cmd_cur, cmd_length);
+#ifdef HAVE_RDP_DUMP
+        if (config->dp.trace_record)
+        {
+            // flush out changes in RDRAM before the first command of a list
+            if (!rdp_dump_active)
+            {
+                rdp_wait();
+                rdp_dump_flush_dram(plugin_get_rdram(), plugin_get_rdram_size());
+                rdp_dump_begin_command_list();
+                rdp_dump_active = true;
+            }
+
+            rdp_dump_emit_command(cmd, rdp_cmd_data + rdp_cmd_cur, cmd_length);
+
+            if (cmd == CMD_ID_SYNC_FULL)
+            {
+                rdp_dump_end_command_list();
+                rdp_dump_active = false;
+            }
+        }
+#endif
+
+        if (config->dp.async)
+            rdp_async_cmd(rdp_cmd_data + rdp_cmd_cur, cmd_length);
+        else
+            rdp_cmd(rdp_cmd_data + rdp_cmd_cur, cmd_length);
         rdp_cmd_cur += cmd_length;
     };
     rdp_cmd_ptr = 0;
     rdp_cmd_cur = 0;
     };
 
+    if (config->dp.async)
+        rdp_async_publish();
+
     *dp_reg[DP_START] = *dp_reg[DP_CURRENT] = *dp_reg[DP_END];
 }
 
+void rdp_update(void)
+{
+    int64_t start = trace_begin();
+    rdp_read_commands();
+    trace_end(TRACE_RDP_UPDATE, start);
+}
+
 static STRICTINLINE void rgb_dither(int* r, int* g, int* b, int dith)
 {
 
@@ -1263,24 +1583,38 @@ static STRICTINLINE void combiner_1cycle(int adseed, uint32_t* curpixel_cvg)
         chromabypass.b = *parallel_worker->globals.combiner.rgbsub_a_b[1];
     }
 
-    if (parallel_worker->globals.combiner.rgbmul_r[1] != &zero_color)
+    switch (parallel_worker->globals.combiner.rgb_op[1])
     {
-        parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[1],*parallel_worker->globals.combiner.rgbsub_b_r[1],*parallel_worker->globals.combiner.rgbmul_r[1],*parallel_worker->globals.combiner.rgbadd_r[1]);
-        parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[1],*parallel_worker->globals.combiner.rgbsub_b_g[1],*parallel_worker->globals.combiner.rgbmul_g[1],*parallel_worker->globals.combiner.rgbadd_g[1]);
-        parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[1],*parallel_worker->globals.combiner.rgbsub_b_b[1],*parallel_worker->globals.combiner.rgbmul_b[1],*parallel_worker->globals.combiner.rgbadd_b[1]);
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.r = parallel_worker->globals.combiner.rgb_const_r[1];
+            parallel_worker->globals.combined_color.g = parallel_worker->globals.combiner.rgb_const_g[1];
+            parallel_worker->globals.combined_color.b = parallel_worker->globals.combiner.rgb_const_b[1];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[1],*parallel_worker->globals.combiner.rgbsub_b_r[1],*parallel_worker->globals.combiner.rgbmul_r[1],*parallel_worker->globals.combiner.rgbadd_r[1]);
+            parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[1],*parallel_worker->globals.combiner.rgbsub_b_g[1],*parallel_worker->globals.combiner.rgbmul_g[1],*parallel_worker->globals.combiner.rgbadd_g[1]);
+            parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[1],*parallel_worker->globals.combiner.rgbsub_b_b[1],*parallel_worker->globals.combiner.rgbmul_b[1],*parallel_worker->globals.combiner.rgbadd_b[1]);
+            break;
     }
-    else
+
+    switch (parallel_worker->globals.combiner.alpha_op[1])
     {
-        parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.a = parallel_worker->globals.combiner.alpha_const[1];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[1]] & 0x1ff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[1],*parallel_worker->globals.combiner.alphasub_b[1],*parallel_worker->globals.combiner.alphamul[1],*parallel_worker->globals.combiner.alphaadd[1]);
+            break;
     }
 
-    if (parallel_worker->globals.combiner.alphamul[1] != &zero_color)
-        parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[1],*parallel_worker->globals.combiner.alphasub_b[1],*parallel_worker->globals.combiner.alphamul[1],*parallel_worker->globals.combiner.alphaadd[1]);
-    else
-        parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[1]] & 0x1ff;
-
     parallel_worker->globals.pixel_color.a = special_9bit_clamptable[parallel_worker->globals.combined_color.a];
     if (parallel_worker->globals.pixel_color.a == 0xff)
         parallel_worker->globals.pixel_color.a = 0x100;
@@ -1347,24 +1681,38 @@ static STRICTINLINE void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int
     int32_t keyalpha, temp;
     struct color chromabypass;
 
-    if (parallel_worker->globals.combiner.rgbmul_r[0] != &zero_color)
+    switch (parallel_worker->globals.combiner.rgb_op[0])
     {
-        parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[0],*parallel_worker->globals.combiner.rgbsub_b_r[0],*parallel_worker->globals.combiner.rgbmul_r[0],*parallel_worker->globals.combiner.rgbadd_r[0]);
-        parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[0],*parallel_worker->globals.combiner.rgbsub_b_g[0],*parallel_worker->globals.combiner.rgbmul_g[0],*parallel_worker->globals.combiner.rgbadd_g[0]);
-        parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[0],*parallel_worker->globals.combiner.rgbsub_b_b[0],*parallel_worker->globals.combiner.rgbmul_b[0],*parallel_worker->globals.combiner.rgbadd_b[0]);
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.r = parallel_worker->globals.combiner.rgb_const_r[0];
+            parallel_worker->globals.combined_color.g = parallel_worker->globals.combiner.rgb_const_g[0];
+            parallel_worker->globals.combined_color.b = parallel_worker->globals.combiner.rgb_const_b[0];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[0]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[0]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[0]] << 8) + 0x80) & 0x1ffff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[0],*parallel_worker->globals.combiner.rgbsub_b_r[0],*parallel_worker->globals.combiner.rgbmul_r[0],*parallel_worker->globals.combiner.rgbadd_r[0]);
+            parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[0],*parallel_worker->globals.combiner.rgbsub_b_g[0],*parallel_worker->globals.combiner.rgbmul_g[0],*parallel_worker->globals.combiner.rgbadd_g[0]);
+            parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[0],*parallel_worker->globals.combiner.rgbsub_b_b[0],*parallel_worker->globals.combiner.rgbmul_b[0],*parallel_worker->globals.combiner.rgbadd_b[0]);
+            break;
     }
-    else
+
+    switch (parallel_worker->globals.combiner.alpha_op[0])
     {
-        parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[0]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[0]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[0]] << 8) + 0x80) & 0x1ffff;
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.a = parallel_worker->globals.combiner.alpha_const[0];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[0]] & 0x1ff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[0],*parallel_worker->globals.combiner.alphasub_b[0],*parallel_worker->globals.combiner.alphamul[0],*parallel_worker->globals.combiner.alphaadd[0]);
+            break;
     }
 
-    if (parallel_worker->globals.combiner.alphamul[0] != &zero_color)
-        parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[0],*parallel_worker->globals.combiner.alphasub_b[0],*parallel_worker->globals.combiner.alphamul[0],*parallel_worker->globals.combiner.alphaadd[0]);
-    else
-        parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[0]] & 0x1ff;
-
 
 
     if (parallel_worker->globals.other_modes.alpha_compare_en)
@@ -1430,24 +1778,38 @@ static STRICTINLINE void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int
         chromabypass.b = *parallel_worker->globals.combiner.rgbsub_a_b[1];
     }
 
-    if (parallel_worker->globals.combiner.rgbmul_r[1] != &zero_color)
+    switch (parallel_worker->globals.combiner.rgb_op[1])
     {
-        parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[1],*parallel_worker->globals.combiner.rgbsub_b_r[1],*parallel_worker->globals.combiner.rgbmul_r[1],*parallel_worker->globals.combiner.rgbadd_r[1]);
-        parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[1],*parallel_worker->globals.combiner.rgbsub_b_g[1],*parallel_worker->globals.combiner.rgbmul_g[1],*parallel_worker->globals.combiner.rgbadd_g[1]);
-        parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[1],*parallel_worker->globals.combiner.rgbsub_b_b[1],*parallel_worker->globals.combiner.rgbmul_b[1],*parallel_worker->globals.combiner.rgbadd_b[1]);
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.r = parallel_worker->globals.combiner.rgb_const_r[1];
+            parallel_worker->globals.combined_color.g = parallel_worker->globals.combiner.rgb_const_g[1];
+            parallel_worker->globals.combined_color.b = parallel_worker->globals.combiner.rgb_const_b[1];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
+            parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.r = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[1],*parallel_worker->globals.combiner.rgbsub_b_r[1],*parallel_worker->globals.combiner.rgbmul_r[1],*parallel_worker->globals.combiner.rgbadd_r[1]);
+            parallel_worker->globals.combined_color.g = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[1],*parallel_worker->globals.combiner.rgbsub_b_g[1],*parallel_worker->globals.combiner.rgbmul_g[1],*parallel_worker->globals.combiner.rgbadd_g[1]);
+            parallel_worker->globals.combined_color.b = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[1],*parallel_worker->globals.combiner.rgbsub_b_b[1],*parallel_worker->globals.combiner.rgbmul_b[1],*parallel_worker->globals.combiner.rgbadd_b[1]);
+            break;
     }
-    else
+
+    switch (parallel_worker->globals.combiner.alpha_op[1])
     {
-        parallel_worker->globals.combined_color.r = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.g = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
-        parallel_worker->globals.combined_color.b = ((special_9bit_exttable[*parallel_worker->globals.combiner.rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
+        case COMBINER_OP_CONST:
+            parallel_worker->globals.combined_color.a = parallel_worker->globals.combiner.alpha_const[1];
+            break;
+        case COMBINER_OP_ADD:
+            parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[1]] & 0x1ff;
+            break;
+        default:
+            parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[1],*parallel_worker->globals.combiner.alphasub_b[1],*parallel_worker->globals.combiner.alphamul[1],*parallel_worker->globals.combiner.alphaadd[1]);
+            break;
     }
 
-    if (parallel_worker->globals.combiner.alphamul[1] != &zero_color)
-        parallel_worker->globals.combined_color.a = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[1],*parallel_worker->globals.combiner.alphasub_b[1],*parallel_worker->globals.combiner.alphamul[1],*parallel_worker->globals.combiner.alphaadd[1]);
-    else
-        parallel_worker->globals.combined_color.a = special_9bit_exttable[*parallel_worker->globals.combiner.alphaadd[1]] & 0x1ff;
-
     if (!parallel_worker->globals.other_modes.key_en)
     {
 
@@ -1566,6 +1928,8 @@ static void rdp_set_prim_color(const uint32_t* args)
     parallel_worker->globals.prim_color.g = (args[1] >> 16) & 0xff;
     parallel_worker->globals.prim_color.b = (args[1] >>  8) & 0xff;
     parallel_worker->globals.prim_color.a = (args[1] >>  0) & 0xff;
+
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
 }
 
 static void rdp_set_env_color(const uint32_t* args)
@@ -1574,6 +1938,8 @@ static void rdp_set_env_color(const uint32_t* args)
     parallel_worker->globals.env_color.g = (args[1] >> 16) & 0xff;
     parallel_worker->globals.env_color.b = (args[1] >>  8) & 0xff;
     parallel_worker->globals.env_color.a = (args[1] >>  0) & 0xff;
+
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
 }
 
 static void rdp_set_combine(const uint32_t* args)
@@ -1626,6 +1992,8 @@ static void rdp_set_key_gb(const uint32_t* args)
     parallel_worker->globals.key_scale.g   = (args[1] >> 16) & 0xff;
     parallel_worker->globals.key_center.b  = (args[1] >> 8) & 0xff;
     parallel_worker->globals.key_scale.b   = args[1] & 0xff;
+
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
 }
 
 static void rdp_set_key_r(const uint32_t* args)
@@ -1633,6 +2001,60 @@ static void rdp_set_key_r(const uint32_t* args)
     parallel_worker->globals.key_width.r  = (args[1] >> 16) & 0xfff;
     parallel_worker->globals.key_center.r = (args[1] >> 8) & 0xff;
     parallel_worker->globals.key_scale.r  = args[1] & 0xff;
+
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
+}
+
+static int combiner_input_is_const(const int32_t* input)
+{
+    return input == &one_color || input == &zero_color ||
+        input == &parallel_worker->globals.prim_color.r || input == &parallel_worker->globals.prim_color.g ||
+        input == &parallel_worker->globals.prim_color.b || input == &parallel_worker->globals.prim_color.a ||
+        input == &parallel_worker->globals.env_color.r || input == &parallel_worker->globals.env_color.g ||
+        input == &parallel_worker->globals.env_color.b || input == &parallel_worker->globals.env_color.a ||
+        input == &parallel_worker->globals.key_center.r || input == &parallel_worker->globals.key_center.g ||
+        input == &parallel_worker->globals.key_center.b || input == &parallel_worker->globals.key_scale.r ||
+        input == &parallel_worker->globals.key_scale.g || input == &parallel_worker->globals.key_scale.b ||
+        input == &parallel_worker->globals.k4 || input == &parallel_worker->globals.k5 ||
+        input == &parallel_worker->globals.primitive_lod_frac;
+}
+
+/*
+ * Reduces one combiner cycle to the cheapest form that gives the same
+ * result: a value folded from per-primitive constants, the add input alone
+ * when the multiply or subtract term cancels, or the full equation.
+ */
+static void combiner_compile(int cycle)
+{
+    if (combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_a_r[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_a_g[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_a_b[cycle]) &&
+        combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_b_r[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_b_g[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbsub_b_b[cycle]) &&
+        combiner_input_is_const(parallel_worker->globals.combiner.rgbmul_r[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbmul_g[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbmul_b[cycle]) &&
+        combiner_input_is_const(parallel_worker->globals.combiner.rgbadd_r[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbadd_g[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.rgbadd_b[cycle]))
+    {
+        parallel_worker->globals.combiner.rgb_op[cycle] = COMBINER_OP_CONST;
+        parallel_worker->globals.combiner.rgb_const_r[cycle] = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_r[cycle],*parallel_worker->globals.combiner.rgbsub_b_r[cycle],*parallel_worker->globals.combiner.rgbmul_r[cycle],*parallel_worker->globals.combiner.rgbadd_r[cycle]);
+        parallel_worker->globals.combiner.rgb_const_g[cycle] = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_g[cycle],*parallel_worker->globals.combiner.rgbsub_b_g[cycle],*parallel_worker->globals.combiner.rgbmul_g[cycle],*parallel_worker->globals.combiner.rgbadd_g[cycle]);
+        parallel_worker->globals.combiner.rgb_const_b[cycle] = color_combiner_equation(*parallel_worker->globals.combiner.rgbsub_a_b[cycle],*parallel_worker->globals.combiner.rgbsub_b_b[cycle],*parallel_worker->globals.combiner.rgbmul_b[cycle],*parallel_worker->globals.combiner.rgbadd_b[cycle]);
+    }
+    else if (parallel_worker->globals.combiner.rgbmul_r[cycle] == &zero_color ||
+        (parallel_worker->globals.combiner.rgbsub_a_r[cycle] == parallel_worker->globals.combiner.rgbsub_b_r[cycle] &&
+         parallel_worker->globals.combiner.rgbsub_a_g[cycle] == parallel_worker->globals.combiner.rgbsub_b_g[cycle] &&
+         parallel_worker->globals.combiner.rgbsub_a_b[cycle] == parallel_worker->globals.combiner.rgbsub_b_b[cycle]))
+        parallel_worker->globals.combiner.rgb_op[cycle] = COMBINER_OP_ADD;
+    else
+        parallel_worker->globals.combiner.rgb_op[cycle] = COMBINER_OP_FULL;
+
+    if (combiner_input_is_const(parallel_worker->globals.combiner.alphasub_a[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.alphasub_b[cycle]) &&
+        combiner_input_is_const(parallel_worker->globals.combiner.alphamul[cycle]) && combiner_input_is_const(parallel_worker->globals.combiner.alphaadd[cycle]))
+    {
+        parallel_worker->globals.combiner.alpha_op[cycle] = COMBINER_OP_CONST;
+        parallel_worker->globals.combiner.alpha_const[cycle] = alpha_combiner_equation(*parallel_worker->globals.combiner.alphasub_a[cycle],*parallel_worker->globals.combiner.alphasub_b[cycle],*parallel_worker->globals.combiner.alphamul[cycle],*parallel_worker->globals.combiner.alphaadd[cycle]);
+    }
+    else if (parallel_worker->globals.combiner.alphamul[cycle] == &zero_color ||
+        parallel_worker->globals.combiner.alphasub_a[cycle] == parallel_worker->globals.combiner.alphasub_b[cycle])
+        parallel_worker->globals.combiner.alpha_op[cycle] = COMBINER_OP_ADD;
+    else
+        parallel_worker->globals.combiner.alpha_op[cycle] = COMBINER_OP_FULL;
 }
 
 static STRICTINLINE uint32_t rightcvghex(uint32_t x, uint32_t fmask)
@@ -2004,11 +2426,11 @@ static INLINE void z_build_com_table(void)
    }
 }
 
-static STRICTINLINE void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc)
+static STRICTINLINE void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc, int direct)
 {
     uint16_t zval = z_com_table[z & 0x3ffff]|(dzpixenc >> 2);
     uint8_t hval = dzpixenc & 3;
-    PAIRWRITE16(zcurpixel, zval, hval);
+    SPAN_PAIRWRITE16(direct, zcurpixel, zval, hval);
 }
 
 static STRICTINLINE uint32_t dz_decompress(uint32_t dz_compressed)
@@ -2031,7 +2453,8 @@ static STRICTINLINE uint32_t dz_compress(uint32_t value)
     return j;
 }
 
-static STRICTINLINE uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
+template <int zcmp>
+static STRICTINLINE uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg, int direct)
 {
    uint8_t hval;
    uint16_t zval;
@@ -2040,7 +2463,7 @@ static STRICTINLINE uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t
    int force_coplanar = 0;
    sz &= 0x3ffff;
 
-   if (parallel_worker->globals.other_modes.z_compare_en)
+   if (SPAN_STATE(zcmp, parallel_worker->globals.other_modes.z_compare_en))
    {
       int cvgcoeff = 0;
       uint32_t dzenc = 0;
@@ -2049,7 +2472,7 @@ static STRICTINLINE uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t
       uint32_t nearer, max, infront;
       uint32_t dzmemmodifier;
 
-      PAIRREAD16(zval, hval, zcurpixel);
+      SPAN_PAIRREAD16(direct, zval, hval, zcurpixel);
       oz = z_decompress(zval);
       rawdzmem = ((zval & 3) << 2) | hval;
       dzmem = dz_decompress(rawdzmem);
@@ -2209,30 +2632,36 @@ void z_init(void)
 
 static void fbwrite_4(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
 static void fbwrite_8(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
+template <int direct>
 static void fbwrite_16(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
+template <int direct>
 static void fbwrite_32(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
 static void fbread_4(uint32_t num, uint32_t* curpixel_memcvg);
 static void fbread_8(uint32_t num, uint32_t* curpixel_memcvg);
+template <int direct>
 static void fbread_16(uint32_t num, uint32_t* curpixel_memcvg);
+template <int direct>
 static void fbread_32(uint32_t num, uint32_t* curpixel_memcvg);
 static void fbread2_4(uint32_t num, uint32_t* curpixel_memcvg);
 static void fbread2_8(uint32_t num, uint32_t* curpixel_memcvg);
+template <int direct>
 static void fbread2_16(uint32_t num, uint32_t* curpixel_memcvg);
+template <int direct>
 static void fbread2_32(uint32_t num, uint32_t* curpixel_memcvg);
 
 static void (*fbread_func[4])(uint32_t, uint32_t*) =
 {
-    fbread_4, fbread_8, fbread_16, fbread_32
+    fbread_4, fbread_8, fbread_16<0>, fbread_32<0>
 };
 
 static void (*fbread2_func[4])(uint32_t, uint32_t*) =
 {
-    fbread2_4, fbread2_8, fbread2_16, fbread2_32
+    fbread2_4, fbread2_8, fbread2_16<0>, fbread2_32<0>
 };
 
 static void (*fbwrite_func[4])(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) =
 {
-    fbwrite_4, fbwrite_8, fbwrite_16, fbwrite_32
+    fbwrite_4, fbwrite_8, fbwrite_16<0>, fbwrite_32<0>
 };
 
 static void fbwrite_4(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
@@ -2247,6 +2676,7 @@ static void fbwrite_8(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uin
     PAIRWRITE8(fb, r & 0xff, (r & 1) ? 3 : 0);
 }
 
+template <int direct>
 static void fbwrite_16(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
 #undef CVG_DRAW
@@ -2276,9 +2706,10 @@ static void fbwrite_16(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, ui
 
     rval = finalcolor|(finalcvg >> 2);
     hval = finalcvg & 3;
-    PAIRWRITE16(fb, rval, hval);
+    SPAN_PAIRWRITE16(direct, fb, rval, hval);
 }
 
+template <int direct>
 static void fbwrite_32(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
     uint32_t fb = (parallel_worker->globals.fb_address >> 2) + curpixel;
@@ -2289,7 +2720,7 @@ static void fbwrite_32(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, ui
     finalcolor = (r << 24) | (g << 16) | (b << 8);
     finalcolor |= (finalcvg << 5);
 
-    PAIRWRITE32(fb, finalcolor, (g & 1) ? 3 : 0, 0);
+    SPAN_PAIRWRITE32(direct, fb, finalcolor, (g & 1) ? 3 : 0, 0);
 }
 
 static void fbfill_4(uint32_t curpixel)
@@ -2324,6 +2755,18 @@ static void fbfill_32(uint32_t curpixel)
     PAIRWRITE32(fb, parallel_worker->globals.fill_color, (parallel_worker->globals.fill_color & 0x10000) ? 3 : 0, (parallel_worker->globals.fill_color & 0x1) ? 3 : 0);
 }
 
+static void fbfill_span_16(uint32_t curpixel, uint32_t count)
+{
+    uint32_t fb = (parallel_worker->globals.fb_address >> 1) + curpixel;
+    rdram_fill_pair16(fb, count, parallel_worker->globals.fill_color, (parallel_worker->globals.fill_color & 0x10000) ? 3 : 0, (parallel_worker->globals.fill_color & 0x1) ? 3 : 0);
+}
+
+static void fbfill_span_32(uint32_t curpixel, uint32_t count)
+{
+    uint32_t fb = (parallel_worker->globals.fb_address >> 2) + curpixel;
+    rdram_fill_pair32(fb, count, parallel_worker->globals.fill_color, (parallel_worker->globals.fill_color & 0x10000) ? 3 : 0, (parallel_worker->globals.fill_color & 0x1) ? 3 : 0);
+}
+
 static void fbread_4(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
    parallel_worker->globals.memory_color.r = 0;
@@ -2365,6 +2808,7 @@ static void fbread2_8(uint32_t curpixel, uint32_t* curpixel_memcvg)
     *curpixel_memcvg = 7;
 }
 
+template <int direct>
 static void fbread_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
     uint16_t fword;
@@ -2376,7 +2820,7 @@ static void fbread_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
 
     if (parallel_worker->globals.other_modes.image_read_en)
     {
-        PAIRREAD16(fword, hbyte, addr);
+        SPAN_PAIRREAD16(direct, fword, hbyte, addr);
 
         if (parallel_worker->globals.fb_format == FORMAT_RGBA)
         {
@@ -2396,7 +2840,7 @@ static void fbread_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
     }
     else
     {
-        RREADIDX16(fword, addr);
+        SPAN_RREADIDX16(direct, fword, addr);
 
         if (parallel_worker->globals.fb_format == FORMAT_RGBA)
         {
@@ -2412,6 +2856,7 @@ static void fbread_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
     }
 }
 
+template <int direct>
 static void fbread2_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
     uint16_t fword;
@@ -2422,7 +2867,7 @@ static void fbread2_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
 
     if (parallel_worker->globals.other_modes.image_read_en)
     {
-        PAIRREAD16(fword, hbyte, addr);
+        SPAN_PAIRREAD16(direct, fword, hbyte, addr);
 
         if (parallel_worker->globals.fb_format == FORMAT_RGBA)
         {
@@ -2442,7 +2887,7 @@ static void fbread2_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
     }
     else
     {
-        RREADIDX16(fword, addr);
+        SPAN_RREADIDX16(direct, fword, addr);
 
         if (parallel_worker->globals.fb_format == FORMAT_RGBA)
         {
@@ -2459,10 +2904,11 @@ static void fbread2_16(uint32_t curpixel, uint32_t* curpixel_memcvg)
 
 }
 
+template <int direct>
 static void fbread_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
     uint32_t mem, addr = (parallel_worker->globals.fb_address >> 2) + curpixel;
-    RREADIDX32(mem, addr);
+    SPAN_RREADIDX32(direct, mem, addr);
     parallel_worker->globals.memory_color.r = (mem >> 24) & 0xff;
     parallel_worker->globals.memory_color.g = (mem >> 16) & 0xff;
     parallel_worker->globals.memory_color.b = (mem >> 8) & 0xff;
@@ -2478,10 +2924,11 @@ static void fbread_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
     }
 }
 
+template <int direct>
 static INLINE void fbread2_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
     uint32_t mem, addr = (parallel_worker->globals.fb_address >> 2) + curpixel;
-    RREADIDX32(mem, addr);
+    SPAN_RREADIDX32(direct, mem, addr);
     parallel_worker->globals.pre_memory_color.r = (mem >> 24) & 0xff;
     parallel_worker->globals.pre_memory_color.g = (mem >> 16) & 0xff;
     parallel_worker->globals.pre_memory_color.b = (mem >> 8) & 0xff;
@@ -2497,6 +2944,88 @@ static INLINE void fbread2_32(uint32_t curpixel, uint32_t* curpixel_memcvg)
     }
 }
 
+template <int fbsize>
+static STRICTINLINE void span_fbread(uint32_t curpixel, uint32_t* curpixel_memcvg, int direct)
+{
+    switch (fbsize)
+    {
+        case PIXEL_SIZE_16BIT: if (direct) fbread_16<1>(curpixel, curpixel_memcvg); else fbread_16<0>(curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_32BIT: if (direct) fbread_32<1>(curpixel, curpixel_memcvg); else fbread_32<0>(curpixel, curpixel_memcvg); break;
+        default: parallel_worker->globals.fbread1_ptr(curpixel, curpixel_memcvg); break;
+    }
+}
+
+template <int fbsize>
+static STRICTINLINE void span_fbread2(uint32_t curpixel, uint32_t* curpixel_memcvg, int direct)
+{
+    switch (fbsize)
+    {
+        case PIXEL_SIZE_16BIT: if (direct) fbread2_16<1>(curpixel, curpixel_memcvg); else fbread2_16<0>(curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_32BIT: if (direct) fbread2_32<1>(curpixel, curpixel_memcvg); else fbread2_32<0>(curpixel, curpixel_memcvg); break;
+        default: parallel_worker->globals.fbread2_ptr(curpixel, curpixel_memcvg); break;
+    }
+}
+
+template <int fbsize>
+static STRICTINLINE void span_fbwrite(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, int direct)
+{
+    switch (fbsize)
+    {
+        case PIXEL_SIZE_16BIT:
+            if (direct)
+                fbwrite_16<1>(curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg);
+            else
+                fbwrite_16<0>(curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg);
+            break;
+        case PIXEL_SIZE_32BIT:
+            if (direct)
+                fbwrite_32<1>(curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg);
+            else
+                fbwrite_32<0>(curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg);
+            break;
+        default: parallel_worker->globals.fbwrite_ptr(curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg); break;
+    }
+}
+
+// checks once per span whether every color and depth access of its length + 1
+// pixels from curpixel/zbcur lands inside RDRAM unmasked; only then the pixel
+// loop may use the direct accessors, everything else keeps the checked path
+template <int fbsize, int zcmp, int zupd>
+static STRICTINLINE int span_direct_access(int curpixel, int zbcur, int length, int flip)
+{
+    uint32_t count;
+
+    if (length < 0)
+        return 0;
+
+    count = length + 1;
+    if (!flip)
+    {
+        curpixel -= length;
+        zbcur -= length;
+    }
+
+    switch (fbsize)
+    {
+        case PIXEL_SIZE_16BIT:
+            if (!rdram_valid_range16((parallel_worker->globals.fb_address >> 1) + curpixel, count))
+                return 0;
+            break;
+        case PIXEL_SIZE_32BIT:
+            if (!rdram_valid_range32((parallel_worker->globals.fb_address >> 2) + curpixel, count))
+                return 0;
+            break;
+        default:
+            return 0;
+    }
+
+    if (SPAN_STATE(zcmp, parallel_worker->globals.other_modes.z_compare_en) ||
+        SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+        return rdram_valid_range16(zbcur, count);
+
+    return 1;
+}
+
 static void rdp_set_color_image(const uint32_t* args)
 {
     parallel_worker->globals.fb_format   = (args[0] >> 21) & 0x7;
@@ -2507,6 +3036,9 @@ static void rdp_set_color_image(const uint32_t* args)
     parallel_worker->globals.fbread1_ptr = fbread_func[parallel_worker->globals.fb_size];
     parallel_worker->globals.fbread2_ptr = fbread2_func[parallel_worker->globals.fb_size];
     parallel_worker->globals.fbwrite_ptr = fbwrite_func[parallel_worker->globals.fb_size];
+
+    // the span renderer is specialized on fb_size
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
 }
 
 static void rdp_set_fill_color(const uint32_t* args)
@@ -4479,6 +5011,17 @@ static void (*tcdiv_func[2])(int32_t, int32_t, int32_t, int32_t*, int32_t*) =
     tcdiv_nopersp, tcdiv_persp
 };
 
+template <int persp>
+static STRICTINLINE void span_tcdiv(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
+{
+    switch (persp)
+    {
+        case 0: tcdiv_nopersp(ss, st, sw, sss, sst); break;
+        case 1: tcdiv_persp(ss, st, sw, sss, sst); break;
+        default: parallel_worker->globals.tcdiv_ptr(ss, st, sw, sss, sst); break;
+    }
+}
+
 static int32_t maskbits_table[16];
 static int32_t log2table[256];
 static int32_t tcdiv_table[0x8000];
@@ -5756,6 +6299,7 @@ static INLINE void calculate_tile_derivs(uint32_t i)
     }
 }
 
+template <int persp>
 static STRICTINLINE void get_texel1_1cycle(int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, struct spansigs* sigs)
 {
     int32_t nexts, nextt, nextsw;
@@ -5774,9 +6318,10 @@ static STRICTINLINE void get_texel1_1cycle(int32_t* s1, int32_t* t1, int32_t s,
         nextsw = parallel_worker->globals.span[nextscan].w >> 16;
     }
 
-    parallel_worker->globals.tcdiv_ptr(nexts, nextt, nextsw, s1, t1);
+    span_tcdiv<persp>(nexts, nextt, nextsw, s1, t1);
 }
 
+template <int persp>
 static STRICTINLINE void get_nexttexel0_2cycle(int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc)
 {
 
@@ -5786,7 +6331,7 @@ static STRICTINLINE void get_nexttexel0_2cycle(int32_t* s1, int32_t* t1, int32_t
     nexts = (s + dsinc) >> 16;
     nextt = (t + dtinc) >> 16;
 
-    parallel_worker->globals.tcdiv_ptr(nexts, nextt, nextsw, s1, t1);
+    span_tcdiv<persp>(nexts, nextt, nextsw, s1, t1);
 }
 
 static STRICTINLINE void texture_pipeline_cycle(struct color* TEX, struct color* prev, int32_t SSS, int32_t SST, uint32_t tilenum, uint32_t cycle)
@@ -6538,6 +7083,8 @@ static void rdp_set_convert(const uint32_t* args)
     parallel_worker->globals.k3_tf = (SIGN(k3, 9) << 1) + 1;
     parallel_worker->globals.k4    = (args[1] >> 9) & 0x1ff;
     parallel_worker->globals.k5    = args[1] & 0x1ff;
+
+    parallel_worker->globals.other_modes.f.stalederivs = 1;
 }
 
 static void tex_init(void)
@@ -6716,9 +7263,11 @@ static STRICTINLINE void rgbaz_correct_clip(int offx, int offy, int r, int g, in
      *z    = zanded;
 }
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_1cycle_complete(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     struct spansigs sigs;
     uint32_t blend_en;
@@ -6815,6 +7364,8 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
 
 
         if (scdiff)
@@ -6858,7 +7409,7 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
             lookup_cvmask_derivatives(x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
 
-            get_texel1_1cycle(&news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
+            get_texel1_1cycle<persp>(&news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
 
 
 
@@ -6869,7 +7420,7 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
             }
             else
             {
-                parallel_worker->globals.tcdiv_ptr(ss, st, sw, &sss, &sst);
+                span_tcdiv<persp>(ss, st, sw, &sss, &sst);
 
                 tclod_1cycle_current(&sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
 
@@ -6901,15 +7452,15 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
 
             combiner_1cycle(adith, &curpixel_cvg);
 
-            parallel_worker->globals.fbread1_ptr(curpixel, &curpixel_memcvg);
+            span_fbread<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
 
@@ -6931,9 +7482,11 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
 }
 
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     struct spansigs sigs;
     uint32_t blend_en;
@@ -7025,6 +7578,8 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -7059,7 +7614,7 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
 
             lookup_cvmask_derivatives(x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            parallel_worker->globals.tcdiv_ptr(ss, st, sw, &sss, &sst);
+            span_tcdiv<persp>(ss, st, sw, &sss, &sst);
 
             tclod_1cycle_current_simple(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
 
@@ -7072,15 +7627,15 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
 
             combiner_1cycle(adith, &curpixel_cvg);
 
-            parallel_worker->globals.fbread1_ptr(curpixel, &curpixel_memcvg);
+            span_fbread<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
 
@@ -7102,9 +7657,11 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
 }
 
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     uint32_t blend_en;
     uint32_t prewrap;
@@ -7183,6 +7740,8 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -7210,15 +7769,15 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 
             combiner_1cycle(adith, &curpixel_cvg);
 
-            parallel_worker->globals.fbread1_ptr(curpixel, &curpixel_memcvg);
+            span_fbread<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_1cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
             r += drinc;
@@ -7235,9 +7794,11 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
     }
 }
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_2cycle_complete(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     struct spansigs sigs;
     int32_t prelodfrac;
@@ -7341,6 +7902,8 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
 
 
 
@@ -7376,7 +7939,7 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
 
             lookup_cvmask_derivatives(x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            get_nexttexel0_2cycle(&news, &newt, s, t, w, dsinc, dtinc, dwinc);
+            get_nexttexel0_2cycle<persp>(&news, &newt, s, t, w, dsinc, dtinc, dwinc);
 
             if (!sigs.startspan)
             {
@@ -7386,7 +7949,7 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
             }
             else
             {
-                parallel_worker->globals.tcdiv_ptr(ss, st, sw, &sss, &sst);
+                span_tcdiv<persp>(ss, st, sw, &sss, &sst);
 
                 tclod_2cycle_current(&sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
 
@@ -7414,15 +7977,15 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
 
             combiner_2cycle(adith, &curpixel_cvg, &acalpha);
 
-            parallel_worker->globals.fbread2_ptr(curpixel, &curpixel_memcvg);
+            span_fbread2<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
             else
@@ -7444,9 +8007,11 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
 
 
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     uint32_t blend_en;
     uint32_t prewrap;
@@ -7541,6 +8106,8 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -7567,7 +8134,7 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
 
             lookup_cvmask_derivatives(x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            parallel_worker->globals.tcdiv_ptr(ss, st, sw, &sss, &sst);
+            span_tcdiv<persp>(ss, st, sw, &sss, &sst);
 
             tclod_2cycle_current_simple(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2);
 
@@ -7581,15 +8148,15 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
 
             combiner_2cycle(adith, &curpixel_cvg, &acalpha);
 
-            parallel_worker->globals.fbread2_ptr(curpixel, &curpixel_memcvg);
+            span_fbread2<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
             else
@@ -7613,9 +8180,11 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
 }
 
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     uint32_t blend_en;
     uint32_t prewrap;
@@ -7709,6 +8278,8 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -7735,7 +8306,7 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
 
             lookup_cvmask_derivatives(x, &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            parallel_worker->globals.tcdiv_ptr(ss, st, sw, &sss, &sst);
+            span_tcdiv<persp>(ss, st, sw, &sss, &sst);
 
             tclod_2cycle_current_notexel1(&sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
 
@@ -7749,15 +8320,15 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
 
             combiner_2cycle(adith, &curpixel_cvg, &acalpha);
 
-            parallel_worker->globals.fbread2_ptr(curpixel, &curpixel_memcvg);
+            span_fbread2<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
 
             }
@@ -7782,9 +8353,11 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
 }
 
 
+template <int fbsize, int zcmp, int zupd, int persp>
 static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 {
     int zbcur;
+    int direct;
     uint8_t offx, offy;
     int i, j;
     uint32_t blend_en;
@@ -7864,6 +8437,8 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
             compute_cvg_flip(i);
         }
 
+        direct = span_direct_access<fbsize, zcmp, zupd>(curpixel, zbcur, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -7891,15 +8466,15 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 
             combiner_2cycle(adith, &curpixel_cvg, &acalpha);
 
-            parallel_worker->globals.fbread2_ptr(curpixel, &curpixel_memcvg);
+            span_fbread2<fbsize>(curpixel, &curpixel_memcvg, direct);
 
-            if (z_compare(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            if (z_compare<zcmp>(zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, direct))
             {
                 if (blender_2cycle(&fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit, acalpha))
                 {
-                    parallel_worker->globals.fbwrite_ptr(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (parallel_worker->globals.other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    span_fbwrite<fbsize>(curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, direct);
+                    if (SPAN_STATE(zupd, parallel_worker->globals.other_modes.z_update_en))
+                        z_store(zbcur, sz, dzpixenc, direct);
                 }
             }
             else
@@ -7960,13 +8535,13 @@ static void render_spans_fill(int start, int end, int flip)
                 rdp_pipeline_crashed = 1;
                 return;
             }
-
-
-
-
-
-
-
+            // fill mode never reads memory, so a whole span (color and z
+            // clears alike) goes out as one bulk store regardless of direction
+            if (length >= 0 && parallel_worker->globals.fb_size == PIXEL_SIZE_16BIT)
+               fbfill_span_16(flip ? curpixel : curpixel - length, length + 1);
+            else if (length >= 0 && parallel_worker->globals.fb_size == PIXEL_SIZE_32BIT)
+               fbfill_span_32(flip ? curpixel : curpixel - length, length + 1);
+            else
             for (j = 0; j <= length; j++)
             {
                switch(parallel_worker->globals.fb_size)
@@ -8136,6 +8711,11 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
                 copywmask = 8;
             tempdword = fbptr;
             k = 7;
+            if (alphamask == 0xff && copywmask == 8 && flip)
+            {
+                rdram_write_pair8x8(tempdword, (uint32_t)(copyqword >> 32), (uint32_t)copyqword);
+                copywmask = 0;
+            }
             while(copywmask > 0)
             {
                 tempbyte = (uint32_t)((copyqword >> (k << 3)) & 0xff);
@@ -8157,6 +8737,64 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
     }
 }
 
+/*
+ * Span renderers specialized on the color image size, z compare/update and
+ * perspective correction, indexed [variant][fb 16/32][zcmp][zupd][persp].
+ * Anything else (4/8-bit color images) runs the SPAN_ANY instantiations.
+ */
+typedef void (*render_spans_func)(int, int, int, int);
+
+#define SPAN_PERSP(fn, fb, zc, zu)  { fn<fb, zc, zu, 0>, fn<fb, zc, zu, 1> }
+#define SPAN_ZUPD(fn, fb, zc)       { SPAN_PERSP(fn, fb, zc, 0), SPAN_PERSP(fn, fb, zc, 1) }
+#define SPAN_ZCMP(fn, fb)           { SPAN_ZUPD(fn, fb, 0), SPAN_ZUPD(fn, fb, 1) }
+#define SPAN_VARIANTS(fn)           { SPAN_ZCMP(fn, PIXEL_SIZE_16BIT), SPAN_ZCMP(fn, PIXEL_SIZE_32BIT) }
+
+static const render_spans_func render_spans_1cycle_table[3][2][2][2][2] =
+{
+    SPAN_VARIANTS(render_spans_1cycle_complete),
+    SPAN_VARIANTS(render_spans_1cycle_notexel1),
+    SPAN_VARIANTS(render_spans_1cycle_notex)
+};
+
+static const render_spans_func render_spans_2cycle_table[4][2][2][2][2] =
+{
+    SPAN_VARIANTS(render_spans_2cycle_complete),
+    SPAN_VARIANTS(render_spans_2cycle_notexelnext),
+    SPAN_VARIANTS(render_spans_2cycle_notexel1),
+    SPAN_VARIANTS(render_spans_2cycle_notex)
+};
+
+#undef SPAN_PERSP
+#undef SPAN_ZUPD
+#undef SPAN_ZCMP
+#undef SPAN_VARIANTS
+
+static render_spans_func select_render_spans(void)
+{
+    int fb, zcmp, zupd, persp;
+
+    switch (parallel_worker->globals.fb_size)
+    {
+        case PIXEL_SIZE_16BIT: fb = 0; break;
+        case PIXEL_SIZE_32BIT: fb = 1; break;
+        default: return NULL;
+    }
+
+    zcmp = parallel_worker->globals.other_modes.z_compare_en;
+    zupd = parallel_worker->globals.other_modes.z_update_en;
+    persp = parallel_worker->globals.other_modes.persp_tex_en;
+
+    switch (parallel_worker->globals.other_modes.cycle_type)
+    {
+        case CYCLE_TYPE_1:
+            return render_spans_1cycle_table[parallel_worker->globals.other_modes.f.textureuselevel0][fb][zcmp][zupd][persp];
+        case CYCLE_TYPE_2:
+            return render_spans_2cycle_table[parallel_worker->globals.other_modes.f.textureuselevel1][fb][zcmp][zupd][persp];
+        default:
+            return NULL;
+    }
+}
+
 static void edgewalker_for_prims(int32_t* ewdata)
 {
     int j = 0;
@@ -8188,6 +8826,54 @@ static void edgewalker_for_prims(int32_t* ewdata)
     ym = SIGN(ym, 14);
     yh = SIGN(ewdata[1], 14);
 
+    uint32_t worker_id = parallel_worker->m_worker_id;
+    uint32_t worker_num = parallel_worker_num();
+
+    int32_t yllimit = 0, yhlimit = 0;
+    if (yl & 0x2000)
+        yllimit = 1;
+    else if (yl & 0x1000)
+        yllimit = 0;
+    else
+        yllimit = (yl & 0xfff) < parallel_worker->globals.clip.yl;
+    yllimit = yllimit ? yl : parallel_worker->globals.clip.yl;
+
+    int ylfar = yllimit | 3;
+    if ((yl >> 2) > (ylfar >> 2))
+        ylfar += 4;
+    else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023)
+        parallel_worker->globals.span[(yllimit >> 2) + 1].validline = 0;
+
+
+    if (yh & 0x2000)
+        yhlimit = 0;
+    else if (yh & 0x1000)
+        yhlimit = 1;
+    else
+        yhlimit = (yh >= parallel_worker->globals.clip.yh);
+    yhlimit = yhlimit ? yh : parallel_worker->globals.clip.yh;
+
+    int yhclose = yhlimit & ~3;
+
+    // nothing to walk if the scissor leaves no scanline of the primitive or
+    // none of the remaining ones belongs to this worker; copy and fill mode
+    // always go to their span renderers, which may crash the pipeline
+    if (parallel_worker->globals.other_modes.cycle_type == CYCLE_TYPE_1 ||
+        parallel_worker->globals.other_modes.cycle_type == CYCLE_TYPE_2)
+    {
+        if (yllimit <= yhlimit)
+            return;
+
+        if (config->parallel)
+        {
+            uint32_t firstrow = yhlimit >> 2;
+            uint32_t lastrow = (yllimit - 1) >> 2;
+            uint32_t ownrow = firstrow + (worker_id + worker_num - firstrow % worker_num) % worker_num;
+            if (ownrow > lastrow)
+                return;
+        }
+    }
+
     xl = SIGN(ewdata[2], 28);
     xh = SIGN(ewdata[4], 28);
     xm = SIGN(ewdata[6], 28);
@@ -8395,31 +9081,6 @@ static void edgewalker_for_prims(int32_t* ewdata)
     int invaly = 1;
     int length = 0;
     int32_t xrsc = 0, xlsc = 0, stickybit = 0;
-    int32_t yllimit = 0, yhlimit = 0;
-    if (yl & 0x2000)
-        yllimit = 1;
-    else if (yl & 0x1000)
-        yllimit = 0;
-    else
-        yllimit = (yl & 0xfff) < parallel_worker->globals.clip.yl;
-    yllimit = yllimit ? yl : parallel_worker->globals.clip.yl;
-
-    int ylfar = yllimit | 3;
-    if ((yl >> 2) > (ylfar >> 2))
-        ylfar += 4;
-    else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023)
-        parallel_worker->globals.span[(yllimit >> 2) + 1].validline = 0;
-
-
-    if (yh & 0x2000)
-        yhlimit = 0;
-    else if (yh & 0x1000)
-        yhlimit = 1;
-    else
-        yhlimit = (yh >= parallel_worker->globals.clip.yh);
-    yhlimit = yhlimit ? yh : parallel_worker->globals.clip.yh;
-
-    int yhclose = yhlimit & ~3;
 
     int32_t clipxlshift = parallel_worker->globals.clip.xl << 1;
     int32_t clipxhshift = parallel_worker->globals.clip.xh << 1;
@@ -8429,9 +9090,37 @@ static void edgewalker_for_prims(int32_t* ewdata)
 
     xfrac = ((xright >> 8) & 0xff);
 
+    // scanlines above the scissor only step the edges and attributes, so go
+    // straight to the first one that may be visible
+    if (yhclose > ycur)
+    {
+        uint32_t steps = yhclose - ycur;
+        uint32_t rows = steps >> 2;
 
-    uint32_t worker_id = parallel_worker->m_worker_id;
-    uint32_t worker_num = parallel_worker_num();
+        if (ym >= ycur && ym < yhclose)
+        {
+            xleft_inc = (dxldy >> 2) & ~1;
+            xleft = (xl & ~1) + (int32_t)((uint32_t)xleft_inc * (uint32_t)(yhclose - ym));
+        }
+        else
+            xleft += (int32_t)((uint32_t)xleft_inc * steps);
+        xright += (int32_t)((uint32_t)xright_inc * steps);
+
+        s += (int32_t)((uint32_t)dsde * rows);
+        t += (int32_t)((uint32_t)dtde * rows);
+        w += (int32_t)((uint32_t)dwde * rows);
+        r += (int32_t)((uint32_t)drde * rows);
+        g += (int32_t)((uint32_t)dgde * rows);
+        b += (int32_t)((uint32_t)dbde * rows);
+        a += (int32_t)((uint32_t)dade * rows);
+        z += (int32_t)((uint32_t)dzde * rows);
+
+        ycur = yhclose;
+    }
+
+    // rows of other workers are never drawn here, so only their validline
+    // is cleared and the edge walk just steps over them
+    int ownrow = 1;
 
     if (flip)
     {
@@ -8446,7 +9135,15 @@ static void edgewalker_for_prims(int32_t* ewdata)
 
         spix = k & 3;
 
-        if (k >= yhclose)
+        if (spix == 0)
+            ownrow = !config->parallel || (k >> 2) % worker_num == worker_id;
+
+        if (k >= yhclose && !ownrow)
+        {
+            if (spix == 3)
+                parallel_worker->globals.span[k >> 2].validline = 0;
+        }
+        else if (k >= yhclose)
         {
             invaly = k < yhlimit || k >= yllimit;
 
@@ -8513,7 +9210,7 @@ static void edgewalker_for_prims(int32_t* ewdata)
             {
                 parallel_worker->globals.span[j].lx = maxxmx;
                 parallel_worker->globals.span[j].rx = minxhx;
-                parallel_worker->globals.span[j].validline  = !allinval && !allover && !allunder && (!parallel_worker->globals.scfield || (parallel_worker->globals.scfield && !(parallel_worker->globals.sckeepodd ^ (j & 1)))) && (!config->parallel || j % worker_num == worker_id);
+                parallel_worker->globals.span[j].validline  = !allinval && !allover && !allunder && (!parallel_worker->globals.scfield || (parallel_worker->globals.scfield && !(parallel_worker->globals.sckeepodd ^ (j & 1))));
 
             }
 
@@ -8544,7 +9241,15 @@ static void edgewalker_for_prims(int32_t* ewdata)
 
         spix = k & 3;
 
-        if (k >= yhclose)
+        if (spix == 0)
+            ownrow = !config->parallel || (k >> 2) % worker_num == worker_id;
+
+        if (k >= yhclose && !ownrow)
+        {
+            if (spix == 3)
+                parallel_worker->globals.span[k >> 2].validline = 0;
+        }
+        else if (k >= yhclose)
         {
             invaly = k < yhlimit || k >= yllimit;
             j = k >> 2;
@@ -8600,7 +9305,7 @@ static void edgewalker_for_prims(int32_t* ewdata)
             {
                 parallel_worker->globals.span[j].lx = minxmx;
                 parallel_worker->globals.span[j].rx = maxxhx;
-                parallel_worker->globals.span[j].validline  = !allinval && !allover && !allunder && (!parallel_worker->globals.scfield || (parallel_worker->globals.scfield && !(parallel_worker->globals.sckeepodd ^ (j & 1)))) && (!config->parallel || j % worker_num == worker_id);
+                parallel_worker->globals.span[j].validline  = !allinval && !allover && !allunder && (!parallel_worker->globals.scfield || (parallel_worker->globals.scfield && !(parallel_worker->globals.sckeepodd ^ (j & 1))));
             }
 
         }
@@ -8619,23 +9324,29 @@ static void edgewalker_for_prims(int32_t* ewdata)
 
 
 
+    if (parallel_worker->globals.render_spans_ptr)
+    {
+        parallel_worker->globals.render_spans_ptr(yhlimit >> 2, yllimit >> 2, tilenum, flip);
+        return;
+    }
+
     switch(parallel_worker->globals.other_modes.cycle_type)
     {
         case CYCLE_TYPE_1:
             switch (parallel_worker->globals.other_modes.f.textureuselevel0)
             {
-                case 0: render_spans_1cycle_complete(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 1: render_spans_1cycle_notexel1(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 2: default: render_spans_1cycle_notex(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 0: render_spans_1cycle_complete<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 1: render_spans_1cycle_notexel1<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 2: default: render_spans_1cycle_notex<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
             }
             break;
         case CYCLE_TYPE_2:
             switch (parallel_worker->globals.other_modes.f.textureuselevel1)
             {
-                case 0: render_spans_2cycle_complete(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 1: render_spans_2cycle_notexelnext(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 2: render_spans_2cycle_notexel1(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 3: default: render_spans_2cycle_notex(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 0: render_spans_2cycle_complete<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 1: render_spans_2cycle_notexelnext<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 2: render_spans_2cycle_notexel1<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
+                case 3: default: render_spans_2cycle_notex<SPAN_ANY, SPAN_ANY, SPAN_ANY, SPAN_ANY>(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
             }
             break;
         case CYCLE_TYPE_COPY: render_spans_copy(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
@@ -9004,6 +9715,18 @@ int rdp_init(struct core_config* _config)
    tex_init();
    rasterizer_init();
 
+   if (config->dp.async)
+   {
+      rdp_async.queue.resize(ASYNC_QUEUE_SIZE);
+      rdp_async.pending = rdp_async.head = rdp_async.tail = 0;
+      rdp_async.space = ASYNC_QUEUE_SIZE - 1;
+      rdp_async.exit = false;
+      rdp_async.syncs_queued = rdp_async.syncs_done = 0;
+      rdp_async.num_images = 0;
+      rdp_async.images_changed = true;
+      rdp_async.thread = std::thread(rdp_async_run, parallel_worker);
+   }
+
    return 0;
 }
 
@@ -9165,4 +9888,9 @@ static void deduce_derivatives(void)
         parallel_worker->globals.other_modes.f.getditherlevel = 2;
 
     parallel_worker->globals.other_modes.f.dolod = parallel_worker->globals.other_modes.tex_lod_en || lodfracused;
+
+    combiner_compile(0);
+    combiner_compile(1);
+
+    parallel_worker->globals.render_spans_ptr = select_render_spans();
 }
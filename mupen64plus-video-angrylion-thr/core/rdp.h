@@ -44,7 +44,27 @@
 #define CMD_MAX_SIZE (CMD_MAX_INTS * sizeof(int32_t))
 #define CMD_ID(cmd) ((*(cmd) >> 24) & 0x3f)
 
+// same layout as FrameBufferInfo in m64p_plugin.h, size is in bytes per pixel
+struct rdp_image
+{
+    uint32_t addr;
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
 int rdp_init(struct core_config* config);
+void rdp_close(void);
 void rdp_cmd(const uint32_t* arg, uint32_t length);
 void rdp_update(void);
 uint32_t rdp_get_zb_address(void);
+
+// asynchronous mode only: waits until the RDP thread has run all queued
+// commands, and lists the images that queued commands may still write to
+void rdp_wait(void);
+uint32_t rdp_get_pending_images(struct rdp_image* images, uint32_t count);
+
+// asynchronous mode only: whether a queued full sync hasn't run yet, and
+// waiting for all queued full syncs to run
+bool rdp_sync_pending(void);
+void rdp_sync_wait(void);
@@ -4,6 +4,8 @@
 
 #include "rdram.h"
 
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,10 +23,10 @@ static uint32_t idxlim8;
 static uint32_t idxlim16;
 static uint32_t idxlim32;
 
-static uint32_t* rdram32;
-static uint16_t* rdram16;
+uint32_t* rdram32;
+uint16_t* rdram16;
 static uint8_t* rdram8;
-static uint8_t* rdram_hidden;
+uint8_t* rdram_hidden;
 
 void rdram_init(void)
 {
@@ -57,6 +59,16 @@ bool rdram_valid_idx32(uint32_t in)
     return in <= idxlim32;
 }
 
+bool rdram_valid_range16(uint32_t in, uint32_t count)
+{
+    return count && rdram_valid_idx16(in) && idxlim16 - in >= count - 1;
+}
+
+bool rdram_valid_range32(uint32_t in, uint32_t count)
+{
+    return count && rdram_valid_idx32(in) && idxlim32 - in >= count - 1;
+}
+
 uint8_t rdram_read_idx8(uint32_t in)
 {
     in &= RDRAM_MASK;
@@ -154,3 +166,185 @@ void rdram_write_pair32(uint32_t in, uint32_t rval, uint8_t hval0, uint8_t hval1
         rdram_hidden[(in << 1) + 1] = hval1;
     }
 }
+
+// repeats an 8-byte pattern over size bytes starting at dst, so that bulk
+// fills end up as plain wide stores instead of one bounds-checked call per pixel
+static void rdram_fill_pattern(void* dst, uint64_t pattern, uint32_t size)
+{
+    uint8_t* p = (uint8_t*)dst;
+    while (size >= 8)
+    {
+        memcpy(p, &pattern, 8);
+        p += 8;
+        size -= 8;
+    }
+    memcpy(p, &pattern, size);
+}
+
+// fills count hidden bytes from in, even indices with hval0, odd with hval1
+static void rdram_fill_hidden(uint32_t in, uint32_t count, uint8_t hval0, uint8_t hval1)
+{
+    uint8_t pat[8] = {hval0, hval1, hval0, hval1, hval0, hval1, hval0, hval1};
+    uint64_t pattern;
+
+    if (in & 1)
+    {
+        rdram_hidden[in++] = hval1;
+        count--;
+    }
+
+    memcpy(&pattern, pat, 8);
+    rdram_fill_pattern(&rdram_hidden[in], pattern, count);
+}
+
+void rdram_write_pair8x8(uint32_t in, uint32_t hidword, uint32_t lowdword)
+{
+    in &= RDRAM_MASK;
+    if ((in & 3) || !rdram_valid_idx8(in) || idxlim8 - in < 7)
+    {
+        int k;
+        for (k = 0; k < 4; k++)
+        {
+            uint8_t val = (hidword >> ((3 - k) << 3)) & 0xff;
+            rdram_write_pair8(in + k, val, (val & 1) ? 3 : 0);
+        }
+        for (k = 0; k < 4; k++)
+        {
+            uint8_t val = (lowdword >> ((3 - k) << 3)) & 0xff;
+            rdram_write_pair8(in + 4 + k, val, (val & 1) ? 3 : 0);
+        }
+        return;
+    }
+
+    rdram32[in >> 2] = hidword;
+    rdram32[(in >> 2) + 1] = lowdword;
+    rdram_hidden[in >> 1] = (hidword & 0x10000) ? 3 : 0;
+    rdram_hidden[(in >> 1) + 1] = (hidword & 1) ? 3 : 0;
+    rdram_hidden[(in >> 1) + 2] = (lowdword & 0x10000) ? 3 : 0;
+    rdram_hidden[(in >> 1) + 3] = (lowdword & 1) ? 3 : 0;
+}
+
+void rdram_fill_pair16(uint32_t in, uint32_t count, uint32_t rval, uint8_t hval0, uint8_t hval1)
+{
+    uint32_t end;
+    uint32_t pair[2] = {rval, rval};
+    uint64_t pattern;
+
+    if (!count)
+        return;
+
+    in &= RDRAM_MASK >> 1;
+    if (!rdram_valid_idx16(in) || idxlim16 - in < count - 1)
+    {
+        uint32_t k;
+        for (k = 0; k < count; k++)
+        {
+            if ((in + k) & 1)
+                rdram_write_pair16(in + k, rval & 0xffff, hval1);
+            else
+                rdram_write_pair16(in + k, rval >> 16, hval0);
+        }
+        return;
+    }
+
+    end = in + count;
+    rdram_fill_hidden(in, count, hval0, hval1);
+
+    if (in & 1)
+        rdram16[in++ ^ WORD_ADDR_XOR] = rval & 0xffff;
+
+    memcpy(&pattern, pair, 8);
+    rdram_fill_pattern(&rdram32[in >> 1], pattern, ((end - in) >> 1) << 2);
+
+    if (end & 1)
+        rdram16[(end - 1) ^ WORD_ADDR_XOR] = rval >> 16;
+}
+
+void rdram_fill_pair32(uint32_t in, uint32_t count, uint32_t rval, uint8_t hval0, uint8_t hval1)
+{
+    uint32_t pair[2] = {rval, rval};
+    uint64_t pattern;
+
+    if (!count)
+        return;
+
+    in &= RDRAM_MASK >> 2;
+    if (!rdram_valid_idx32(in) || idxlim32 - in < count - 1)
+    {
+        uint32_t k;
+        for (k = 0; k < count; k++)
+            rdram_write_pair32(in + k, rval, hval0, hval1);
+        return;
+    }
+
+    memcpy(&pattern, pair, 8);
+    rdram_fill_pattern(&rdram32[in], pattern, count << 2);
+    rdram_fill_hidden(in << 1, count << 1, hval0, hval1);
+}
+
+// simple multiplicative hash; every step is a bijection of the state, so a
+// single differing chunk always changes the result
+static uint64_t rdram_hash_bytes(uint64_t hash, const uint8_t* p, uint32_t size)
+{
+    uint64_t v;
+    while (size >= 8)
+    {
+        memcpy(&v, p, 8);
+        hash = (hash ^ v) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+        p += 8;
+        size -= 8;
+    }
+    while (size--)
+        hash = (hash ^ *p++) * 0x100000001b3ull;
+    return hash;
+}
+
+static uint64_t rdram_hash_value(uint64_t hash, uint32_t v)
+{
+    hash = (hash ^ v) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t rdram_hash_pair16(uint64_t hash, uint32_t in, uint32_t count)
+{
+    uint32_t k;
+
+    if (!count)
+        return hash;
+
+    in &= RDRAM_MASK >> 1;
+    if (rdram_valid_idx16(in) && idxlim16 - in >= count - 1)
+    {
+        // hash whole words so that the swapped halves at both ends are included
+        uint32_t first = in & ~1u;
+        uint32_t last = (in + count - 1) | 1;
+        hash = rdram_hash_bytes(hash, (const uint8_t*)&rdram16[first], (last - first + 1) << 1);
+        return rdram_hash_bytes(hash, &rdram_hidden[in], count);
+    }
+
+    for (k = 0; k < count; k++)
+    {
+        uint16_t pix;
+        uint8_t hval;
+        rdram_read_pair16(&pix, &hval, in + k);
+        hash = rdram_hash_value(hash, ((uint32_t)hval << 16) | pix);
+    }
+    return hash;
+}
+
+uint64_t rdram_hash_idx32(uint64_t hash, uint32_t in, uint32_t count)
+{
+    uint32_t k;
+
+    if (!count)
+        return hash;
+
+    in &= RDRAM_MASK >> 2;
+    if (rdram_valid_idx32(in) && idxlim32 - in >= count - 1)
+        return rdram_hash_bytes(hash, (const uint8_t*)&rdram32[in], count << 2);
+
+    for (k = 0; k < count; k++)
+        hash = rdram_hash_value(hash, rdram_read_idx32(in + k));
+    return hash;
+}
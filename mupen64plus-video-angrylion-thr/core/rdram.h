@@ -46,10 +46,20 @@
 
 void rdram_init(void);
 
+// host views of RDRAM and the hidden bits, only for the *_direct accessors
+extern uint32_t* rdram32;
+extern uint16_t* rdram16;
+extern uint8_t* rdram_hidden;
+
 bool rdram_valid_idx8(uint32_t in);
 bool rdram_valid_idx16(uint32_t in);
 bool rdram_valid_idx32(uint32_t in);
 
+// true if count consecutive indices from in are all valid without any masking,
+// so a whole span can be checked once instead of on every access
+bool rdram_valid_range16(uint32_t in, uint32_t count);
+bool rdram_valid_range32(uint32_t in, uint32_t count);
+
 uint8_t rdram_read_idx8(uint32_t in);
 uint8_t rdram_read_idx8_fast(uint32_t in);
 uint16_t rdram_read_idx16(uint32_t in);
@@ -66,3 +76,47 @@ void rdram_read_pair16(uint16_t* rdst, uint8_t* hdst, uint32_t in);
 void rdram_write_pair8(uint32_t in, uint8_t rval, uint8_t hval);
 void rdram_write_pair16(uint32_t in, uint16_t rval, uint8_t hval);
 void rdram_write_pair32(uint32_t in, uint32_t rval, uint8_t hval0, uint8_t hval1);
+
+// eight consecutive PAIRWRITE8s of a big-endian qword, hidden bits from each odd byte
+void rdram_write_pair8x8(uint32_t in, uint32_t hidword, uint32_t lowdword);
+
+// bulk equivalents of count consecutive PAIRWRITE16/PAIRWRITE32 calls; for 16-bit
+// pixels even indices take the upper half of rval and odd indices the lower half
+void rdram_fill_pair16(uint32_t in, uint32_t count, uint32_t rval, uint8_t hval0, uint8_t hval1);
+void rdram_fill_pair32(uint32_t in, uint32_t count, uint32_t rval, uint8_t hval0, uint8_t hval1);
+
+// content hashes of count consecutive pixels as the VI reads them, with the
+// same index masking as rdram_read_pair16/rdram_read_idx32
+uint64_t rdram_hash_pair16(uint64_t hash, uint32_t in, uint32_t count);
+uint64_t rdram_hash_idx32(uint64_t hash, uint32_t in, uint32_t count);
+
+// unchecked inline variants of the accessors above, in must lie within a range
+// that passed rdram_valid_range16/rdram_valid_range32
+static inline uint16_t rdram_read_idx16_direct(uint32_t in)
+{
+    return rdram16[in ^ WORD_ADDR_XOR];
+}
+
+static inline uint32_t rdram_read_idx32_direct(uint32_t in)
+{
+    return rdram32[in];
+}
+
+static inline void rdram_read_pair16_direct(uint16_t* rdst, uint8_t* hdst, uint32_t in)
+{
+    *rdst = rdram16[in ^ WORD_ADDR_XOR];
+    *hdst = rdram_hidden[in];
+}
+
+static inline void rdram_write_pair16_direct(uint32_t in, uint16_t rval, uint8_t hval)
+{
+    rdram16[in ^ WORD_ADDR_XOR] = rval;
+    rdram_hidden[in] = hval;
+}
+
+static inline void rdram_write_pair32_direct(uint32_t in, uint32_t rval, uint8_t hval0, uint8_t hval1)
+{
+    rdram32[in] = rval;
+    rdram_hidden[in << 1] = hval0;
+    rdram_hidden[(in << 1) + 1] = hval1;
+}
@@ -4,6 +4,8 @@
 #include <memory.h>
 #include <assert.h>
 
+#include <atomic>
+
 #include "vi.h"
 #include "rdp.h"
 #include "common.h"
@@ -114,6 +116,70 @@ extern "C" {
 
 /* END OF MACROS */
 
+/* START OF SIMD HELPERS */
+
+// 128-bit integer vectors used by the row filters below; lanes are bytes or
+// 16-bit words depending on the op. Without SSE2 or NEON the row filters fall
+// back to the per-pixel functions.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VI_SIMD
+
+typedef __m128i vi_vec;
+
+static STRICTINLINE vi_vec vi_load(const void* p)            { return _mm_loadu_si128((const __m128i*)p); }
+static STRICTINLINE void vi_store(void* p, vi_vec v)         { _mm_storeu_si128((__m128i*)p, v); }
+static STRICTINLINE vi_vec vi_zero(void)                     { return _mm_setzero_si128(); }
+static STRICTINLINE vi_vec vi_set1_16(uint16_t x)            { return _mm_set1_epi16((short)x); }
+static STRICTINLINE vi_vec vi_set1_32(uint32_t x)            { return _mm_set1_epi32((int)x); }
+static STRICTINLINE vi_vec vi_and(vi_vec a, vi_vec b)        { return _mm_and_si128(a, b); }
+static STRICTINLINE vi_vec vi_or(vi_vec a, vi_vec b)         { return _mm_or_si128(a, b); }
+static STRICTINLINE vi_vec vi_select(vi_vec m, vi_vec a, vi_vec b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+static STRICTINLINE vi_vec vi_min_u8(vi_vec a, vi_vec b)     { return _mm_min_epu8(a, b); }
+static STRICTINLINE vi_vec vi_max_u8(vi_vec a, vi_vec b)     { return _mm_max_epu8(a, b); }
+static STRICTINLINE vi_vec vi_cmpgt_s8(vi_vec a, vi_vec b)   { return _mm_cmpgt_epi8(a, b); }
+static STRICTINLINE vi_vec vi_add_8(vi_vec a, vi_vec b)      { return _mm_add_epi8(a, b); }
+static STRICTINLINE vi_vec vi_sub_8(vi_vec a, vi_vec b)      { return _mm_sub_epi8(a, b); }
+static STRICTINLINE vi_vec vi_cmpeq_32(vi_vec a, vi_vec b)   { return _mm_cmpeq_epi32(a, b); }
+static STRICTINLINE vi_vec vi_lo_u8_16(vi_vec a)             { return _mm_unpacklo_epi8(a, _mm_setzero_si128()); }
+static STRICTINLINE vi_vec vi_hi_u8_16(vi_vec a)             { return _mm_unpackhi_epi8(a, _mm_setzero_si128()); }
+static STRICTINLINE vi_vec vi_pack_16_u8(vi_vec a, vi_vec b) { return _mm_packus_epi16(a, b); }
+static STRICTINLINE vi_vec vi_add_16(vi_vec a, vi_vec b)     { return _mm_add_epi16(a, b); }
+static STRICTINLINE vi_vec vi_sub_16(vi_vec a, vi_vec b)     { return _mm_sub_epi16(a, b); }
+static STRICTINLINE vi_vec vi_mullo_16(vi_vec a, vi_vec b)   { return _mm_mullo_epi16(a, b); }
+static STRICTINLINE vi_vec vi_srl5_16(vi_vec a)              { return _mm_srli_epi16(a, 5); }
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#define VI_SIMD
+
+typedef uint8x16_t vi_vec;
+
+static STRICTINLINE vi_vec vi_load(const void* p)            { return vld1q_u8((const uint8_t*)p); }
+static STRICTINLINE void vi_store(void* p, vi_vec v)         { vst1q_u8((uint8_t*)p, v); }
+static STRICTINLINE vi_vec vi_zero(void)                     { return vdupq_n_u8(0); }
+static STRICTINLINE vi_vec vi_set1_16(uint16_t x)            { return vreinterpretq_u8_u16(vdupq_n_u16(x)); }
+static STRICTINLINE vi_vec vi_set1_32(uint32_t x)            { return vreinterpretq_u8_u32(vdupq_n_u32(x)); }
+static STRICTINLINE vi_vec vi_and(vi_vec a, vi_vec b)        { return vandq_u8(a, b); }
+static STRICTINLINE vi_vec vi_or(vi_vec a, vi_vec b)         { return vorrq_u8(a, b); }
+static STRICTINLINE vi_vec vi_select(vi_vec m, vi_vec a, vi_vec b) { return vbslq_u8(m, a, b); }
+static STRICTINLINE vi_vec vi_min_u8(vi_vec a, vi_vec b)     { return vminq_u8(a, b); }
+static STRICTINLINE vi_vec vi_max_u8(vi_vec a, vi_vec b)     { return vmaxq_u8(a, b); }
+static STRICTINLINE vi_vec vi_cmpgt_s8(vi_vec a, vi_vec b)   { return vcgtq_s8(vreinterpretq_s8_u8(a), vreinterpretq_s8_u8(b)); }
+static STRICTINLINE vi_vec vi_add_8(vi_vec a, vi_vec b)      { return vaddq_u8(a, b); }
+static STRICTINLINE vi_vec vi_sub_8(vi_vec a, vi_vec b)      { return vsubq_u8(a, b); }
+static STRICTINLINE vi_vec vi_cmpeq_32(vi_vec a, vi_vec b)   { return vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b))); }
+static STRICTINLINE vi_vec vi_lo_u8_16(vi_vec a)             { return vreinterpretq_u8_u16(vmovl_u8(vget_low_u8(a))); }
+static STRICTINLINE vi_vec vi_hi_u8_16(vi_vec a)             { return vreinterpretq_u8_u16(vmovl_u8(vget_high_u8(a))); }
+static STRICTINLINE vi_vec vi_pack_16_u8(vi_vec a, vi_vec b) { return vcombine_u8(vqmovun_s16(vreinterpretq_s16_u8(a)), vqmovun_s16(vreinterpretq_s16_u8(b))); }
+static STRICTINLINE vi_vec vi_add_16(vi_vec a, vi_vec b)     { return vreinterpretq_u8_u16(vaddq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b))); }
+static STRICTINLINE vi_vec vi_sub_16(vi_vec a, vi_vec b)     { return vreinterpretq_u8_u16(vsubq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b))); }
+static STRICTINLINE vi_vec vi_mullo_16(vi_vec a, vi_vec b)   { return vreinterpretq_u8_u16(vmulq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b))); }
+static STRICTINLINE vi_vec vi_srl5_16(vi_vec a)              { return vreinterpretq_u8_u16(vshrq_n_u16(vreinterpretq_u16_u8(a), 5)); }
+#endif
+
+/* END OF SIMD HELPERS */
+
 enum vi_type
 {
     VI_TYPE_BLANK,      // no data, no sync
@@ -599,10 +665,8 @@ static void (*vi_fetch_filter_func[2])(struct ccvg*, uint32_t, uint32_t, union v
 
 void (*vi_fetch_filter_ptr)(struct ccvg*, uint32_t, uint32_t, union vi_reg_ctrl, uint32_t, uint32_t);
 
-static void vi_fetch_filter16(struct ccvg* res, uint32_t fboffset, uint32_t cur_x, union vi_reg_ctrl ctrl, uint32_t hres, uint32_t fetchstate)
+static STRICTINLINE uint32_t vi_fetch_pixel16(int* r, int* g, int* b, uint32_t idx, union vi_reg_ctrl ctrl)
 {
-    int r, g, b;
-    uint32_t idx = (fboffset >> 1) + cur_x;
     uint8_t hval;
     uint16_t pix;
     uint32_t cur_cvg;
@@ -616,9 +680,32 @@ static void vi_fetch_filter16(struct ccvg* res, uint32_t fboffset, uint32_t cur_
         RREADIDX16(pix, idx);
         cur_cvg = 7;
     }
-    r = GET_HI(pix);
-    g = GET_MED(pix);
-    b = GET_LOW(pix);
+    *r = GET_HI(pix);
+    *g = GET_MED(pix);
+    *b = GET_LOW(pix);
+    return cur_cvg;
+}
+
+static STRICTINLINE uint32_t vi_fetch_pixel32(int* r, int* g, int* b, uint32_t idx, union vi_reg_ctrl ctrl)
+{
+    uint32_t cur_cvg;
+    uint32_t pix;
+
+    RREADIDX32(pix, idx);
+    if (ctrl.aa_mode <= VI_AA_RESAMP_EXTRA)
+        cur_cvg = (pix >> 5) & 7;
+    else
+        cur_cvg = 7;
+    *r = (pix >> 24) & 0xff;
+    *g = (pix >> 16) & 0xff;
+    *b = (pix >> 8) & 0xff;
+    return cur_cvg;
+}
+
+static void vi_fetch_filter16(struct ccvg* res, uint32_t fboffset, uint32_t cur_x, union vi_reg_ctrl ctrl, uint32_t hres, uint32_t fetchstate)
+{
+    int r, g, b;
+    uint32_t cur_cvg = vi_fetch_pixel16(&r, &g, &b, (fboffset >> 1) + cur_x, ctrl);
 
     if (cur_cvg == 7)
     {
@@ -637,17 +724,7 @@ static void vi_fetch_filter16(struct ccvg* res, uint32_t fboffset, uint32_t cur_
 static void vi_fetch_filter32(struct ccvg* res, uint32_t fboffset, uint32_t cur_x, union vi_reg_ctrl ctrl, uint32_t hres, uint32_t fetchstate)
 {
     int r, g, b;
-    uint32_t cur_cvg;
-    uint32_t pix, addr = (fboffset >> 2) + cur_x;
-
-    RREADIDX32(pix, addr);
-    if (ctrl.aa_mode <= VI_AA_RESAMP_EXTRA)
-        cur_cvg = (pix >> 5) & 7;
-    else
-        cur_cvg = 7;
-    r = (pix >> 24) & 0xff;
-    g = (pix >> 16) & 0xff;
-    b = (pix >> 8) & 0xff;
+    uint32_t cur_cvg = vi_fetch_pixel32(&r, &g, &b, (fboffset >> 2) + cur_x, ctrl);
 
     if (cur_cvg == 7)
     {
@@ -663,7 +740,182 @@ static void vi_fetch_filter32(struct ccvg* res, uint32_t fboffset, uint32_t cur_
     res->cvg = cur_cvg;
 }
 
-// config
+#ifdef VI_SIMD
+#define VI_ROW_CHUNK 16
+
+static STRICTINLINE void vi_restore_decode(uint8_t (*dst)[VI_ROW_CHUNK + 2], uint32_t i, uint32_t idx, int is32)
+{
+    uint32_t pix;
+    if (is32)
+    {
+        pix = rdram_read_idx32_fast(idx);
+        dst[0][i] = (pix >> 27) & 0x1f;
+        dst[1][i] = (pix >> 19) & 0x1f;
+        dst[2][i] = (pix >> 11) & 0x1f;
+    }
+    else
+    {
+        pix = rdram_read_idx16_fast(idx);
+        dst[0][i] = (pix >> 11) & 0x1f;
+        dst[1][i] = (pix >> 6) & 0x1f;
+        dst[2][i] = (pix >> 1) & 0x1f;
+    }
+}
+
+// restore_filter16/32 adjustments for up to 16 consecutive pixels at idx; each
+// neighbour is read once and the eight compares per channel become byte-wise
+// signed compares. Returns false if a neighbour lies outside RDRAM, in which
+// case the caller has to use the per-pixel path and its wrapping reads.
+static bool vi_restore_chunk(int8_t delta[3][VI_ROW_CHUNK], uint32_t idx, uint32_t num, uint32_t hres, uint32_t fetchstate, int is32)
+{
+    uint8_t up[3][VI_ROW_CHUNK + 2], mid[3][VI_ROW_CHUNK + 2], down[3][VI_ROW_CHUNK + 2];
+    uint8_t (*dn)[VI_ROW_CHUNK + 2] = (fetchstate == 1) ? mid : down;
+    uint32_t i;
+    int ch;
+
+    if (is32 ? !rdram_valid_idx32(idx - hres - 1) || !rdram_valid_idx32(idx + num + hres)
+             : !rdram_valid_idx16(idx - hres - 1) || !rdram_valid_idx16(idx + num + hres))
+        return false;
+
+    memset(up, 0, sizeof(up));
+    memset(mid, 0, sizeof(mid));
+    memset(down, 0, sizeof(down));
+
+    for (i = 0; i < num + 2; i++)
+    {
+        vi_restore_decode(up, i, idx - hres - 1 + i, is32);
+        vi_restore_decode(mid, i, idx - 1 + i, is32);
+        if (fetchstate != 1)
+            vi_restore_decode(down, i, idx + hres - 1 + i, is32);
+    }
+
+    for (ch = 0; ch < 3; ch++)
+    {
+        vi_vec c = vi_load(&mid[ch][1]);
+        vi_vec acc = vi_zero();
+        vi_vec n;
+
+#define VI_RESTORE_ACC(p) n = vi_load(p); acc = vi_add_8(vi_sub_8(acc, vi_cmpgt_s8(n, c)), vi_cmpgt_s8(c, n))
+        VI_RESTORE_ACC(&up[ch][0]);
+        VI_RESTORE_ACC(&up[ch][1]);
+        VI_RESTORE_ACC(&up[ch][2]);
+        VI_RESTORE_ACC(&dn[ch][0]);
+        VI_RESTORE_ACC(&dn[ch][1]);
+        VI_RESTORE_ACC(&dn[ch][2]);
+        VI_RESTORE_ACC(&mid[ch][0]);
+        VI_RESTORE_ACC(&mid[ch][2]);
+#undef VI_RESTORE_ACC
+
+        vi_store(delta[ch], acc);
+    }
+
+    return true;
+}
+
+// vi_vl_lerp on four packed pixels; each pixel's weight is repeated over its
+// four 16-bit lanes in fraclo (pixels 0-1) and frachi (pixels 2-3)
+static STRICTINLINE vi_vec vi_lerp_vec(vi_vec up, vi_vec down, vi_vec fraclo, vi_vec frachi)
+{
+    vi_vec mask = vi_set1_16(0xff);
+    vi_vec round = vi_set1_16(16);
+    vi_vec ul = vi_lo_u8_16(up), uh = vi_hi_u8_16(up);
+    vi_vec dl = vi_lo_u8_16(down), dh = vi_hi_u8_16(down);
+
+    ul = vi_and(vi_add_16(vi_srl5_16(vi_add_16(vi_mullo_16(vi_sub_16(dl, ul), fraclo), round)), ul), mask);
+    uh = vi_and(vi_add_16(vi_srl5_16(vi_add_16(vi_mullo_16(vi_sub_16(dh, uh), frachi), round)), uh), mask);
+    return vi_pack_16_u8(ul, uh);
+}
+#endif
+
+// fetches and filters count consecutive pixels from cur_x on, with the same
+// results as calling vi_fetch_filter_ptr on each of them
+static void vi_fetch_row(struct ccvg* res, uint32_t fboffset, uint32_t cur_x, uint32_t count, union vi_reg_ctrl ctrl, uint32_t hres, uint32_t fetchstate)
+{
+    uint32_t i;
+
+#ifdef VI_SIMD
+    if (ctrl.dither_filter_enable)
+    {
+        int is32 = vi_fetch_filter_ptr == vi_fetch_filter32;
+        uint32_t base = is32 ? fboffset >> 2 : fboffset >> 1;
+
+        while (count)
+        {
+            int8_t delta[3][VI_ROW_CHUNK];
+            uint32_t num = count < VI_ROW_CHUNK ? count : VI_ROW_CHUNK;
+
+            if (vi_restore_chunk(delta, base + cur_x, num, hres, fetchstate, is32))
+            {
+                for (i = 0; i < num; i++)
+                {
+                    int r, g, b;
+                    uint32_t cur_cvg = is32 ? vi_fetch_pixel32(&r, &g, &b, base + cur_x + i, ctrl)
+                                            : vi_fetch_pixel16(&r, &g, &b, base + cur_x + i, ctrl);
+
+                    if (cur_cvg == 7)
+                    {
+                        r += delta[0][i];
+                        g += delta[1][i];
+                        b += delta[2][i];
+                    }
+                    else if (is32)
+                        video_filter32(&r, &g, &b, fboffset, cur_x + i, hres, cur_cvg, fetchstate);
+                    else
+                        video_filter16(&r, &g, &b, fboffset, cur_x + i, hres, cur_cvg, fetchstate);
+
+                    res[i].r = r;
+                    res[i].g = g;
+                    res[i].b = b;
+                    res[i].cvg = cur_cvg;
+                }
+            }
+            else
+            {
+                for (i = 0; i < num; i++)
+                    vi_fetch_filter_ptr(&res[i], fboffset, cur_x + i, ctrl, hres, fetchstate);
+            }
+
+            res += num;
+            cur_x += num;
+            count -= num;
+        }
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; i++)
+        vi_fetch_filter_ptr(&res[i], fboffset, cur_x + i, ctrl, hres, fetchstate);
+}
+
+// divot_filter on count consecutive entries of src; src[-1] and src[count]
+// must be valid as the outer neighbours
+static void vi_divot_row(struct ccvg* final, const struct ccvg* src, int32_t count)
+{
+    int32_t i = 0;
+
+#ifdef VI_SIMD
+    // divot_filter picks the median of each channel, unless all three pixels
+    // are fully covered; coverage always comes from the center pixel
+    static const struct ccvg full_cvg[4] = {{0, 0, 0, 7}, {0, 0, 0, 7}, {0, 0, 0, 7}, {0, 0, 0, 7}};
+    static const struct ccvg cvg_lane[4] = {{0, 0, 0, 0xff}, {0, 0, 0, 0xff}, {0, 0, 0, 0xff}, {0, 0, 0, 0xff}};
+    vi_vec full = vi_load(full_cvg);
+    vi_vec lane = vi_load(cvg_lane);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        vi_vec left = vi_load(&src[i - 1]);
+        vi_vec center = vi_load(&src[i]);
+        vi_vec right = vi_load(&src[i + 1]);
+        vi_vec med = vi_max_u8(vi_min_u8(left, center), vi_min_u8(vi_max_u8(left, center), right));
+        vi_vec keep = vi_cmpeq_32(vi_and(vi_and(vi_and(left, center), right), full), full);
+        vi_store(&final[i], vi_select(vi_or(keep, lane), center, med));
+    }
+#endif
+
+    for (; i < count; i++)
+        divot_filter(&final[i], src[i], src[i - 1], src[i + 1]);
+}
+
 static struct core_config* config;
 
 // states
@@ -693,6 +945,17 @@ static int32_t prescale[PRESCALE_WIDTH * PRESCALE_HEIGHT];
 static uint32_t prescale_ptr;
 static int32_t linecount;
 
+// content key of the inputs each prescale line was last filtered from, 0 if
+// unknown; lines whose key still matches are not filtered again
+static uint64_t vi_line_key[PRESCALE_HEIGHT];
+static std::atomic<bool> vi_lines_changed;
+
+// previous screen_upload parameters and whether the last vi_update sent new
+// content to the screen buffer
+static int32_t* upload_buffer;
+static int32_t upload_width, upload_height, upload_pitch, upload_output_height;
+static bool vi_frame_changed = true;
+
 // parsed VI registers
 static uint32_t** vi_reg_ptr;
 static union vi_reg_ctrl ctrl;
@@ -714,6 +977,13 @@ unsigned angrylion_get_vi(void)
    return (unsigned)config->vi.mode;
 }
 
+// false if the last VI update left the screen buffer untouched, so the
+// frontend can dupe the previous frame instead of taking a new one
+unsigned angrylion_frame_changed(void)
+{
+   return vi_frame_changed;
+}
+
 void angrylion_set_vi(unsigned value)
 {
    if (!config)
@@ -737,7 +1007,9 @@ void vi_init(struct core_config* _config)
     vi_restore_init();
 
     memset(prescale, 0, sizeof(prescale));
+    memset(vi_line_key, 0, sizeof(vi_line_key));
     vi_mode              = VI_MODE_NORMAL;
+    upload_buffer        = NULL;
 
     prevvicurrent        = 0;
     emucontrolsvicurrent = -1;
@@ -746,6 +1018,25 @@ void vi_init(struct core_config* _config)
     prevwasblank         = false;
 }
 
+// clears part of a prescale line; a line that actually loses content can no
+// longer be reused and forces the frame to be uploaded again
+static void vi_clear_line(int32_t line, int32_t x, int32_t count)
+{
+    int32_t* p = &prescale[line * PRESCALE_WIDTH + x];
+    int32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (p[i])
+        {
+            memset(p, 0, count * sizeof(int32_t));
+            vi_line_key[line] = 0;
+            vi_lines_changed = true;
+            return;
+        }
+    }
+}
+
 static bool vi_process_start(void)
 {
     int32_t i;
@@ -850,6 +1141,8 @@ static bool vi_process_start(void)
         // blank signal, clear entire screen buffer
         memset(tvfadeoutstate, 0, PRESCALE_HEIGHT * sizeof(uint32_t));
         memset(prescale, 0, sizeof(prescale));
+        memset(vi_line_key, 0, sizeof(vi_line_key));
+        vi_lines_changed = true;
     }
     else
     {
@@ -858,14 +1151,14 @@ static bool vi_process_start(void)
         if (h_start > 0 && h_start < PRESCALE_WIDTH)
         {
             for (i = 0; i < vactivelines; i++)
-                memset(&prescale[i * PRESCALE_WIDTH], 0, h_start * sizeof(uint32_t));
+                vi_clear_line(i, 0, h_start);
         }
 
         // clear right border
         if (h_end >= 0 && h_end < PRESCALE_WIDTH)
         {
             for (i = 0; i < vactivelines; i++)
-                memset(&prescale[i * PRESCALE_WIDTH + h_end], 0, hrightblank * sizeof(uint32_t));
+                vi_clear_line(i, h_end, hrightblank);
         }
 
         // clear top border
@@ -877,9 +1170,9 @@ static bool vi_process_start(void)
                 if (!tvfadeoutstate[i])
                 {
                     if (validh)
-                        memset(&prescale[i * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                        vi_clear_line(i, h_start, hres);
                     else
-                        memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                        vi_clear_line(i, 0, PRESCALE_WIDTH);
                 }
             }
         }
@@ -894,7 +1187,7 @@ static bool vi_process_start(void)
               {
                  tvfadeoutstate[i]--;
                  if (!tvfadeoutstate[i])
-                    memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                    vi_clear_line(i, 0, PRESCALE_WIDTH);
               }
 
               i++;
@@ -908,7 +1201,7 @@ static bool vi_process_start(void)
                 {
                     tvfadeoutstate[i]--;
                     if (!tvfadeoutstate[i])
-                        memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                        vi_clear_line(i, 0, PRESCALE_WIDTH);
                 }
 
                 if (tvfadeoutstate[i + 1])
@@ -916,9 +1209,9 @@ static bool vi_process_start(void)
                    tvfadeoutstate[i + 1]--;
                    if (!tvfadeoutstate[i + 1])
                       if (validh)
-                         memset(&prescale[(i + 1) * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                         vi_clear_line(i + 1, h_start, hres);
                       else
-                         memset(&prescale[(i + 1) * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                         vi_clear_line(i + 1, 0, PRESCALE_WIDTH);
                 }
 
                 i += 2;
@@ -932,63 +1225,109 @@ static bool vi_process_start(void)
               tvfadeoutstate[i]--;
            if (!tvfadeoutstate[i])
               if (validh)
-                 memset(&prescale[i * PRESCALE_WIDTH + h_start], 0, hres * sizeof(uint32_t));
+                 vi_clear_line(i, h_start, hres);
               else
-                 memset(&prescale[i * PRESCALE_WIDTH], 0, PRESCALE_WIDTH * sizeof(uint32_t));
+                 vi_clear_line(i, 0, PRESCALE_WIDTH);
         }
     }
 
     return validh;
 }
 
+// splits lines into one contiguous band per worker, so that neighbouring
+// lines can share fetched rows and the fetch bug state runs in serial order
+static void vi_band(int32_t lines, int32_t* y_begin, int32_t* y_end)
+{
+    *y_begin = 0;
+    *y_end = lines;
+
+    if (config->parallel)
+    {
+        int64_t num = parallel_worker_num();
+        int64_t id = parallel_worker->m_worker_id;
+        *y_begin = (int32_t)(lines * id / num);
+        *y_end = (int32_t)(lines * (id + 1) / num);
+    }
+}
+
+static STRICTINLINE uint64_t vi_hash(uint64_t hash, uint64_t v)
+{
+    hash = (hash ^ v) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+// hashes count pixels of a framebuffer row from column first on, including
+// the coverage bits the filters read
+static uint64_t vi_row_hash(uint32_t row, int32_t first, uint32_t count)
+{
+    uint32_t pixel = row * vi_width_low + first;
+
+    if (vi_fetch_filter_ptr == vi_fetch_filter32)
+        return rdram_hash_idx32(row, (frame_buffer >> 2) + pixel, count);
+    return rdram_hash_pair16(row, (frame_buffer >> 1) + pixel, count);
+}
+
 static void vi_process(void)
 {
     struct ccvg viaa_array[0xa10 << 1];
     struct ccvg divot_array[0xa10 << 1];
 
-    int32_t cache_marker = 0, cache_next_marker = 0, divot_cache_marker = 0, divot_cache_next_marker = 0;
-    int32_t cache_marker_init = (x_start >> 10) - 1;
-
     struct ccvg *viaa_cache = &viaa_array[0];
     struct ccvg *viaa_cache_next = &viaa_array[0xa10];
     struct ccvg *divot_cache = &divot_array[0];
     struct ccvg *divot_cache_next = &divot_array[0xa10];
-
-    struct ccvg color, nextcolor, scancolor, scannextcolor;
+    struct ccvg *tempccvgptr;
 
     uint32_t pixels = 0, nextpixels = 0, fetchbugstate = 0;
 
-    int32_t r = 0, g = 0, b = 0;
-    int32_t xfrac = 0, yfrac = 0;
-    int32_t line_x = 0, next_line_x = 0, prev_line_x = 0, far_line_x = 0;
-    int32_t prev_scan_x = 0, scan_x = 0, next_scan_x = 0, far_scan_x = 0;
-    int32_t prev_x = 0, cur_x = 0, next_x = 0, far_x = 0;
+    int32_t yfrac = 0;
+    int32_t y_begin, y_end, y;
 
-    bool cache_init = false;
+    // the current line's row was already fetched as the previous line's next row
+    bool cache_valid = false;
 
-    pixels = 0;
+    if (hres <= 0)
+        return;
 
-    int32_t y_begin = 0;
-    int32_t y_end = vres;
-    int32_t y_inc = 1;
+    vi_band(vres, &y_begin, &y_end);
 
-    if (config->parallel)
+    // every line reads the same span of cache entries; entry k holds pixel k - 1 of its row
+    uint32_t x_last = x_start + (uint32_t)(hres - 1) * x_add;
+    int32_t cache_lo = x_start >> 10;
+    int32_t cache_hi = (x_last >> 10) + (ctrl.divot_enable ? 3 : 2);
+    uint32_t cache_count = cache_hi - cache_lo + 1;
+
+    bool lerp_en = ctrl.aa_mode != VI_AA_REPLICATE;
+
+    // everything besides the framebuffer rows that a line's output depends on
+    uint64_t frame_key = vi_hash(0, ctrl.raw);
+    frame_key = vi_hash(frame_key, ((uint64_t)x_start << 32) | x_add);
+    frame_key = vi_hash(frame_key, ((uint64_t)(uint32_t)hres << 32) | (uint32_t)vi_width_low);
+    frame_key = vi_hash(frame_key, ((uint64_t)(uint32_t)minhpass << 32) | (uint32_t)maxhpass);
+    frame_key = vi_hash(frame_key, ((uint64_t)prescale_ptr << 32) | (uint32_t)linecount);
+    frame_key = vi_hash(frame_key, frame_buffer);
+
+    // hashes of the last four framebuffer rows, slot = row & 3
+    uint32_t row_memo[4];
+    uint64_t row_memo_hash[4];
+    bool row_memo_valid[4] = {false, false, false, false};
+
+    // the fetch bug state depends on the two preceding lines
+    for (y = y_begin > 2 ? y_begin - 2 : 0; y < y_begin; y++)
     {
-        y_begin = parallel_worker->m_worker_id;
-        y_inc   = parallel_worker_num();
+        if (((y_start + y * y_add) >> 10) == ((y_start + (y + 1) * y_add) >> 10))
+            fetchbugstate = 2;
+        else
+            fetchbugstate >>= 1;
     }
 
-    for (int32_t y = y_begin; y < y_end; y += y_inc)
+    for (y = y_begin; y < y_end; y++)
     {
         uint32_t x_offs = x_start;
         uint32_t curry = y_start + y * y_add;
         uint32_t nexty = y_start + (y + 1) * y_add;
         uint32_t prevy = curry >> 10;
 
-        cache_marker = cache_next_marker = cache_marker_init;
-        if (ctrl.divot_enable)
-            divot_cache_marker = divot_cache_next_marker = cache_marker_init;
-
         int* d = prescale + prescale_ptr + linecount * y;
 
         yfrac = (curry >> 5) & 0x1f;
@@ -1000,154 +1339,146 @@ static void vi_process(void)
         else
             fetchbugstate >>= 1;
 
-        for (int32_t x = 0; x < hres; x++, x_offs += x_add)
+        // the next row only contributes through the vertical lerp
+        bool scan_en = lerp_en && yfrac;
+
+        // a line reads rows prevy - 1 to prevy + 2, two pixels beyond its
+        // cache entries on each side; skip it if none of that changed since
+        // it was last filtered. with gamma dithering on, a skipped line keeps
+        // the dither pattern of the frame that produced it
+        uint64_t key = vi_hash(frame_key, ((uint64_t)prevy << 32) | (yfrac << 8) | fetchbugstate);
+        for (int32_t r = 0; r < 4; r++)
         {
-            line_x = x_offs >> 10;
-            prev_line_x = line_x - 1;
-            next_line_x = line_x + 1;
-            far_line_x = line_x + 2;
-
-            cur_x = pixels + line_x;
-            prev_x = pixels + prev_line_x;
-            next_x = pixels + next_line_x;
-            far_x = pixels + far_line_x;
-
-            scan_x = nextpixels + line_x;
-            prev_scan_x = nextpixels + prev_line_x;
-            next_scan_x = nextpixels + next_line_x;
-            far_scan_x = nextpixels + far_line_x;
-
-            line_x++;
-            prev_line_x++;
-            next_line_x++;
-            far_line_x++;
-
-            xfrac = (x_offs >> 5) & 0x1f;
-
-            int32_t lerping = ctrl.aa_mode != VI_AA_REPLICATE && (xfrac || yfrac);
-
-            if (prev_line_x > cache_marker) {
-                vi_fetch_filter_ptr(&viaa_cache[prev_line_x], frame_buffer, prev_x, ctrl, vi_width_low, 0);
-                vi_fetch_filter_ptr(&viaa_cache[line_x], frame_buffer, cur_x, ctrl, vi_width_low, 0);
-                vi_fetch_filter_ptr(&viaa_cache[next_line_x], frame_buffer, next_x, ctrl, vi_width_low, 0);
-                cache_marker = next_line_x;
-            } else if (line_x > cache_marker) {
-                vi_fetch_filter_ptr(&viaa_cache[line_x], frame_buffer, cur_x, ctrl, vi_width_low, 0);
-                vi_fetch_filter_ptr(&viaa_cache[next_line_x], frame_buffer, next_x, ctrl, vi_width_low, 0);
-                cache_marker = next_line_x;
-            } else if (next_line_x > cache_marker) {
-                vi_fetch_filter_ptr(&viaa_cache[next_line_x], frame_buffer, next_x, ctrl, vi_width_low, 0);
-                cache_marker = next_line_x;
+            uint32_t row = prevy - 1 + r;
+            uint32_t slot = row & 3;
+            if (!row_memo_valid[slot] || row_memo[slot] != row)
+            {
+                row_memo[slot] = row;
+                row_memo_hash[slot] = vi_row_hash(row, cache_lo - 3, cache_count + 4);
+                row_memo_valid[slot] = true;
             }
+            key = vi_hash(key, row_memo_hash[slot]);
+        }
+        key |= 1;
 
-            if (prev_line_x > cache_next_marker) {
-                vi_fetch_filter_ptr(&viaa_cache_next[prev_line_x], frame_buffer, prev_scan_x, ctrl, vi_width_low, fetchbugstate);
-                vi_fetch_filter_ptr(&viaa_cache_next[line_x], frame_buffer, scan_x, ctrl, vi_width_low, fetchbugstate);
-                vi_fetch_filter_ptr(&viaa_cache_next[next_line_x], frame_buffer, next_scan_x, ctrl, vi_width_low, fetchbugstate);
-                cache_next_marker = next_line_x;
-            } else if (line_x > cache_next_marker) {
-                vi_fetch_filter_ptr(&viaa_cache_next[line_x], frame_buffer, scan_x, ctrl, vi_width_low, fetchbugstate);
-                vi_fetch_filter_ptr(&viaa_cache_next[next_line_x], frame_buffer, next_scan_x, ctrl, vi_width_low, fetchbugstate);
-                cache_next_marker = next_line_x;
-            } else if (next_line_x > cache_next_marker) {
-                vi_fetch_filter_ptr(&viaa_cache_next[next_line_x], frame_buffer, next_scan_x, ctrl, vi_width_low, fetchbugstate);
-                cache_next_marker = next_line_x;
+        uint32_t line = (prescale_ptr + linecount * y) / PRESCALE_WIDTH;
+        if (line < PRESCALE_HEIGHT)
+        {
+            if (vi_line_key[line] == key)
+            {
+                cache_valid = false;
+                continue;
             }
+            vi_line_key[line] = key;
+        }
+        vi_lines_changed = true;
+
+        if (!cache_valid)
+        {
+            vi_fetch_row(&viaa_cache[cache_lo], frame_buffer, pixels + cache_lo - 1, cache_count, ctrl, vi_width_low, 0);
+            if (ctrl.divot_enable)
+                vi_divot_row(&divot_cache[cache_lo + 1], &viaa_cache[cache_lo + 1], cache_count - 2);
+        }
 
+        if (scan_en)
+        {
+            vi_fetch_row(&viaa_cache_next[cache_lo], frame_buffer, nextpixels + cache_lo - 1, cache_count, ctrl, vi_width_low, fetchbugstate);
             if (ctrl.divot_enable)
+                vi_divot_row(&divot_cache_next[cache_lo + 1], &viaa_cache_next[cache_lo + 1], cache_count - 2);
+        }
+
+        const struct ccvg* src = ctrl.divot_enable ? divot_cache : viaa_cache;
+        const struct ccvg* scan_src = ctrl.divot_enable ? divot_cache_next : viaa_cache_next;
+
+        for (int32_t x = 0; x < hres; x += 4)
+        {
+            struct ccvg color[4], nextcolor[4], scancolor[4], scannextcolor[4];
+            uint16_t xfrac[16];
+            int32_t num = hres - x < 4 ? hres - x : 4;
+            int32_t i;
+
+            memset(nextcolor, 0, sizeof(nextcolor));
+            memset(scancolor, 0, sizeof(scancolor));
+            memset(scannextcolor, 0, sizeof(scannextcolor));
+
+            for (i = 0; i < num; i++, x_offs += x_add)
             {
-                if (far_line_x > cache_marker)
-                {
-                    vi_fetch_filter_ptr(&viaa_cache[far_line_x], frame_buffer, far_x, ctrl, vi_width_low, 0);
-                    cache_marker = far_line_x;
-                }
+                int32_t line_x = (x_offs >> 10) + 1;
 
-                if (far_line_x > cache_next_marker)
-                {
-                    vi_fetch_filter_ptr(&viaa_cache_next[far_line_x], frame_buffer, far_scan_x, ctrl, vi_width_low, fetchbugstate);
-                    cache_next_marker = far_line_x;
-                }
+                color[i] = src[line_x];
+                xfrac[i << 2] = xfrac[(i << 2) + 1] = xfrac[(i << 2) + 2] = xfrac[(i << 2) + 3] = (x_offs >> 5) & 0x1f;
 
-                if (line_x > divot_cache_marker)
-                {
-                    divot_filter(&divot_cache[line_x], viaa_cache[line_x], viaa_cache[prev_line_x], viaa_cache[next_line_x]);
-                    divot_filter(&divot_cache[next_line_x], viaa_cache[next_line_x], viaa_cache[line_x], viaa_cache[far_line_x]);
-                    divot_cache_marker = next_line_x;
-                }
-                else if (next_line_x > divot_cache_marker)
-                {
-                    divot_filter(&divot_cache[next_line_x], viaa_cache[next_line_x], viaa_cache[line_x], viaa_cache[far_line_x]);
-                    divot_cache_marker = next_line_x;
-                }
+                if (lerp_en)
+                    nextcolor[i] = src[line_x + 1];
 
-                if (line_x > divot_cache_next_marker)
-                {
-                    divot_filter(&divot_cache_next[line_x], viaa_cache_next[line_x], viaa_cache_next[prev_line_x], viaa_cache_next[next_line_x]);
-                    divot_filter(&divot_cache_next[next_line_x], viaa_cache_next[next_line_x], viaa_cache_next[line_x], viaa_cache_next[far_line_x]);
-                    divot_cache_next_marker = next_line_x;
-                }
-                else if (next_line_x > divot_cache_next_marker)
+                if (scan_en)
                 {
-                    divot_filter(&divot_cache_next[next_line_x], viaa_cache_next[next_line_x], viaa_cache_next[line_x], viaa_cache_next[far_line_x]);
-                    divot_cache_next_marker = next_line_x;
+                    scancolor[i] = scan_src[line_x];
+                    scannextcolor[i] = scan_src[line_x + 1];
                 }
-
-                color = divot_cache[line_x];
             }
-            else
-                color = viaa_cache[line_x];
 
-            if (lerping)
+            if (lerp_en)
             {
-                if (ctrl.divot_enable)
+#ifdef VI_SIMD
+                for (; i < 4; i++)
                 {
-                    nextcolor = divot_cache[next_line_x];
-                    scancolor = divot_cache_next[line_x];
-                    scannextcolor = divot_cache_next[next_line_x];
+                    color[i] = nextcolor[i];
+                    xfrac[i << 2] = xfrac[(i << 2) + 1] = xfrac[(i << 2) + 2] = xfrac[(i << 2) + 3] = 0;
                 }
-                else
+
+                vi_vec c = vi_load(color);
+                vi_vec n = vi_load(nextcolor);
+
+                if (scan_en)
                 {
-                    nextcolor = viaa_cache[next_line_x];
-                    scancolor = viaa_cache_next[line_x];
-                    scannextcolor = viaa_cache_next[next_line_x];
+                    vi_vec yf = vi_set1_16(yfrac);
+                    c = vi_lerp_vec(c, vi_load(scancolor), yf, yf);
+                    n = vi_lerp_vec(n, vi_load(scannextcolor), yf, yf);
                 }
 
-                vi_vl_lerp(&color, scancolor, yfrac);
-                vi_vl_lerp(&nextcolor, scannextcolor, yfrac);
-                vi_vl_lerp(&color, nextcolor, xfrac);
+                vi_store(color, vi_lerp_vec(c, n, vi_load(&xfrac[0]), vi_load(&xfrac[8])));
+#else
+                for (i = 0; i < num; i++)
+                {
+                    if (scan_en)
+                    {
+                        vi_vl_lerp(&color[i], scancolor[i], yfrac);
+                        vi_vl_lerp(&nextcolor[i], scannextcolor[i], yfrac);
+                    }
+                    vi_vl_lerp(&color[i], nextcolor[i], xfrac[i << 2]);
+                }
+#endif
             }
 
-            r = color.r;
-            g = color.g;
-            b = color.b;
+            for (i = 0; i < num; i++)
+            {
+                int32_t r = color[i].r;
+                int32_t g = color[i].g;
+                int32_t b = color[i].b;
 
-            gamma_filters(&r, &g, &b, ctrl);
+                gamma_filters(&r, &g, &b, ctrl);
 
-            if (x >= minhpass && x < maxhpass)
-                d[x] = (r << 16) | (g << 8) | b;
-            else
-                d[x] = 0;
+                if (x + i >= minhpass && x + i < maxhpass)
+                    d[x + i] = (r << 16) | (g << 8) | b;
+                else
+                    d[x + i] = 0;
+            }
         }
 
-        if (!cache_init && y_add == 0x400)
-        {
-           cache_marker = cache_next_marker;
-           cache_next_marker = cache_marker_init;
-
-           struct ccvg* tempccvgptr = viaa_cache;
-           viaa_cache = viaa_cache_next;
-           viaa_cache_next = tempccvgptr;
+        // the next row becomes the following line's row if it is the same
+        // source line and was fetched without the fetch bug applied
+        cache_valid = scan_en && !fetchbugstate && (nexty >> 10) == prevy + 1;
 
-           if (ctrl.divot_enable)
-           {
-              divot_cache_marker = divot_cache_next_marker;
-              divot_cache_next_marker = cache_marker_init;
-              tempccvgptr = divot_cache;
-              divot_cache = divot_cache_next;
-              divot_cache_next = tempccvgptr;
-           }
+        if (cache_valid)
+        {
+            tempccvgptr = viaa_cache;
+            viaa_cache = viaa_cache_next;
+            viaa_cache_next = tempccvgptr;
 
-           cache_init = true;
+            tempccvgptr = divot_cache;
+            divot_cache = divot_cache_next;
+            divot_cache_next = tempccvgptr;
         }
     }
 }
@@ -1170,6 +1501,8 @@ static INLINE void screen_upload(int32_t* buffer,
   screen_height=height;
   screen_pitch=width*4;
 
+  vi_frame_changed = true;
+
 
 }
 
@@ -1203,6 +1536,17 @@ static void vi_process_end(void)
     if (config->vi.widescreen)
         output_height = output_height * 9 / 16;
 
+    // the screen buffer still holds this exact frame
+    if (!vi_lines_changed && buffer == upload_buffer && width == upload_width &&
+        height == upload_height && pitch == upload_pitch && output_height == upload_output_height)
+        return;
+
+    upload_buffer = buffer;
+    upload_width = width;
+    upload_height = height;
+    upload_pitch = pitch;
+    upload_output_height = output_height;
+
     screen_upload(buffer, width, height, pitch, output_height);
 }
 
@@ -1233,17 +1577,11 @@ static bool vi_process_start_fast(void)
 
 static void vi_process_fast(void)
 {
-   int32_t y_begin = 0;
-   int32_t y_end = vres_raw;
-   int32_t y_inc = 1;
+   int32_t y_begin, y_end;
 
-   if (config->parallel)
-   {
-      y_begin = parallel_worker->m_worker_id;
-      y_inc = parallel_worker_num();
-   }
+   vi_band(vres_raw, &y_begin, &y_end);
 
-   for (int32_t y = y_begin; y < y_end; y += y_inc)
+   for (int32_t y = y_begin; y < y_end; y++)
    {
       int32_t line = y * vi_width_low;
       uint32_t* dst = (uint32_t*)(prescale + y * hres_raw);
@@ -1321,9 +1659,14 @@ void vi_update(void)
     if (config->vi.mode != vi_mode)
     {
         memset(prescale, 0, sizeof(prescale));
+        memset(vi_line_key, 0, sizeof(vi_line_key));
+        upload_buffer = NULL;
         vi_mode = config->vi.mode;
     }
 
+    vi_frame_changed = false;
+    vi_lines_changed = false;
+
     // check for configuration errors
     if (config->vi.mode >= VI_MODE_NUM)
         msg_error("Invalid VI mode: %d", config->vi.mode);
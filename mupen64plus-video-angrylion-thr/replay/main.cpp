@@ -0,0 +1,475 @@
+// Headless replay of RDPDUMP1 command traces through angrylion's RDP.
+//
+// Traces are recorded by building the core with HAVE_RDP_DUMP=1 and running
+// it with RDP_DUMP=<path> set. The same format is written by paraLLEl, so a
+// trace can be fed to both renderers.
+//
+// The first pass runs single-threaded and times every command by type. It
+// then replays the trace again for each worker count. Each run ends with a
+// hash of RDRAM and the hidden bits, so the tool doubles as a regression check.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdp.h"
+#include "rdram.h"
+#include "parallel_c.hpp"
+#include "rdp_dump.hpp"
+
+using namespace std;
+
+#define RDRAM_SIZE          0x800000
+#define RDRAM_HIDDEN_SIZE   0x400000
+
+static vector<uint8_t> rdram(RDRAM_SIZE);
+static vector<uint8_t> hidden_bits(RDRAM_HIDDEN_SIZE);
+static uint32_t dp_regs[DP_NUM_REG];
+static uint32_t* dp_reg_ptrs[DP_NUM_REG];
+static uint32_t vi_regs[VI_NUM_REG];
+static uint32_t* vi_reg_ptrs[VI_NUM_REG];
+static uint8_t dmem[0x1000];
+
+// glue normally provided by core.cpp and the frontend
+
+extern "C" {
+
+uint32_t** plugin_get_dp_registers(void)
+{
+    return dp_reg_ptrs;
+}
+
+uint32_t** plugin_get_vi_registers(void)
+{
+    return vi_reg_ptrs;
+}
+
+uint8_t* plugin_get_rdram(void)
+{
+    return rdram.data();
+}
+
+uint8_t* plugin_get_rdram_hidden(void)
+{
+    return hidden_bits.data();
+}
+
+uint32_t plugin_get_rdram_size(void)
+{
+    return RDRAM_SIZE;
+}
+
+uint8_t* plugin_get_dmem(void)
+{
+    return dmem;
+}
+
+uint8_t* plugin_get_rom_header(void)
+{
+    return NULL;
+}
+
+unsigned angrylion_get_dithering(void)
+{
+    return 1;
+}
+
+void core_dp_sync(void)
+{
+}
+
+void core_dp_interrupt(void)
+{
+}
+
+void msg_error(const char* err, ...)
+{
+}
+
+void msg_warning(const char* err, ...)
+{
+}
+
+void msg_debug(const char* err, ...)
+{
+}
+
+}
+
+static const char* cmd_names[64] = {
+    "No_Op", "???", "???", "???", "???", "???", "???", "???",
+    "Fill_Triangle", "Fill_ZBuffer_Triangle", "Texture_Triangle",
+    "Texture_ZBuffer_Triangle", "Shade_Triangle", "Shade_ZBuffer_Triangle",
+    "Shade_Texture_Triangle", "Shade_Texture_Z_Buffer_Triangle",
+    "???", "???", "???", "???", "???", "???", "???", "???",
+    "???", "???", "???", "???", "???", "???", "???", "???",
+    "???", "???", "???", "???",
+    "Texture_Rectangle", "Texture_Rectangle_Flip", "Sync_Load", "Sync_Pipe",
+    "Sync_Tile", "Sync_Full", "Set_Key_GB", "Set_Key_R", "Set_Convert",
+    "Set_Scissor", "Set_Prim_Depth", "Set_Other_Modes", "Load_TLUT", "???",
+    "Set_Tile_Size", "Load_Block", "Load_Tile", "Set_Tile", "Fill_Rectangle",
+    "Set_Fill_Color", "Set_Fog_Color", "Set_Blend_Color", "Set_Prim_Color",
+    "Set_Env_Color", "Set_Combine", "Set_Texture_Image", "Set_Mask_Image",
+    "Set_Color_Image"
+};
+
+struct cmd_stats
+{
+    uint64_t count;
+    uint64_t nanoseconds;
+    double pixels;
+};
+
+struct run_result
+{
+    uint32_t workers;
+    double seconds;
+    uint64_t hash;
+};
+
+static int32_t sign_extend(uint32_t x, int bits)
+{
+    return (int32_t)(x << (32 - bits)) >> (32 - bits);
+}
+
+// Estimated number of covered pixels, ignoring scissor and coverage. Only
+// used to put timings into relation, so it doesn't need to be exact.
+static double cmd_pixels(uint32_t cmd, const uint32_t* args, uint32_t words)
+{
+    if (cmd >= CMD_ID_FILL_TRIANGLE && cmd <= CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE)
+    {
+        if (words < 8)
+            return 0;
+
+        // y coordinates are s11.2, x coordinates and slopes s15.16
+        double yl = sign_extend(args[0], 14) / 4.0;
+        double ym = sign_extend(args[1] >> 16, 14) / 4.0;
+        double yh = sign_extend(args[1], 14) / 4.0;
+        double xl = (int32_t)args[2] / 65536.0;
+        double xh = (int32_t)args[4] / 65536.0;
+        double dxhdy = (int32_t)args[5] / 65536.0;
+
+        // width at the middle vertex times half the height
+        double width = xh + dxhdy * (ym - yh) - xl;
+        double area = 0.5 * (yl - yh) * (width < 0 ? -width : width);
+        return area > 0 ? area : 0;
+    }
+
+    if (cmd == CMD_ID_FILL_RECTANGLE || cmd == CMD_ID_TEXTURE_RECTANGLE ||
+        cmd == CMD_ID_TEXTURE_RECTANGLE_FLIP)
+    {
+        // coordinates are u10.2
+        double xl = ((args[0] >> 12) & 0xfff) / 4.0;
+        double yl = (args[0] & 0xfff) / 4.0;
+        double xh = ((args[1] >> 12) & 0xfff) / 4.0;
+        double yh = (args[1] & 0xfff) / 4.0;
+
+        if (xl <= xh || yl <= yh)
+            return 0;
+
+        return (xl - xh) * (yl - yh);
+    }
+
+    return 0;
+}
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void core_reset(struct core_config* config)
+{
+    fill(rdram.begin(), rdram.end(), 0);
+
+    // same initial hidden bits as core_init
+    fill(hidden_bits.begin(), hidden_bits.end(), 0x03);
+
+    rdram_init();
+    rdp_init(config);
+}
+
+static void apply_dram_updates(const RDP::CommandList& list)
+{
+    for (auto& update : list.dram_updates)
+    {
+        if (update.offset + update.payload.size() > rdram.size())
+            continue;
+
+        memcpy(rdram.data() + update.offset, update.payload.data(), update.payload.size());
+    }
+}
+
+// Makes sure all buffered commands have been executed by the workers.
+static void drain(void)
+{
+    uint32_t sync_full[2] = { CMD_ID_SYNC_FULL << 24, 0 };
+    rdp_cmd(sync_full, 2);
+}
+
+// Runs the whole trace once. With a non-NULL stats array, every command is
+// timed individually, which is only meaningful for single-threaded runs.
+static double replay(const RDP::Dump& dump, struct core_config* config, struct cmd_stats* stats)
+{
+    typedef chrono::steady_clock clock;
+    clock::duration total = clock::duration::zero();
+
+    core_reset(config);
+
+    for (auto& list : dump.lists)
+    {
+        // RDRAM updates are the emulated CPU's work and not part of the timing
+        apply_dram_updates(list);
+
+        clock::time_point start = clock::now();
+
+        for (auto& command : list.commands)
+        {
+            uint32_t cmd = command.command & 0x3f;
+            uint32_t words = command.arguments.size();
+
+            if (!words || words > CMD_MAX_INTS)
+                continue;
+
+            if (stats)
+            {
+                clock::time_point cmd_start = clock::now();
+                rdp_cmd(command.arguments.data(), words);
+                clock::duration cmd_time = clock::now() - cmd_start;
+
+                stats[cmd].count++;
+                stats[cmd].nanoseconds += chrono::duration_cast<chrono::nanoseconds>(cmd_time).count();
+                stats[cmd].pixels += cmd_pixels(cmd, command.arguments.data(), words);
+            }
+            else
+                rdp_cmd(command.arguments.data(), words);
+        }
+
+        drain();
+
+        total += clock::now() - start;
+    }
+
+    return chrono::duration<double>(total).count();
+}
+
+static uint64_t rdram_hash(void)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a(hash, rdram.data(), rdram.size());
+    hash = fnv1a(hash, hidden_bits.data(), hidden_bits.size());
+    return hash;
+}
+
+static struct run_result run(const RDP::Dump& dump, uint32_t workers, uint32_t loops, struct cmd_stats* stats)
+{
+    struct core_config config;
+    struct run_result result;
+
+    memset(&config, 0, sizeof(config));
+
+    // worker count 0 is the single-threaded baseline, but the main thread
+    // still needs a worker context for its RDP state
+    config.parallel = workers != 0;
+    config.num_workers = workers;
+    parallel_alinit(workers ? workers : 1);
+
+    result.workers = workers;
+    result.seconds = 0;
+
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        // only collect per-command stats once
+        double seconds = replay(dump, &config, i ? NULL : stats);
+        if (!i || seconds < result.seconds)
+            result.seconds = seconds;
+    }
+
+    result.hash = rdram_hash();
+
+    parallel_close();
+
+    return result;
+}
+
+static vector<uint32_t> parse_workers(const char* str)
+{
+    vector<uint32_t> workers;
+
+    while (*str)
+    {
+        char* end;
+        unsigned long n = strtoul(str, &end, 10);
+        if (end == str)
+            break;
+
+        workers.push_back(n);
+        str = *end == ',' ? end + 1 : end;
+    }
+
+    return workers;
+}
+
+static void print_help(void)
+{
+    fprintf(stderr,
+        "usage: al-replay [options] <dump>\n"
+        "  --workers <n,n,...>  worker counts to benchmark (default: 1, 2, 4, ... up to the core count)\n"
+        "  --loops <n>          replays per worker count, the fastest one is reported (default: 3)\n"
+        "  --expect <hash>      fail if the final RDRAM hash differs\n"
+        "  --help               show this text\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = NULL;
+    const char* expect = NULL;
+    uint32_t loops = 3;
+    vector<uint32_t> workers;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+            workers = parse_workers(argv[++i]);
+        else if (!strcmp(argv[i], "--loops") && i + 1 < argc)
+            loops = max(1ul, strtoul(argv[++i], NULL, 10));
+        else if (!strcmp(argv[i], "--expect") && i + 1 < argc)
+            expect = argv[++i];
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            print_help();
+            return argv[i][1] == 'h' || !strcmp(argv[i], "--help") ? 0 : 1;
+        }
+    }
+
+    if (!path)
+    {
+        print_help();
+        return 1;
+    }
+
+    if (workers.empty())
+    {
+        uint32_t cores = max(1u, thread::hardware_concurrency());
+        for (uint32_t n = 1; n < cores; n <<= 1)
+            workers.push_back(n);
+        workers.push_back(cores);
+    }
+
+    RDP::Dump dump;
+    if (!RDP::load_dump(path, &dump))
+    {
+        fprintf(stderr, "Failed to load dump: %s\n", path);
+        return 1;
+    }
+
+    if (dump.dram_size > RDRAM_SIZE)
+    {
+        fprintf(stderr, "Unsupported RDRAM size: %u\n", (unsigned)dump.dram_size);
+        return 1;
+    }
+
+    for (i = 0; i < DP_NUM_REG; i++)
+        dp_reg_ptrs[i] = &dp_regs[i];
+    for (i = 0; i < VI_NUM_REG; i++)
+        vi_reg_ptrs[i] = &vi_regs[i];
+
+    size_t num_commands = 0;
+    for (auto& list : dump.lists)
+        num_commands += list.commands.size();
+
+    printf("%s: %u command lists, %u commands\n\n", path,
+        (unsigned)dump.lists.size(), (unsigned)num_commands);
+
+    // single-threaded pass with per-command timings
+    struct cmd_stats stats[64];
+    memset(stats, 0, sizeof(stats));
+
+    struct run_result base = run(dump, 0, 1, stats);
+
+    uint64_t total_ns = 0;
+    double total_pixels = 0;
+    for (i = 0; i < 64; i++)
+    {
+        total_ns += stats[i].nanoseconds;
+        total_pixels += stats[i].pixels;
+    }
+
+    vector<int> order;
+    for (i = 0; i < 64; i++)
+        if (stats[i].count)
+            order.push_back(i);
+
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        return stats[a].nanoseconds > stats[b].nanoseconds;
+    });
+
+    printf("%-32s %10s %10s %7s %10s %12s\n",
+        "command", "count", "total ms", "share", "ns/cmd", "est. pixels");
+
+    for (int cmd : order)
+    {
+        printf("%-32s %10llu %10.2f %6.1f%% %10.0f %12.0f\n",
+            cmd_names[cmd],
+            (unsigned long long)stats[cmd].count,
+            stats[cmd].nanoseconds / 1e6,
+            total_ns ? 100.0 * stats[cmd].nanoseconds / total_ns : 0.0,
+            (double)stats[cmd].nanoseconds / stats[cmd].count,
+            stats[cmd].pixels);
+    }
+
+    printf("\n%-10s %10s %10s %12s %18s\n", "workers", "time ms", "speedup", "Mpixels/s", "RDRAM hash");
+
+    vector<struct run_result> results;
+    results.push_back(run(dump, 0, loops, NULL));
+    for (uint32_t n : workers)
+        results.push_back(run(dump, n, loops, NULL));
+
+    bool mismatch = false;
+
+    for (auto& result : results)
+    {
+        char label[16];
+        if (result.workers)
+            snprintf(label, sizeof(label), "%u", result.workers);
+        else
+            snprintf(label, sizeof(label), "serial");
+
+        bool differs = result.hash != base.hash;
+        mismatch |= differs;
+
+        printf("%-10s %10.2f %9.2fx %12.2f  %016llx%s\n",
+            label,
+            result.seconds * 1e3,
+            result.seconds > 0 ? results[0].seconds / result.seconds : 0.0,
+            result.seconds > 0 ? total_pixels / result.seconds / 1e6 : 0.0,
+            (unsigned long long)result.hash,
+            differs ? " MISMATCH" : "");
+    }
+
+    if (mismatch)
+        fprintf(stderr, "\nOutput differs between worker counts.\n");
+
+    if (expect && strtoull(expect, NULL, 16) != base.hash)
+    {
+        fprintf(stderr, "\nRDRAM hash %016llx does not match expected %s.\n",
+            (unsigned long long)base.hash, expect);
+        mismatch = true;
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -38,6 +38,7 @@ struct gliden64_config
 		uint32_t bilinearMode;
 		uint32_t maxBytes;
 		uint32_t screenShotFormat;
+		uint32_t asyncDecode;
 	} texture;
 
 	struct {
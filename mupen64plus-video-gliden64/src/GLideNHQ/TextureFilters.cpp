@@ -22,7 +22,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include "TextureFilters.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /************************************************************************/
 /* 2X filters                                                           */
@@ -259,6 +263,111 @@ void Texture2x_16(uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch
  * Sharp filters
  * Hiroshi Morii <koolsmoky@users.sourceforge.net>
  */
+#if defined(__SSE2__)
+/* SSE2 versions of the 3x3 filter kernels below. They work on four pixels
+ * (16 channels) per step in 16bit lanes, where none of the weighted sums
+ * can overflow, and produce exactly the scalar results. Each returns the
+ * first x left for the scalar loop. The rows are only packed 32bit pixels
+ * where uint32 is 4 bytes, otherwise everything is left to the scalar loop.
+ */
+#define SSE_LOAD_LO(p) _mm_unpacklo_epi8(_mm_loadu_si128((const __m128i*)(p)), _mm_setzero_si128())
+#define SSE_LOAD_HI(p) _mm_unpackhi_epi8(_mm_loadu_si128((const __m128i*)(p)), _mm_setzero_si128())
+
+static uint32 SharpRow_8888_SSE2(const uint32 *_src1, const uint32 *_src2, const uint32 *_src3, uint32 *_dest,
+								 uint32 srcwidth, uint32 mul2, uint32 mul3, uint32 shift4)
+{
+	const __m128i m2 = _mm_set1_epi16((short)mul2);
+	const __m128i m3 = _mm_set1_epi16((short)mul3);
+	const __m128i sh = _mm_cvtsi32_si128(shift4);
+	uint32 x = 1;
+	if (sizeof(uint32) != 4)
+		return x;
+	for (; x + 4 <= srcwidth - 1; x += 4) {
+		__m128i res[2];
+		for (int h = 0; h < 2; h++) {
+			__m128i t5, sum;
+			if (h == 0) {
+				t5 = SSE_LOAD_LO(_src2 + x);
+				sum = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_LO(_src1 + x - 1), SSE_LOAD_LO(_src1 + x)),
+									_mm_add_epi16(SSE_LOAD_LO(_src1 + x + 1), SSE_LOAD_LO(_src2 + x - 1)));
+				sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_add_epi16(SSE_LOAD_LO(_src2 + x + 1), SSE_LOAD_LO(_src3 + x - 1)),
+													   _mm_add_epi16(SSE_LOAD_LO(_src3 + x), SSE_LOAD_LO(_src3 + x + 1))));
+			} else {
+				t5 = SSE_LOAD_HI(_src2 + x);
+				sum = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_HI(_src1 + x - 1), SSE_LOAD_HI(_src1 + x)),
+									_mm_add_epi16(SSE_LOAD_HI(_src1 + x + 1), SSE_LOAD_HI(_src2 + x - 1)));
+				sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_add_epi16(SSE_LOAD_HI(_src2 + x + 1), SSE_LOAD_HI(_src3 + x - 1)),
+													   _mm_add_epi16(SSE_LOAD_HI(_src3 + x), SSE_LOAD_HI(_src3 + x + 1))));
+			}
+			/* (t5*mul2) > sum ? ((t5*mul3) - sum)>>shift4 : t5 */
+			const __m128i sharpen = _mm_cmpgt_epi16(_mm_mullo_epi16(t5, m2), sum);
+			const __m128i val = _mm_srl_epi16(_mm_sub_epi16(_mm_mullo_epi16(t5, m3), sum), sh);
+			res[h] = _mm_or_si128(_mm_and_si128(sharpen, val), _mm_andnot_si128(sharpen, t5));
+		}
+		/* saturating pack is the clamp to 0xFF */
+		_mm_storeu_si128((__m128i*)(_dest + x), _mm_packus_epi16(res[0], res[1]));
+	}
+	return x;
+}
+
+static uint32 SmoothRow_8888_SSE2(const uint32 *_src1, const uint32 *_src2, const uint32 *_src3, uint32 *_dest,
+								  uint32 srcwidth, uint32 mul2, uint32 mul3, uint32 shift4)
+{
+	/* mul1 is 1 for all smooth filters */
+	const __m128i m2 = _mm_set1_epi16((short)mul2);
+	const __m128i m3 = _mm_set1_epi16((short)mul3);
+	const __m128i sh = _mm_cvtsi32_si128(shift4);
+	uint32 x = 1;
+	if (sizeof(uint32) != 4)
+		return x;
+	for (; x + 4 <= srcwidth - 1; x += 4) {
+		__m128i res[2];
+		for (int h = 0; h < 2; h++) {
+			__m128i corners, edges, t5;
+			if (h == 0) {
+				corners = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_LO(_src1 + x - 1), SSE_LOAD_LO(_src1 + x + 1)),
+										_mm_add_epi16(SSE_LOAD_LO(_src3 + x - 1), SSE_LOAD_LO(_src3 + x + 1)));
+				edges = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_LO(_src1 + x), SSE_LOAD_LO(_src2 + x - 1)),
+									  _mm_add_epi16(SSE_LOAD_LO(_src2 + x + 1), SSE_LOAD_LO(_src3 + x)));
+				t5 = SSE_LOAD_LO(_src2 + x);
+			} else {
+				corners = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_HI(_src1 + x - 1), SSE_LOAD_HI(_src1 + x + 1)),
+										_mm_add_epi16(SSE_LOAD_HI(_src3 + x - 1), SSE_LOAD_HI(_src3 + x + 1)));
+				edges = _mm_add_epi16(_mm_add_epi16(SSE_LOAD_HI(_src1 + x), SSE_LOAD_HI(_src2 + x - 1)),
+									  _mm_add_epi16(SSE_LOAD_HI(_src2 + x + 1), SSE_LOAD_HI(_src3 + x)));
+				t5 = SSE_LOAD_HI(_src2 + x);
+			}
+			res[h] = _mm_srl_epi16(_mm_add_epi16(_mm_add_epi16(corners, _mm_mullo_epi16(edges, m2)),
+												 _mm_mullo_epi16(t5, m3)), sh);
+		}
+		_mm_storeu_si128((__m128i*)(_dest + x), _mm_packus_epi16(res[0], res[1]));
+	}
+	return x;
+}
+
+static uint32 SmoothColumn_8888_SSE2(const uint32 *_src1, const uint32 *_src2, const uint32 *_src3, uint32 *_dest,
+									 uint32 srcwidth, uint32 mul2, uint32 mul3, uint32 shift4)
+{
+	const __m128i m2 = _mm_set1_epi16((short)mul2);
+	const __m128i m3 = _mm_set1_epi16((short)mul3);
+	const __m128i sh = _mm_cvtsi32_si128(shift4);
+	uint32 x = 0;
+	if (sizeof(uint32) != 4)
+		return x;
+	for (; x + 4 <= srcwidth; x += 4) {
+		const __m128i lo = _mm_srl_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_add_epi16(SSE_LOAD_LO(_src1 + x), SSE_LOAD_LO(_src3 + x)), m2),
+													   _mm_mullo_epi16(SSE_LOAD_LO(_src2 + x), m3)), sh);
+		const __m128i hi = _mm_srl_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_add_epi16(SSE_LOAD_HI(_src1 + x), SSE_LOAD_HI(_src3 + x)), m2),
+													   _mm_mullo_epi16(SSE_LOAD_HI(_src2 + x), m3)), sh);
+		_mm_storeu_si128((__m128i*)(_dest + x), _mm_packus_epi16(lo, hi));
+	}
+	return x;
+}
+
+#undef SSE_LOAD_LO
+#undef SSE_LOAD_HI
+#endif /* __SSE2__ */
+
 void SharpFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter)
 {
 	// NOTE: for now we get away with copying the boundaries
@@ -302,7 +411,12 @@ void SharpFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *de
 		// copy the first pixel
 		_dest[0] = *_src2;
 		// filter 2nd pixel to 1 pixel before last
-		for (x = 1; x < srcwidth-1; x++) {
+#if defined(__SSE2__)
+		x = SharpRow_8888_SSE2(_src1, _src2, _src3, _dest, srcwidth, mul2, mul3, shift4);
+#else
+		x = 1;
+#endif
+		for (; x < srcwidth-1; x++) {
 			for (z=0; z<4; z++) {
 				t1 = *((uint8*)(_src1+x-1)+z);
 				t2 = *((uint8*)(_src1+x  )+z);
@@ -476,7 +590,12 @@ void SmoothFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *d
 			// copy the first pixel
 			_dest[0] = _src2[0];
 			// filter 2nd pixel to 1 pixel before last
-			for (x = 1; x < srcwidth - 1; x++) {
+#if defined(__SSE2__)
+			x = SmoothRow_8888_SSE2(_src1, _src2, _src3, _dest, srcwidth, mul2, mul3, shift4);
+#else
+			x = 1;
+#endif
+			for (; x < srcwidth - 1; x++) {
 				for (z = 0; z < 4; z++ ) {
 					t1 = *((uint8*)(_src1+x-1)+z);
 					t2 = *((uint8*)(_src1+x  )+z);
@@ -519,7 +638,12 @@ void SmoothFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *d
 		for (y = 1; y < srcheight - 1; y++) {
 			// filter 1st pixel to the last
 			if (y & 1) {
-				for( x = 0; x < srcwidth; x++) {
+#if defined(__SSE2__)
+				x = SmoothColumn_8888_SSE2(_src1, _src2, _src3, _dest, srcwidth, mul2, mul3, shift4);
+#else
+				x = 0;
+#endif
+				for(; x < srcwidth; x++) {
 					for( z = 0; z < 4; z++ ) {
 						t2 = *((uint8*)(_src1+x  )+z);
 						t5 = *((uint8*)(_src2+x  )+z);
@@ -728,3 +852,69 @@ void filter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, u
 	return;
 	}
 }
+
+/* rows of source context a filter reads above and below an output row.
+ * 2xSaI looks two rows down, the others one. */
+#define FILTER_HALO_ROWS 2
+
+static uint32 filter_scale(uint32 filter)
+{
+	switch (filter & ENHANCEMENT_MASK) {
+	case NO_ENHANCEMENT:
+		return 1;
+	case BRZ3X_ENHANCEMENT:
+		return 3;
+	case HQ4X_ENHANCEMENT:
+	case BRZ4X_ENHANCEMENT:
+		return 4;
+	case BRZ5X_ENHANCEMENT:
+		return 5;
+	case BRZ6X_ENHANCEMENT:
+		return 6;
+	}
+	return 2;
+}
+
+void filter_8888_rows(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter,
+					  uint32 yFirst, uint32 yLast)
+{
+	if (yLast > srcheight)
+		yLast = srcheight;
+	if (yFirst >= yLast)
+		return;
+
+	const uint32 scale = filter_scale(filter);
+	const uint32 destRow = srcwidth * scale * scale;
+
+	switch (filter & ENHANCEMENT_MASK) {
+	case BRZ2X_ENHANCEMENT:
+	case BRZ3X_ENHANCEMENT:
+	case BRZ4X_ENHANCEMENT:
+	case BRZ5X_ENHANCEMENT:
+	case BRZ6X_ENHANCEMENT:
+		/* xBRZ slices on its own */
+		xbrz::scale(scale, (const uint32_t *)const_cast<const uint32 *>(src), (uint32_t *)dest, srcwidth, srcheight,
+					xbrz::ColorFormat::ABGR, xbrz::ScalerCfg(), yFirst, yLast);
+		return;
+	}
+
+	/* everything else treats the first and last rows it is given as image
+	 * borders. filter the band with its halo into scratch memory and keep
+	 * only the rows we own, which then match a whole-image run.
+	 * yFirst must be even, the smooth filters alternate on row parity.
+	 */
+	const uint32 haloFirst = yFirst > FILTER_HALO_ROWS ? yFirst - FILTER_HALO_ROWS : 0;
+	const uint32 haloLast = (srcheight - yLast) > FILTER_HALO_ROWS ? yLast + FILTER_HALO_ROWS : srcheight;
+
+	if (haloFirst == yFirst && haloLast == yLast) {
+		filter_8888(src + yFirst * srcwidth, srcwidth, yLast - yFirst, dest + yFirst * destRow, filter);
+		return;
+	}
+
+	uint32 *tmp = (uint32*)malloc((haloLast - haloFirst) * destRow * sizeof(uint32));
+	if (!tmp)
+		return;
+	filter_8888(src + haloFirst * srcwidth, srcwidth, haloLast - haloFirst, tmp, filter);
+	memcpy(dest + yFirst * destRow, tmp + (yFirst - haloFirst) * destRow, (yLast - yFirst) * destRow * sizeof(uint32));
+	free(tmp);
+}
@@ -54,6 +54,9 @@ void SmoothFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *d
 
 /* helper */
 void filter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter);
+/* filters source rows [yFirst, yLast) of the whole image; bands may run in parallel */
+void filter_8888_rows(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter,
+					  uint32 yFirst, uint32 yLast);
 
 #if !_16BPP_HACK
 void hq4x_init(void);
@@ -24,6 +24,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 /* 2007 Mudlord - Added hq2xS lq2xS filters */
 
 #include "TextureFilters.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /************************************************************************/
 /* hq2x filters                                                         */
@@ -268,6 +271,61 @@ static int hq2x_interp_32_diff(uint32 p1, uint32 p2)
   return 0;
 }
 
+#if defined(__SSE2__)
+/* hq2x_interp_32_diff of four pixels against p2, one result bit each */
+static int hq2x_interp_32_diff4(__m128i p1, __m128i p2)
+{
+  const __m128i byte = _mm_set1_epi32(0xFF);
+  const __m128i same = _mm_cmpeq_epi32(_mm_and_si128(_mm_xor_si128(p1, p2), _mm_set1_epi32(0xF8F8F8)), _mm_setzero_si128());
+
+  const __m128i r = _mm_sub_epi32(_mm_and_si128(p1, byte), _mm_and_si128(p2, byte));
+  const __m128i g = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(p1, 8), byte), _mm_and_si128(_mm_srli_epi32(p2, 8), byte));
+  const __m128i b = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(p1, 16), byte), _mm_and_si128(_mm_srli_epi32(p2, 16), byte));
+
+  const __m128i y = _mm_add_epi32(_mm_add_epi32(r, g), b);
+  const __m128i u = _mm_sub_epi32(r, b);
+  const __m128i v = _mm_sub_epi32(_mm_add_epi32(g, g), _mm_add_epi32(r, b));
+
+  __m128i out = _mm_or_si128(_mm_cmpgt_epi32(y, _mm_set1_epi32(INTERP_Y_LIMIT)), _mm_cmplt_epi32(y, _mm_set1_epi32(-INTERP_Y_LIMIT)));
+  out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(u, _mm_set1_epi32(INTERP_U_LIMIT)), _mm_cmplt_epi32(u, _mm_set1_epi32(-INTERP_U_LIMIT))));
+  out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(v, _mm_set1_epi32(INTERP_V_LIMIT)), _mm_cmplt_epi32(v, _mm_set1_epi32(-INTERP_V_LIMIT))));
+
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(same, out)));
+}
+#endif
+
+/* neighbourhood mask of the 3x3 block c[] around c[4] */
+static unsigned char hq2x_interp_32_mask(const uint32 *c)
+{
+#if defined(__SSE2__)
+  /* uint32 is not 32bit everywhere, so gather the pixels instead of loading c[] */
+  const __m128i center = _mm_set1_epi32((int)c[4]);
+  return (unsigned char)(hq2x_interp_32_diff4(_mm_setr_epi32((int)c[0], (int)c[1], (int)c[2], (int)c[3]), center)
+						 | (hq2x_interp_32_diff4(_mm_setr_epi32((int)c[5], (int)c[6], (int)c[7], (int)c[8]), center) << 4));
+#else
+  unsigned char mask = 0;
+
+  if (hq2x_interp_32_diff(c[0], c[4]))
+	mask |= 1 << 0;
+  if (hq2x_interp_32_diff(c[1], c[4]))
+	mask |= 1 << 1;
+  if (hq2x_interp_32_diff(c[2], c[4]))
+	mask |= 1 << 2;
+  if (hq2x_interp_32_diff(c[3], c[4]))
+	mask |= 1 << 3;
+  if (hq2x_interp_32_diff(c[5], c[4]))
+	mask |= 1 << 4;
+  if (hq2x_interp_32_diff(c[6], c[4]))
+	mask |= 1 << 5;
+  if (hq2x_interp_32_diff(c[7], c[4]))
+	mask |= 1 << 6;
+  if (hq2x_interp_32_diff(c[8], c[4]))
+	mask |= 1 << 7;
+
+  return mask;
+#endif
+}
+
 /*static void interp_set(unsigned bits_per_pixel)
 {
    interp_bits_per_pixel = bits_per_pixel;
@@ -556,24 +614,7 @@ static void hq2x_32_def(uint32* dst0, uint32* dst1, const uint32* src0, const ui
 	  c[8] = src2[0];
 	}
 
-	mask = 0;
-
-	if (hq2x_interp_32_diff(c[0], c[4]))
-	  mask |= 1 << 0;
-	if (hq2x_interp_32_diff(c[1], c[4]))
-	  mask |= 1 << 1;
-	if (hq2x_interp_32_diff(c[2], c[4]))
-	  mask |= 1 << 2;
-	if (hq2x_interp_32_diff(c[3], c[4]))
-	  mask |= 1 << 3;
-	if (hq2x_interp_32_diff(c[5], c[4]))
-	  mask |= 1 << 4;
-	if (hq2x_interp_32_diff(c[6], c[4]))
-	  mask |= 1 << 5;
-	if (hq2x_interp_32_diff(c[7], c[4]))
-	  mask |= 1 << 6;
-	if (hq2x_interp_32_diff(c[8], c[4]))
-	  mask |= 1 << 7;
+	mask = hq2x_interp_32_mask(c);
 
 #define P0 dst0[0]
 #define P1 dst0[1]
@@ -1125,7 +1166,7 @@ static void lq2xS_32_def(uint32* dst0, uint32* dst1, const uint32* src0, const u
   unsigned i;
 
   for(i=0;i<count;++i) {
-	unsigned char mask;
+	unsigned char mask = 0;
 
 	uint32 c[9];
 
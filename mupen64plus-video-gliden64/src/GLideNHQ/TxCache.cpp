@@ -31,6 +31,14 @@
 #include <zlib.h>
 #include <memory.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#ifndef OS_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 TxCache::~TxCache()
 {
@@ -50,6 +58,17 @@ TxCache::TxCache(int options, int cachesize, const wchar_t *path, const wchar_t
 	_callback = callback;
 	_totalSize = 0;
 
+	_packData = NULL;
+	_packSize = 0;
+	_packIndex = NULL;
+	_packCount = 0;
+#ifdef OS_WINDOWS
+	_packFile = INVALID_HANDLE_VALUE;
+	_packMapping = NULL;
+#else
+	_packMapped = 0;
+#endif
+
 	/* save path name */
 	if (path)
 		_path.assign(path);
@@ -186,7 +205,7 @@ TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 boolean
 TxCache::get(uint64 checksum, GHQTexInfo *info)
 {
-	if (!checksum || _cache.empty()) return 0;
+	if (!checksum) return 0;
 
 	/* find a match in cache */
 	std::map<uint64, TXCACHE*>::iterator itMap = _cache.find(checksum);
@@ -217,6 +236,31 @@ TxCache::get(uint64 checksum, GHQTexInfo *info)
 		return 1;
 	}
 
+	/* not in memory, look it up in the mapped cache file */
+	const TXPACKENTRY *entry = findPack(checksum);
+	if (entry) {
+		info->data = _packData + entry->offset;
+		info->width = entry->width;
+		info->height = entry->height;
+		info->format = entry->format;
+		info->texture_format = entry->texture_format;
+		info->pixel_type = entry->pixel_type;
+		info->is_hires_tex = entry->is_hires_tex;
+
+		/* raw entries are handed out straight from the mapping */
+		if (info->format & GL_TEXFMT_GZ) {
+			uint32 destLen = _gzdestLen;
+			if (!destLen || uncompress(_gzdest0, &destLen, info->data, entry->size) != Z_OK) {
+				DBG_INFO(80, wst("Error: zlib decompression failed!\n"));
+				return 0;
+			}
+			info->data = _gzdest0;
+			info->format &= ~GL_TEXFMT_GZ;
+		}
+
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -245,58 +289,107 @@ TxCache::save(const wchar_t *path, const wchar_t *filename, int config)
 
 	wcstombs(cbuf, filename, MAX_PATH);
 
-	gzFile gzfp = gzopen(cbuf, "wb1");
-	DBG_INFO(80, wst("gzfp:%x file:%ls\n"), gzfp, filename);
-	if (gzfp) {
-		/* write header to determine config match */
-		gzwrite(gzfp, &config, 4);
-
-		std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
-		int total = 0;
-		while (itMap != _cache.end()) {
-			uint8 *dest = (*itMap).second->info.data;
-			uint32 destLen = (*itMap).second->size;
-			uint32 format = (*itMap).second->info.format;
-
-			/* to keep things simple, we save the texture data in a zlib uncompressed state. */
-			/* sigh... for those who cannot wait the extra few seconds. changed to keep
-	 * texture data in a zlib compressed state. if the GZ_TEXCACHE or GZ_HIRESTEXCACHE
-	 * option is toggled, the cache will need to be rebuilt.
+	/* merge the memory cache with whatever is still only in the mapped
+	 * file. both are ordered by checksum, so the index comes out sorted.
 	 */
-			/*if (format & GL_TEXFMT_GZ) {
-	  dest = _gzdest0;
-	  destLen = _gzdestLen;
-	  if (dest && destLen) {
-	  if (uncompress(dest, &destLen, (*itMap).second->info.data, (*itMap).second->size) != Z_OK) {
-	  dest = NULL;
-	  destLen = 0;
-	  }
-	  format &= ~GL_TEXFMT_GZ;
-	  }
-	  }*/
-
-			if (dest && destLen) {
-				/* texture checksum */
-				gzwrite(gzfp, &((*itMap).first), 8);
-
-				/* other texture info */
-				gzwrite(gzfp, &((*itMap).second->info.width), 4);
-				gzwrite(gzfp, &((*itMap).second->info.height), 4);
-				gzwrite(gzfp, &format, 4);
-				gzwrite(gzfp, &((*itMap).second->info.texture_format), 2);
-				gzwrite(gzfp, &((*itMap).second->info.pixel_type), 2);
-				gzwrite(gzfp, &((*itMap).second->info.is_hires_tex), 1);
-
-				gzwrite(gzfp, &destLen, 4);
-				gzwrite(gzfp, dest, destLen);
+	std::vector<TXPACKENTRY> index;
+	std::vector<const uint8*> blobs;
+	index.reserve(_cache.size() + _packCount);
+	blobs.reserve(_cache.size() + _packCount);
+
+	std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
+	uint32 packPos = 0;
+	while (itMap != _cache.end() || packPos < _packCount) {
+		TXPACKENTRY entry;
+		memset(&entry, 0, sizeof(entry));
+
+		if (itMap == _cache.end() || (packPos < _packCount && _packIndex[packPos].checksum < (*itMap).first)) {
+			entry = _packIndex[packPos];
+			blobs.push_back(_packData + entry.offset);
+			packPos++;
+		} else {
+			/* texture data is kept in a zlib compressed state if the GZ_TEXCACHE or
+			 * GZ_HIRESTEXCACHE option is set. if it is toggled, the cache will need
+			 * to be rebuilt.
+			 */
+			if (packPos < _packCount && _packIndex[packPos].checksum == (*itMap).first)
+				packPos++;
+
+			if (!(*itMap).second->info.data || !(*itMap).second->size) {
+				itMap++;
+				continue;
 			}
 
+			entry.checksum = (*itMap).first;
+			entry.size = (*itMap).second->size;
+			entry.width = (*itMap).second->info.width;
+			entry.height = (*itMap).second->info.height;
+			entry.format = (*itMap).second->info.format;
+			entry.texture_format = (*itMap).second->info.texture_format;
+			entry.pixel_type = (*itMap).second->info.pixel_type;
+			entry.is_hires_tex = (*itMap).second->info.is_hires_tex;
+			blobs.push_back((*itMap).second->info.data);
 			itMap++;
+		}
+		index.push_back(entry);
+	}
+
+	/* write to a temporary file first, the old one may still be mapped */
+	std::string tmpname(cbuf);
+	tmpname += ".tmp";
+
+	FILE *fp = fopen(tmpname.c_str(), "wb");
+	DBG_INFO(80, wst("fp:%x file:%ls\n"), fp, filename);
+	if (fp) {
+		static const uint8 zero[8] = { 0 };
+		TXPACKHEADER header;
+		header.magic = TXPACK_MAGIC;
+		header.version = TXPACK_VERSION;
+		/* header config to determine config match */
+		header.config = config;
+		header.count = (uint32)index.size();
+		header.indexOffset = 0;
+		boolean ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+		uint64 offset = sizeof(header);
+		for (uint32 i = 0; ok && i < index.size(); i++) {
+			/* keep every blob 8-byte aligned inside the mapping */
+			uint32 pad = (uint32)((8 - (offset & 7)) & 7);
+			if (pad && fwrite(zero, 1, pad, fp) != pad)
+				ok = 0;
+			offset += pad;
+
+			index[i].offset = offset;
+			if (fwrite(blobs[i], 1, index[i].size, fp) != index[i].size)
+				ok = 0;
+			offset += index[i].size;
 
 			if (_callback)
-				(*_callback)(wst("Total textures saved to HDD: %d\n"), ++total);
+				(*_callback)(wst("Total textures saved to HDD: %d\n"), i + 1);
+		}
+
+		uint32 pad = (uint32)((8 - (offset & 7)) & 7);
+		if (ok && pad && fwrite(zero, 1, pad, fp) != pad)
+			ok = 0;
+		header.indexOffset = offset + pad;
+
+		if (ok && !index.empty() && fwrite(&index[0], sizeof(TXPACKENTRY), index.size(), fp) != index.size())
+			ok = 0;
+		if (ok && (fseek(fp, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, fp) != 1))
+			ok = 0;
+		if (fclose(fp))
+			ok = 0;
+
+		if (ok) {
+			/* blobs may point into the old mapping, so swap files only now */
+			unmapPack();
+			remove(cbuf);
+			if (rename(tmpname.c_str(), cbuf) == 0)
+				mapPack(cbuf, config);
+		} else {
+			DBG_INFO(80, wst("Error: failed to write cache file %ls\n"), filename);
+			remove(tmpname.c_str());
 		}
-		gzclose(gzfp);
 	}
 
 	CHDIR(curpath);
@@ -323,8 +416,35 @@ TxCache::load(const wchar_t *path, const wchar_t *filename, int config)
 
 	wcstombs(cbuf, filename, MAX_PATH);
 
-	gzFile gzfp = gzopen(cbuf, "rb");
-	DBG_INFO(80, wst("gzfp:%x file:%ls\n"), gzfp, filename);
+	boolean legacy = 0;
+	if (mapPack(cbuf, config)) {
+		if (_callback)
+			(*_callback)(wst("[%d] textures indexed - %ls\n"), _packCount, filename);
+	} else {
+		legacy = loadLegacy(cbuf, filename, config);
+	}
+
+	CHDIR(curpath);
+
+	if (legacy) {
+		/* convert old gzip streams to the indexed layout so that the next
+		 * start only has to map the file. the textures are then served from
+		 * the mapping and the memory copies can go.
+		 */
+		save(path, filename, config);
+		if (_packCount) {
+			freeCache();
+		}
+	}
+
+	return !_cache.empty() || _packCount;
+}
+
+boolean
+TxCache::loadLegacy(const char *filename, const wchar_t *wfilename, int config)
+{
+	gzFile gzfp = gzopen(filename, "rb");
+	DBG_INFO(80, wst("gzfp:%x file:%ls\n"), gzfp, wfilename);
 	if (gzfp) {
 		/* yep, we have it. load it into memory cache. */
 		int dataSize;
@@ -362,18 +482,139 @@ TxCache::load(const wchar_t *path, const wchar_t *filename, int config)
 
 				/* skip in between to prevent the loop from being tied down to vsync */
 				if (_callback && (!(_cache.size() % 100) || gzeof(gzfp)))
-					(*_callback)(wst("[%d] total mem:%.02fmb - %ls\n"), _cache.size(), (float)_totalSize/1000000, filename);
+					(*_callback)(wst("[%d] total mem:%.02fmb - %ls\n"), _cache.size(), (float)_totalSize/1000000, wfilename);
 
 			} while (!gzeof(gzfp));
-			gzclose(gzfp);
 		}
+		gzclose(gzfp);
 	}
 
-	CHDIR(curpath);
-
 	return !_cache.empty();
 }
 
+boolean
+TxCache::mapPack(const char *filename, int config)
+{
+	unmapPack();
+
+	uint8 *data = NULL;
+	uint64 size = 0;
+
+#ifdef OS_WINDOWS
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+							  OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(TXPACKHEADER)) {
+		CloseHandle(file);
+		return 0;
+	}
+	size = (uint64)fileSize.QuadPart;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+		data = (uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return 0;
+	}
+	_packFile = file;
+	_packMapping = mapping;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TXPACKHEADER)) {
+		close(fd);
+		return 0;
+	}
+	size = (uint64)st.st_size;
+
+	void *addr = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+	/* the mapping keeps its own reference to the file */
+	close(fd);
+	if (addr == MAP_FAILED)
+		return 0;
+	data = (uint8*)addr;
+#ifdef MADV_RANDOM
+	/* lookups jump all over the file, don't let the kernel read ahead */
+	madvise(addr, (size_t)size, MADV_RANDOM);
+#endif
+	_packMapped = 1;
+#endif
+
+	_packData = data;
+	_packSize = size;
+
+	/* anything else, e.g. an old gzip stream, is left to loadLegacy */
+	const TXPACKHEADER *header = (const TXPACKHEADER*)data;
+	if (header->magic != TXPACK_MAGIC || header->version != TXPACK_VERSION ||
+		header->config != config || (header->indexOffset & 7) ||
+		header->indexOffset > size ||
+		(uint64)header->count * sizeof(TXPACKENTRY) > size - header->indexOffset) {
+		unmapPack();
+		return 0;
+	}
+
+	_packIndex = (const TXPACKENTRY*)(data + header->indexOffset);
+	_packCount = header->count;
+
+	DBG_INFO(80, wst("mapped cache file: %d textures, %.02fmb\n"), _packCount, (float)size/1000000);
+
+	return 1;
+}
+
+void
+TxCache::unmapPack()
+{
+#ifdef OS_WINDOWS
+	if (_packData) UnmapViewOfFile(_packData);
+	if (_packMapping) CloseHandle(_packMapping);
+	if (_packFile != INVALID_HANDLE_VALUE) CloseHandle(_packFile);
+	_packMapping = NULL;
+	_packFile = INVALID_HANDLE_VALUE;
+#else
+	if (_packMapped) munmap(_packData, (size_t)_packSize);
+	_packMapped = 0;
+#endif
+
+	_packData = NULL;
+	_packSize = 0;
+	_packIndex = NULL;
+	_packCount = 0;
+}
+
+const TXPACKENTRY *
+TxCache::findPack(uint64 checksum) const
+{
+	/* binary search the sorted index */
+	uint32 lo = 0;
+	uint32 hi = _packCount;
+	while (lo < hi) {
+		uint32 mid = lo + ((hi - lo) >> 1);
+		if (_packIndex[mid].checksum < checksum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == _packCount || _packIndex[lo].checksum != checksum)
+		return NULL;
+
+	/* don't trust the entry to stay inside the data area */
+	const TXPACKENTRY *entry = &_packIndex[lo];
+	const uint64 dataEnd = (uint64)((const uint8*)_packIndex - _packData);
+	if (entry->offset < sizeof(TXPACKHEADER) || entry->offset > dataEnd || entry->size > dataEnd - entry->offset)
+		return NULL;
+
+	return entry;
+}
+
 boolean
 TxCache::del(uint64 checksum)
 {
@@ -405,11 +646,18 @@ TxCache::is_cached(uint64 checksum)
 	std::map<uint64, TXCACHE*>::iterator itMap = _cache.find(checksum);
 	if (itMap != _cache.end()) return 1;
 
-	return 0;
+	return findPack(checksum) != NULL;
 }
 
 void
 TxCache::clear()
+{
+	freeCache();
+	unmapPack();
+}
+
+void
+TxCache::freeCache()
 {
 	if (!_cache.empty()) {
 		std::map<uint64, TXCACHE*>::iterator itMap = _cache.begin();
@@ -26,9 +26,42 @@
 
 #include "TxInternal.h"
 #include "TxUtil.h"
+#include <stdint.h>
 #include <list>
 #include <map>
 
+/* indexed cache file layout:
+ *   TXPACKHEADER
+ *   texture data blobs, each stored raw or zlib compressed (GL_TEXFMT_GZ)
+ *   TXPACKENTRY[count], sorted by checksum
+ * the file is mapped read-only and textures are looked up on demand,
+ * so nothing but the index is touched at load time.
+ */
+#define TXPACK_MAGIC   0x50544847 /* "GHTP" */
+#define TXPACK_VERSION 1
+
+struct TXPACKHEADER {
+  uint32_t magic;
+  uint32_t version;
+  int32_t config;
+  uint32_t count;
+  uint64_t indexOffset;
+};
+
+/* fixed width fields, uint32 is not 4 bytes on every target */
+struct TXPACKENTRY {
+  uint64_t checksum;
+  uint64_t offset;
+  uint32_t size;
+  int32_t width;
+  int32_t height;
+  uint32_t format;
+  uint16_t texture_format;
+  uint16_t pixel_type;
+  uint8_t is_hires_tex;
+  uint8_t pad[3];
+};
+
 class TxCache
 {
 private:
@@ -36,6 +69,22 @@ private:
   uint8 *_gzdest0;
   uint8 *_gzdest1;
   uint32 _gzdestLen;
+  /* mapped indexed cache file */
+  uint8 *_packData;
+  uint64 _packSize;
+  const TXPACKENTRY *_packIndex;
+  uint32 _packCount;
+#ifdef OS_WINDOWS
+  HANDLE _packFile;
+  HANDLE _packMapping;
+#else
+  boolean _packMapped;
+#endif
+  boolean mapPack(const char *filename, int config);
+  void unmapPack();
+  const TXPACKENTRY *findPack(uint64 checksum) const;
+  boolean loadLegacy(const char *filename, const wchar_t *wfilename, int config);
+  void freeCache();
 protected:
   int _options;
   tx_wstring _ident;
@@ -55,6 +104,7 @@ protected:
   boolean del(uint64 checksum); /* checksum hi:palette low:texture */
   boolean is_cached(uint64 checksum); /* checksum hi:palette low:texture */
   void clear();
+  uint32 packCount() const { return _packCount; }
 public:
   ~TxCache();
   TxCache(int options, int cachesize, const wchar_t *path, const wchar_t *ident,
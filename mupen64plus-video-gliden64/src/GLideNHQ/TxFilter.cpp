@@ -301,27 +301,29 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 					numcore--;
 				}
 				if (blkrow > 0 && numcore > 1) {
+					/* split into row bands; each band reads its neighbours' border
+					 * rows, so the result matches the single-threaded filter. */
 					std::thread *thrd[MAX_NUMCORE];
 					unsigned int i;
-					int blkheight = blkrow << 2;
-					unsigned int srcStride = (srcwidth * blkheight) << 2;
-					unsigned int destStride = srcStride * scale * scale;
+					unsigned int blkheight = blkrow << 2;
 					for (i = 0; i < numcore - 1; i++) {
-						thrd[i] = new std::thread(std::bind(filter_8888,
+						thrd[i] = new std::thread(std::bind(filter_8888_rows,
 																(uint32*)_texture,
 																srcwidth,
-																blkheight,
+																srcheight,
 																(uint32*)_tmptex,
-																filter));
-						_texture += srcStride;
-						_tmptex  += destStride;
+																filter,
+																blkheight * i,
+																blkheight * (i + 1)));
 					}
-					thrd[i] = new std::thread(std::bind(filter_8888,
+					thrd[i] = new std::thread(std::bind(filter_8888_rows,
 															(uint32*)_texture,
 															srcwidth,
-															srcheight - blkheight * i,
+															srcheight,
 															(uint32*)_tmptex,
-															filter));
+															filter,
+															blkheight * i,
+															srcheight));
 					for (i = 0; i < numcore; i++) {
 						thrd[i]->join();
 						delete thrd[i];
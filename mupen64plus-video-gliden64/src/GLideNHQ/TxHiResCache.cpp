@@ -117,7 +117,7 @@ TxHiResCache::TxHiResCache(int maxwidth, int maxheight, int maxbpp, int options,
 boolean
 TxHiResCache::empty()
 {
-  return _cache.empty();
+  return _cache.empty() && !packCount();
 }
 
 boolean
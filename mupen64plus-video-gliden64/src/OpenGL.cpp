@@ -151,6 +151,7 @@ extern "C" int retro_return(int just_flipping);
 
 void OGLVideo::swapBuffers()
 {
+	textureCache().finishAllLoads();
 	_swapBuffers();
    retro_return(true);
 	gDP.otherMode.l = 0;
@@ -781,6 +782,7 @@ void OGLRender::drawLLETriangle(uint32_t _numVtx)
 		}
 	}
 
+	textureCache().finishPendingLoads();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVtx);
 	triangles.num = 0;
 
@@ -793,6 +795,7 @@ void OGLRender::drawDMATriangles(uint32_t _numVtx)
 	if (_numVtx == 0 || !_canDraw())
 		return;
 	_prepareDrawTriangle(true);
+	textureCache().finishPendingLoads();
 	glDrawArrays(GL_TRIANGLES, 0, _numVtx);
 }
 
@@ -804,6 +807,7 @@ void OGLRender::drawTriangles()
 	}
 
 	_prepareDrawTriangle(false);
+	textureCache().finishPendingLoads();
 	glDrawElements(GL_TRIANGLES, triangles.num, GL_UNSIGNED_BYTE, triangles.elements);
 	triangles.num = 0;
 }
@@ -833,6 +837,7 @@ void OGLRender::drawLine(int _v0, int _v1, float _width)
 	elem[0] = _v0;
 	elem[1] = _v1;
 	glLineWidth(_width * video().getScaleX());
+	textureCache().finishPendingLoads();
 	glDrawElements(GL_LINES, 2, GL_UNSIGNED_SHORT, elem);
 
 }
@@ -898,6 +903,7 @@ void OGLRender::drawRect(int _ulx, int _uly, int _lrx, int _lry, float *_pColor)
 	else
 		glVertexAttrib4f(SC_COLOR, 0.0f, 0.0f, 0.0f, 0.0f);
 
+	textureCache().finishPendingLoads();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	gSP.changed |= CHANGED_GEOMETRYMODE | CHANGED_VIEWPORT;
 }
@@ -1185,6 +1191,7 @@ void OGLRender::drawTexturedRect(const TexturedRectParams & _params)
 			m_rect[i].x *= scale;
 	}
 
+	textureCache().finishPendingLoads();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	gSP.changed |= CHANGED_GEOMETRYMODE | CHANGED_VIEWPORT;
 }
@@ -2,6 +2,10 @@
 #include <stdint.h>
 #include <memory.h>
 #include <algorithm>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 #include <thread>         // std::this_thread::sleep_for
 #include <chrono>         // std::chrono::seconds
 #include "OpenGL.h"
@@ -22,6 +26,9 @@ using namespace std;
 const GLuint g_noiseTexIndex = 2;
 const GLuint g_MSTex0Index = g_noiseTexIndex + 1;
 
+// TMEM the texel fetchers read from. Decode workers point it at their own TMEM snapshot.
+static thread_local uint64_t * s_pTexelTMEM = TMEM;
+
 inline uint32_t GetNone( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
 {
 	return 0x00000000;
@@ -34,9 +41,9 @@ inline uint32_t GetCI4IA_RGBA4444( uint64_t *src, uint16_t x, uint16_t i, uint8_
 	color4B = ((uint8_t*)src)[(x>>1)^(i<<1)];
 
 	if (x & 1)
-		return IA88_RGBA4444( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B & 0x0F)] );
+		return IA88_RGBA4444( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B & 0x0F)] );
 	else
-		return IA88_RGBA4444( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B >> 4)] );
+		return IA88_RGBA4444( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B >> 4)] );
 }
 
 inline uint32_t GetCI4IA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
@@ -46,9 +53,9 @@ inline uint32_t GetCI4IA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_
 	color4B = ((uint8_t*)src)[(x>>1)^(i<<1)];
 
 	if (x & 1)
-		return IA88_RGBA8888( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B & 0x0F)] );
+		return IA88_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B & 0x0F)] );
 	else
-		return IA88_RGBA8888( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B >> 4)] );
+		return IA88_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B >> 4)] );
 }
 
 inline uint32_t GetCI4RGBA_RGBA5551( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
@@ -58,9 +65,9 @@ inline uint32_t GetCI4RGBA_RGBA5551( uint64_t *src, uint16_t x, uint16_t i, uint
 	color4B = ((uint8_t*)src)[(x>>1)^(i<<1)];
 
 	if (x & 1)
-		return RGBA5551_RGBA5551( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B & 0x0F)] );
+		return RGBA5551_RGBA5551( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B & 0x0F)] );
 	else
-		return RGBA5551_RGBA5551( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B >> 4)] );
+		return RGBA5551_RGBA5551( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B >> 4)] );
 }
 
 inline uint32_t GetCI4RGBA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
@@ -70,9 +77,9 @@ inline uint32_t GetCI4RGBA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint
 	color4B = ((uint8_t*)src)[(x>>1)^(i<<1)];
 
 	if (x & 1)
-		return RGBA5551_RGBA8888( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B & 0x0F)] );
+		return RGBA5551_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B & 0x0F)] );
 	else
-		return RGBA5551_RGBA8888( *(uint16_t*)&TMEM[256 + (palette << 4) + (color4B >> 4)] );
+		return RGBA5551_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + (palette << 4) + (color4B >> 4)] );
 }
 
 inline uint32_t GetIA31_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
@@ -113,22 +120,22 @@ inline uint32_t GetI4_RGBA4444( uint64_t *src, uint16_t x, uint16_t i, uint8_t p
 
 inline uint32_t GetCI8IA_RGBA4444( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
 {
-	return IA88_RGBA4444( *(uint16_t*)&TMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
+	return IA88_RGBA4444( *(uint16_t*)&s_pTexelTMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
 }
 
 inline uint32_t GetCI8IA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
 {
-	return IA88_RGBA8888( *(uint16_t*)&TMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
+	return IA88_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
 }
 
 inline uint32_t GetCI8RGBA_RGBA5551( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
 {
-	return RGBA5551_RGBA5551( *(uint16_t*)&TMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
+	return RGBA5551_RGBA5551( *(uint16_t*)&s_pTexelTMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
 }
 
 inline uint32_t GetCI8RGBA_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
 {
-	return RGBA5551_RGBA8888( *(uint16_t*)&TMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
+	return RGBA5551_RGBA8888( *(uint16_t*)&s_pTexelTMEM[256 + ((uint8_t*)src)[x^(i<<1)]] );
 }
 
 inline uint32_t GetIA44_RGBA8888( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette )
@@ -154,7 +161,7 @@ inline uint32_t GetI8_RGBA4444( uint64_t *src, uint16_t x, uint16_t i, uint8_t p
 inline uint32_t GetCI16IA_RGBA8888(uint64_t *src, uint16_t x, uint16_t i, uint8_t palette)
 {
 	const uint16_t tex = ((uint16_t*)src)[x^i];
-	const uint16_t col = (*(uint16_t*)&TMEM[256 + (tex >> 8)]);
+	const uint16_t col = (*(uint16_t*)&s_pTexelTMEM[256 + (tex >> 8)]);
 	const uint16_t c = col >> 8;
 	const uint16_t a = col & 0xFF;
 	return (a << 24) | (c << 16) | (c << 8) | c;
@@ -163,7 +170,7 @@ inline uint32_t GetCI16IA_RGBA8888(uint64_t *src, uint16_t x, uint16_t i, uint8_
 inline uint32_t GetCI16IA_RGBA4444(uint64_t *src, uint16_t x, uint16_t i, uint8_t palette)
 {
 	const uint16_t tex = ((uint16_t*)src)[x^i];
-	const uint16_t col = (*(uint16_t*)&TMEM[256 + (tex >> 8)]);
+	const uint16_t col = (*(uint16_t*)&s_pTexelTMEM[256 + (tex >> 8)]);
 	const uint16_t c = col >> 12;
 	const uint16_t a = col & 0x0F;
 	return (a << 12) | (c << 8) | (c << 4) | c;
@@ -172,13 +179,13 @@ inline uint32_t GetCI16IA_RGBA4444(uint64_t *src, uint16_t x, uint16_t i, uint8_
 inline uint32_t GetCI16RGBA_RGBA8888(uint64_t *src, uint16_t x, uint16_t i, uint8_t palette)
 {
 	const uint16_t tex = (((uint16_t*)src)[x^i])&0xFF;
-	return RGBA5551_RGBA8888(((uint16_t*)&TMEM[256])[tex << 2]);
+	return RGBA5551_RGBA8888(((uint16_t*)&s_pTexelTMEM[256])[tex << 2]);
 }
 
 inline uint32_t GetCI16RGBA_RGBA5551(uint64_t *src, uint16_t x, uint16_t i, uint8_t palette)
 {
 	const uint16_t tex = (((uint16_t*)src)[x^i]) & 0xFF;
-	return RGBA5551_RGBA5551(((uint16_t*)&TMEM[256])[tex << 2]);
+	return RGBA5551_RGBA5551(((uint16_t*)&s_pTexelTMEM[256])[tex << 2]);
 }
 
 inline uint32_t GetRGBA5551_RGBA8888(uint64_t *src, uint16_t x, uint16_t i, uint8_t palette)
@@ -432,6 +439,110 @@ inline uint32_t ReverseDXT(uint32_t val, uint32_t lrs, uint32_t width, uint32_t
 }
 /** end RiceVideo cite */
 
+static
+void _getTextureDestData(CachedTexture& tmptex, uint32_t* pDest, GLuint glInternalFormat,
+						GetTexelFunc GetTexel, uint16_t* pLine, uint32_t textureLUT);
+
+/*
+ * A texture decode handed to a TextureDecoder worker.
+ * Jobs are pooled and each one keeps its pixel buffer object, or staging memory
+ * on GLES2, for the life of the cache. The worker writes into pDest, which is
+ * the mapped PBO or the staging memory. Only the GL thread maps, unmaps and uploads.
+ */
+static const uint32_t TEXTURE_LOAD_JOBS = 16;
+static const uint32_t TEXTURE_LOAD_JOB_BYTES = 64 * 1024; // 128x128 RGBA8, larger textures load synchronously
+
+struct TextureLoadJob
+{
+	CachedTexture tex;
+	uint64_t tmem[512];
+	uint32_t textureLUT;
+	GetTexelFunc GetTexel;
+	GLuint glInternalFormat;
+	GLenum glType;
+	uint32_t * pDest;
+	uint32_t * pStaging;
+	GLuint PBO;
+	CachedTexture * pTexture; // Texture waiting for this job, NULL while the job is free
+	bool done;
+
+	TextureLoadJob() : tex(0), pDest(NULL), pStaging(NULL), PBO(0), pTexture(NULL), done(false) {}
+};
+
+class TextureDecoder
+{
+public:
+	TextureDecoder(uint32_t _numThreads) : m_bStop(false)
+	{
+		for (uint32_t i = 0; i < _numThreads; ++i)
+			m_threads.push_back(new std::thread(&TextureDecoder::_threadProc, this));
+	}
+
+	~TextureDecoder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+		}
+		m_jobCv.notify_all();
+		for (size_t i = 0; i < m_threads.size(); ++i) {
+			m_threads[i]->join();
+			delete m_threads[i];
+		}
+	}
+
+	void push(TextureLoadJob * _pJob)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(_pJob);
+		}
+		m_jobCv.notify_one();
+	}
+
+	// Block until this one job is decoded, other jobs keep running
+	void wait(TextureLoadJob * _pJob)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!_pJob->done)
+			m_doneCv.wait(lock);
+	}
+
+private:
+	void _threadProc()
+	{
+		for (;;) {
+			TextureLoadJob * pJob;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (m_jobs.empty() && !m_bStop)
+					m_jobCv.wait(lock);
+				if (m_jobs.empty())
+					return;
+				pJob = m_jobs.front();
+				m_jobs.pop_front();
+			}
+
+			s_pTexelTMEM = pJob->tmem;
+			uint16_t line = pJob->tex.line;
+			_getTextureDestData(pJob->tex, pJob->pDest, pJob->glInternalFormat, pJob->GetTexel, &line, pJob->textureLUT);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				pJob->done = true;
+			}
+			m_doneCv.notify_all();
+		}
+	}
+
+	std::vector<std::thread*> m_threads;
+	std::deque<TextureLoadJob*> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobCv;
+	std::condition_variable m_doneCv;
+	bool m_bStop;
+};
+
 TextureCache & TextureCache::get() {
 	static TextureCache cache;
 	return cache;
@@ -500,6 +611,23 @@ void TextureCache::init()
 	} else
 #endif
 	m_pMSDummy = NULL;
+
+	const uint32_t numThreads = std::min(std::thread::hardware_concurrency(), 5U);
+	if (config.texture.asyncDecode != 0 && numThreads > 1) {
+		m_pDecoder = new TextureDecoder(numThreads - 1);
+		m_pLoadJobs = new TextureLoadJob[TEXTURE_LOAD_JOBS];
+		m_nextLoadJob = 0;
+		for (uint32_t i = 0; i < TEXTURE_LOAD_JOBS; ++i) {
+#ifdef HAVE_OPENGLES2
+			m_pLoadJobs[i].pStaging = (uint32_t*)malloc(TEXTURE_LOAD_JOB_BYTES);
+#else
+			glGenBuffers(1, &m_pLoadJobs[i].PBO);
+			PBOBinder binder(GL_PIXEL_UNPACK_BUFFER, m_pLoadJobs[i].PBO);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, TEXTURE_LOAD_JOB_BYTES, NULL, GL_STREAM_DRAW);
+#endif
+		}
+	}
+
 	assert(!isGLError());
 }
 
@@ -507,8 +635,8 @@ void TextureCache::destroy()
 {
 	current[0] = current[1] = NULL;
 
-	for (Textures::const_iterator cur = m_textures.cbegin(); cur != m_textures.cend(); ++cur)
-		glDeleteTextures( 1, &cur->glName );
+	for (Textures::iterator cur = m_textures.begin(); cur != m_textures.end(); ++cur)
+		_deleteTexture(*cur);
 	m_textures.clear();
 	m_lruTextureLocations.clear();
 
@@ -517,6 +645,36 @@ void TextureCache::destroy()
 	m_fbTextures.clear();
 
 	m_cachedBytes = 0;
+
+	delete m_pDecoder;
+	m_pDecoder = NULL;
+
+	if (m_pLoadJobs != NULL) {
+		for (uint32_t i = 0; i < TEXTURE_LOAD_JOBS; ++i) {
+#ifdef HAVE_OPENGLES2
+			free(m_pLoadJobs[i].pStaging);
+#else
+			glDeleteBuffers(1, &m_pLoadJobs[i].PBO);
+#endif
+		}
+		delete[] m_pLoadJobs;
+		m_pLoadJobs = NULL;
+	}
+}
+
+void TextureCache::_deleteTexture(CachedTexture & _texture)
+{
+	if (_texture.pLoadJob != NULL) {
+		TextureLoadJob * pJob = _texture.pLoadJob;
+		m_pDecoder->wait(pJob);
+#ifndef HAVE_OPENGLES2
+		PBOBinder binder(GL_PIXEL_UNPACK_BUFFER, pJob->PBO);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+#endif
+		pJob->pTexture = NULL;
+		_texture.pLoadJob = NULL;
+	}
+	glDeleteTextures(1, &_texture.glName);
 }
 
 void TextureCache::_checkCacheSize()
@@ -529,7 +687,7 @@ void TextureCache::_checkCacheSize()
 		--iter;
 		CachedTexture& tex = *iter;
 		m_cachedBytes -= tex.textureBytes;
-		glDeleteTextures(1, &tex.glName);
+		_deleteTexture(tex);
 		m_lruTextureLocations.erase(tex.crc);
 	} while (m_cachedBytes > m_maxBytes && iter != m_textures.cbegin());
 	m_textures.erase(iter, m_textures.end());
@@ -881,13 +1039,16 @@ bool TextureCache::_loadHiresTexture(uint32_t _tile, CachedTexture *_pTexture, u
 }
 
 /*
- * Worker function for _load
+ * Worker function for _load, and for the decode workers.
+ * Reads texels from s_pTexelTMEM only, so it may run on any thread.
 */
-void TextureCache::_getTextureDestData(CachedTexture& tmptex,
+static
+void _getTextureDestData(CachedTexture& tmptex,
 						uint32_t* pDest,
 						GLuint glInternalFormat,
 						GetTexelFunc GetTexel,
-						uint16_t* pLine)
+						uint16_t* pLine,
+						uint32_t textureLUT)
 {
 	uint16_t mirrorSBit, maskSMask, clampSClamp;
 	uint16_t mirrorTBit, maskTMask, clampTClamp;
@@ -914,7 +1075,7 @@ void TextureCache::_getTextureDestData(CachedTexture& tmptex,
 	}
 
 	if (tmptex.size == G_IM_SIZ_32b) {
-		const uint16_t * tmem16 = (uint16_t*)TMEM;
+		const uint16_t * tmem16 = (uint16_t*)s_pTexelTMEM;
 		const uint32_t tbase = tmptex.tMem << 2;
 
 		int wid_64 = (tmptex.clampWidth) << 2;
@@ -959,7 +1120,7 @@ void TextureCache::_getTextureDestData(CachedTexture& tmptex,
 		j = 0;
 		*pLine <<= 1;
 		for (y = 0; y < tmptex.realHeight; ++y) {
-			pSrc = &TMEM[tmptex.tMem] + *pLine * y;
+			pSrc = &s_pTexelTMEM[tmptex.tMem] + *pLine * y;
 			for (x = 0; x < tmptex.realWidth / 2; x++) {
 				if (glInternalFormat == GL_RGBA) {
 					GetYUV_RGBA8888(pSrc, pDest + j, x);
@@ -971,14 +1132,14 @@ void TextureCache::_getTextureDestData(CachedTexture& tmptex,
 		}
 	} else {
 		j = 0;
-      const uint32_t tMemMask = gDP.otherMode.textureLUT == G_TT_NONE ? 0x1FF : 0xFF;
+      const uint32_t tMemMask = textureLUT == G_TT_NONE ? 0x1FF : 0xFF;
 		for (y = 0; y < tmptex.realHeight; ++y) {
 			ty = min(y, clampTClamp) & maskTMask;
 
 			if (y & mirrorTBit)
 			ty ^= maskTMask;
 
-         pSrc = &TMEM[(tmptex.tMem + *pLine * ty) & tMemMask];
+         pSrc = &s_pTexelTMEM[(tmptex.tMem + *pLine * ty) & tMemMask];
 
 			i = (ty & 1) << 1;
 			for (x = 0; x < tmptex.realWidth; ++x) {
@@ -1044,7 +1205,7 @@ void TextureCache::_load(uint32_t _tile, CachedTexture *_pTexture)
 	line = tmptex.line;
 
 	while (true) {
-		_getTextureDestData(tmptex, pDest, glInternalFormat, GetTexel, &line);
+		_getTextureDestData(tmptex, pDest, glInternalFormat, GetTexel, &line, gDP.otherMode.textureLUT);
 
 		bool bLoaded = false;
 		if (m_toggleDumpTex &&
@@ -1120,6 +1281,151 @@ void TextureCache::_load(uint32_t _tile, CachedTexture *_pTexture)
 	free(pDest);
 }
 
+/*
+ * Only plain single level textures are decoded asynchronously. Hi-res packs,
+ * enhancement filters and dumping go through GLideNHQ, which is not thread safe,
+ * and mip levels read the tile descriptors while they are loaded.
+*/
+bool TextureCache::_canLoadAsync(uint32_t _tile, const CachedTexture *_pTexture) const
+{
+	if (m_pDecoder == NULL)
+		return false;
+	if (config.textureFilter.txHiresEnable != 0 || config.textureFilter.txDump != 0 || m_toggleDumpTex)
+		return false;
+	if ((config.textureFilter.txEnhancementMode | config.textureFilter.txFilterMode) != 0)
+		return false;
+#ifndef HAVE_OPENGLES2
+	if (config.generalEmulation.enableLOD != 0 && gSP.texture.level > gSP.texture.tile + 1 && _tile != 0)
+		return false;
+#endif
+	return true;
+}
+
+TextureLoadJob * TextureCache::_getFreeLoadJob()
+{
+	// Round robin, so a PBO is reused as late as possible
+	for (uint32_t i = 0; i < TEXTURE_LOAD_JOBS; ++i) {
+		TextureLoadJob * pJob = &m_pLoadJobs[(m_nextLoadJob + i) % TEXTURE_LOAD_JOBS];
+		if (pJob->pTexture == NULL) {
+			m_nextLoadJob = (m_nextLoadJob + i + 1) % TEXTURE_LOAD_JOBS;
+			return pJob;
+		}
+	}
+	return NULL;
+}
+
+bool TextureCache::_loadAsync(CachedTexture *_pTexture)
+{
+	const TextureLoadParameters & loadParams = imageFormat[gDP.otherMode.textureLUT][_pTexture->size][_pTexture->format];
+	const bool bRGBA = loadParams.autoFormat == GL_RGBA;
+	const uint32_t textureBytes = (_pTexture->realWidth * _pTexture->realHeight) << (bRGBA ? 2 : 1);
+	if (textureBytes > TEXTURE_LOAD_JOB_BYTES)
+		return false;
+
+	TextureLoadJob * pJob = _getFreeLoadJob();
+	if (pJob == NULL)
+		return false;
+
+#ifdef HAVE_OPENGLES2
+	pJob->pDest = pJob->pStaging;
+#else
+	{
+		// Invalidating lets the driver hand out fresh storage if the last upload is still reading it
+		PBOBinder binder(GL_PIXEL_UNPACK_BUFFER, pJob->PBO);
+		pJob->pDest = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, textureBytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+#endif
+	if (pJob->pDest == NULL)
+		return false;
+
+	_pTexture->textureBytes = textureBytes;
+	_pTexture->max_level = 0;
+	if (bRGBA) {
+		pJob->GetTexel = loadParams.Get32;
+		pJob->glInternalFormat = loadParams.glInternalFormat32;
+		pJob->glType = loadParams.glType32;
+	} else {
+		pJob->GetTexel = loadParams.Get16;
+		pJob->glInternalFormat = loadParams.glInternalFormat16;
+		pJob->glType = loadParams.glType16;
+	}
+
+	memcpy(&pJob->tex, _pTexture, sizeof(CachedTexture));
+	memcpy(pJob->tmem, TMEM, sizeof(pJob->tmem));
+	pJob->textureLUT = gDP.otherMode.textureLUT;
+	pJob->pTexture = _pTexture;
+	pJob->done = false;
+
+	_pTexture->pLoadJob = pJob;
+	m_pDecoder->push(pJob);
+	return true;
+}
+
+void TextureCache::_finishLoad(CachedTexture *_pTexture)
+{
+	TextureLoadJob * pJob = _pTexture->pLoadJob;
+	m_pDecoder->wait(pJob);
+
+	glBindTexture(GL_TEXTURE_2D, _pTexture->glName);
+	if (_pTexture->realWidth % 2 != 0 &&
+			pJob->glInternalFormat != GL_RGBA &&
+			m_curUnpackAlignment > 1)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+#ifdef HAVE_OPENGLES2
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _pTexture->realWidth,
+			_pTexture->realHeight, 0, GL_RGBA, pJob->glType, pJob->pDest);
+#else
+	{
+		PBOBinder binder(GL_PIXEL_UNPACK_BUFFER, pJob->PBO);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glTexImage2D(GL_TEXTURE_2D, 0, pJob->glInternalFormat, _pTexture->realWidth,
+				_pTexture->realHeight, 0, GL_RGBA, pJob->glType, NULL);
+	}
+#endif
+	if (m_curUnpackAlignment > 1)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, m_curUnpackAlignment);
+
+	pJob->pTexture = NULL;
+	_pTexture->pLoadJob = NULL;
+}
+
+/*
+ * Called right before each draw. Waits only for the decodes the draw samples from,
+ * so a decode overlaps the vertex work between the texture update and the draw,
+ * and a texture replaced before anything is drawn with it never waits here.
+*/
+void TextureCache::finishPendingLoads()
+{
+	for (uint32_t t = 0; t < 2; ++t) {
+		if (current[t] == NULL || current[t]->pLoadJob == NULL)
+			continue;
+		glActiveTexture(GL_TEXTURE0 + t);
+		_finishLoad(current[t]);
+	}
+}
+
+/*
+ * Called at the frame boundary, uploads whatever was decoded but not drawn with
+ * so the jobs are free for the next frame.
+*/
+void TextureCache::finishAllLoads()
+{
+	if (m_pLoadJobs == NULL)
+		return;
+
+	GLint boundTexture = -1;
+	for (uint32_t i = 0; i < TEXTURE_LOAD_JOBS; ++i) {
+		if (m_pLoadJobs[i].pTexture == NULL)
+			continue;
+		if (boundTexture < 0)
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+		_finishLoad(m_pLoadJobs[i].pTexture);
+	}
+	if (boundTexture >= 0)
+		glBindTexture(GL_TEXTURE_2D, boundTexture);
+}
+
 struct TextureParams
 {
 	uint16_t width;
@@ -1339,9 +1645,9 @@ void TextureCache::_clear()
 {
 	current[0] = current[1] = NULL;
 
-	for (Textures::const_iterator cur = m_textures.cbegin(); cur != m_textures.cend(); ++cur) {
+	for (Textures::iterator cur = m_textures.begin(); cur != m_textures.end(); ++cur) {
 		m_cachedBytes -= cur->textureBytes;
-		glDeleteTextures(1, &cur->glName);
+		_deleteTexture(*cur);
 	}
 	m_textures.clear();
 	m_lruTextureLocations.clear();
@@ -1501,7 +1807,8 @@ void TextureCache::update(uint32_t _t)
 	pCurrent->offsetS = 0.5f;
 	pCurrent->offsetT = 0.5f;
 
-	_load(_t, pCurrent);
+	if (!_canLoadAsync(_t, pCurrent) || !_loadAsync(pCurrent))
+		_load(_t, pCurrent);
 	activateTexture( _t, pCurrent );
 
 	m_cachedBytes += pCurrent->textureBytes;
@@ -13,9 +13,12 @@ extern const GLuint g_MSTex0Index;
 
 typedef uint32_t (*GetTexelFunc)( uint64_t *src, uint16_t x, uint16_t i, uint8_t palette );
 
+struct TextureLoadJob;
+class TextureDecoder;
+
 struct CachedTexture
 {
-	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone) {}
+	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone), pLoadJob(NULL) {}
 
 	GLuint	glName;
 	uint32_t		crc;
@@ -45,6 +48,7 @@ struct CachedTexture
 		fbOneSample = 1,
 		fbMultiSample = 2
 	} frameBufferTexture;
+	TextureLoadJob * pLoadJob; // Decode in flight on a worker, texture has no data until it is finished
 };
 
 
@@ -61,11 +65,13 @@ struct TextureCache
 	void activateDummy(uint32_t _t);
 	void activateMSDummy(uint32_t _t);
 	void update(uint32_t _t);
+	void finishPendingLoads();
+	void finishAllLoads();
 
 	static TextureCache & get();
 
 private:
-	TextureCache() : m_pDummy(NULL), m_hits(0), m_misses(0), m_maxBytes(0), m_cachedBytes(0), m_curUnpackAlignment(4), m_toggleDumpTex(false)
+	TextureCache() : m_pDummy(NULL), m_pDecoder(NULL), m_pLoadJobs(NULL), m_nextLoadJob(0), m_hits(0), m_misses(0), m_maxBytes(0), m_cachedBytes(0), m_curUnpackAlignment(4), m_toggleDumpTex(false)
 	{
 		current[0] = NULL;
 		current[1] = NULL;
@@ -76,13 +82,17 @@ private:
 	void _checkCacheSize();
 	CachedTexture * _addTexture(uint32_t _crc32);
 	void _load(uint32_t _tile, CachedTexture *_pTexture);
+	bool _canLoadAsync(uint32_t _tile, const CachedTexture *_pTexture) const;
+	TextureLoadJob * _getFreeLoadJob();
+	bool _loadAsync(CachedTexture *_pTexture);
+	void _finishLoad(CachedTexture *_pTexture);
+	void _deleteTexture(CachedTexture & _texture);
 	bool _loadHiresTexture(uint32_t _tile, CachedTexture *_pTexture, uint64_t & _ricecrc);
 	void _loadBackground(CachedTexture *pTexture);
 	bool _loadHiresBackground(CachedTexture *_pTexture);
 	void _updateBackground();
 	void _clear();
 	void _initDummyTexture(CachedTexture * _pDummy);
-	void _getTextureDestData(CachedTexture& tmptex, uint32_t* pDest, GLuint glInternalFormat, GetTexelFunc GetTexel, uint16_t* pLine);
 
 	typedef std::list<CachedTexture> Textures;
 	typedef std::map<uint32_t, Textures::iterator> Texture_Locations;
@@ -92,6 +102,9 @@ private:
 	FBTextures m_fbTextures;
 	CachedTexture * m_pDummy;
 	CachedTexture * m_pMSDummy;
+	TextureDecoder * m_pDecoder;
+	TextureLoadJob * m_pLoadJobs;
+	uint32_t m_nextLoadJob;
 	uint32_t m_hits, m_misses;
 	uint32_t m_maxBytes;
 	uint32_t m_cachedBytes;
@@ -279,6 +279,26 @@ void gln64gSPClipVertex(uint32_t v)
 	if (vtx.w < 0.01f)  vtx.clip |= CLIP_Z;
 }
 
+static void gln64gSPTextureGenVertex(SPVertex & _vtx)
+{
+	float fLightDir[3] = {_vtx.nx, _vtx.ny, _vtx.nz};
+	float x, y;
+	if (gSP.lookatEnable) {
+		x = DotProduct(&gSP.lookat[0].x, fLightDir);
+		y = DotProduct(&gSP.lookat[1].x, fLightDir);
+	} else {
+		x = fLightDir[0];
+		y = fLightDir[1];
+	}
+	if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
+		_vtx.s = acosf(x) * 325.94931f;
+		_vtx.t = acosf(y) * 325.94931f;
+	} else { // G_TEXTURE_GEN
+		_vtx.s = (x + 1.0f) * 512.0f;
+		_vtx.t = (y + 1.0f) * 512.0f;
+	}
+}
+
 void gln64gSPProcessVertex(uint32_t v)
 {
 	if (gSP.changed & CHANGED_MATRIX)
@@ -313,26 +333,88 @@ void gln64gSPProcessVertex(uint32_t v)
 		else
 			gln64gSPLightVertex(vtx);
 
-		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0) {
-			float fLightDir[3] = {vtx.nx, vtx.ny, vtx.nz};
-			float x, y;
-			if (gSP.lookatEnable) {
-				x = DotProduct(&gSP.lookat[0].x, fLightDir);
-				y = DotProduct(&gSP.lookat[1].x, fLightDir);
-			} else {
-				x = fLightDir[0];
-				y = fLightDir[1];
+		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0)
+			gln64gSPTextureGenVertex(vtx);
+	} else
+		vtx.HWLight = 0;
+}
+
+/* Same as four gln64gSPProcessVertex calls on v..v+3. Transform, clipping and
+ * the default lights run through the shared batch kernels; screen adjustment,
+ * billboarding, hardware/CBFD lighting and texgen stay per vertex. */
+static void gln64gSPProcessVertex4(uint32_t v)
+{
+	if (gSP.changed & CHANGED_MATRIX)
+		gln64gSPCombineMatrices();
+
+	OGLVideo & ogl = video();
+	OGLRender & render = ogl.getRender();
+	SPVertex * vtx = &render.getVertex(v);
+	float vPos[3][4];
+	for (int i = 0; i < 4; ++i) {
+		vPos[0][i] = vtx[i].x;
+		vPos[1][i] = vtx[i].y;
+		vPos[2][i] = vtx[i].z;
+	}
+	TransformVertex4(vtx, gSP.matrix.combined);
+
+	if (ogl.isAdjustScreen() && (gDP.colorImage.width > VI.width * 98 / 100)) {
+		for (int i = 0; i < 4; ++i) {
+			vtx[i].x *= ogl.getAdjustScale();
+			if (gSP.matrix.projection[3][2] == -1.f)
+				vtx[i].w *= ogl.getAdjustScale();
+		}
+	}
+
+	if (gSP.viewport.vscale[0] < 0) {
+		for (int i = 0; i < 4; ++i)
+			vtx[i].x = -vtx[i].x;
+	}
+
+	if (gSP.matrix.billboard) {
+		for (int i = 0; i < 4; ++i)
+			gln64gSPBillboardVertex(v + i, 0);
+	}
+
+	ClipVertex4(vtx);
+
+	if (gSP.geometryMode & G_LIGHTING) {
+		TransformVectorNormalize4(vtx, gSP.matrix.modelView[gSP.matrix.modelViewi]);
+		if (gSP.geometryMode & G_POINT_LIGHTING) {
+			if (gln64gSPPointLightVertex == gln64gSPPointLightVertex_default)
+				PointLightVertex4(vtx, vPos, gSP.lights, gSP.numLights);
+			else {
+				for (int i = 0; i < 4; ++i) {
+					float pos[3] = {vPos[0][i], vPos[1][i], vPos[2][i]};
+					gln64gSPPointLightVertex(vtx[i], pos);
+				}
 			}
-			if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
-				vtx.s = acosf(x) * 325.94931f;
-				vtx.t = acosf(y) * 325.94931f;
-			} else { // G_TEXTURE_GEN
-				vtx.s = (x + 1.0f) * 512.0f;
-				vtx.t = (y + 1.0f) * 512.0f;
+		} else {
+			if (gln64gSPLightVertex == gln64gSPLightVertex_default && !config.generalEmulation.enableHWLighting)
+				LightVertex4(vtx, gSP.lights, gSP.numLights);
+			else {
+				for (int i = 0; i < 4; ++i)
+					gln64gSPLightVertex(vtx[i]);
 			}
 		}
-	} else
-		vtx.HWLight = 0;
+
+		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0) {
+			for (int i = 0; i < 4; ++i)
+				gln64gSPTextureGenVertex(vtx[i]);
+		}
+	} else {
+		for (int i = 0; i < 4; ++i)
+			vtx[i].HWLight = 0;
+	}
+}
+
+static void gln64gSPProcessVertices(uint32_t v0, uint32_t n)
+{
+	uint32_t v = v0;
+	for (; v + 4 <= v0 + n; v += 4)
+		gln64gSPProcessVertex4(v);
+	for (; v < v0 + n; ++v)
+		gln64gSPProcessVertex(v);
 }
 
 void gln64gSPLoadUcodeEx( uint32_t uc_start, uint32_t uc_dstart, uint16_t uc_dsize )
@@ -562,9 +644,9 @@ void gln64gSPVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.b = vertex->color.b * 0.0039215689f;
 				vtx.a = vertex->color.a * 0.0039215689f;
 			}
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -604,9 +686,9 @@ void gln64gSPCIVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = color[0] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -641,9 +723,9 @@ void gln64gSPDMAVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = *(uint8_t*)&gfx_info.RDRAM[(address + 9) ^ 3] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			address += 10;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -679,9 +761,9 @@ void gln64gSPCBFDVertex( uint32_t a, uint32_t n, uint32_t v0 )
 			vtx.g = vertex->color.g * 0.0039215689f;
 			vtx.b = vertex->color.b * 0.0039215689f;
 			vtx.a = vertex->color.a * 0.0039215689f;
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
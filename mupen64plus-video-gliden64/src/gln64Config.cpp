@@ -26,6 +26,7 @@ void gliden64_config::resetToDefaults()
 	texture.bilinearMode = BILINEAR_STANDARD;
 	texture.maxBytes = 500 * gc_uMegabyte;
 	texture.screenShotFormat = 0;
+	texture.asyncDecode = 1;
 
 	generalEmulation.enableLOD = 1;
 	generalEmulation.enableNoise = 1;
@@ -32,6 +32,7 @@ bool Config_SetDefault()
 
    /* Texture Settings */
 	config.texture.bilinearMode                  = 1; /* Bilinear filtering mode (0=N64 3point, 1=standard) */
+	config.texture.asyncDecode                   = 1; /* Decode new textures on worker threads while the draw is prepared */
 
 	/* Emulation Settings */
 	config.generalEmulation.enableNoise          = 1; /* Enable color noise emulation. */
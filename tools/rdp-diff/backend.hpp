@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// One RDP implementation driven from a recorded trace. Every backend owns its
+// own RDRAM, so they can run the same trace side by side.
+class Backend
+{
+public:
+    virtual ~Backend() {}
+
+    virtual const char* name() const = 0;
+
+    // Returns false if the renderer can't run on this host.
+    virtual bool init(uint32_t dram_size) = 0;
+
+    virtual void command(uint32_t cmd, const uint32_t* args, uint32_t words) = 0;
+
+    // Finishes all pending work so that rdram() and hidden() are coherent.
+    virtual void sync() = 0;
+
+    virtual uint8_t* rdram() = 0;
+
+    // Hidden bits, one byte per 16-bit RDRAM word, or NULL if not emulated.
+    virtual const uint8_t* hidden() = 0;
+};
+
+Backend* create_angrylion_backend(void);
+Backend* create_angrylion_thr_backend(uint32_t num_workers, bool async);
+#ifdef HAVE_PARALLEL
+Backend* create_parallel_backend(void);
+#endif
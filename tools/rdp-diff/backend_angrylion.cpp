@@ -0,0 +1,119 @@
+// mupen64plus-video-angrylion, fed through its regular DP FIFO interface.
+
+#include <string.h>
+#include <vector>
+
+#include <libretro.h>
+
+#include "backend.hpp"
+
+extern "C" {
+
+#include "m64p_plugin.h"
+
+void rdp_init(void);
+void process_RDP_list(void);
+
+extern uint8_t hidden_bits[0x400000];
+
+// same layout as RECT in vi.h
+struct rect
+{
+    int32_t left, top, right, bottom;
+};
+
+// glue normally provided by n64video_main.c and the libretro frontend
+GFX_INFO gfx_info;
+struct rect __src;
+uint32_t* blitter_buf_lock;
+retro_log_printf_t log_cb;
+
+}
+
+#define DP_STATUS_XBUS_DMA  0x001
+#define DMEM_SIZE           0x1000
+
+static uint32_t mi_intr;
+static uint32_t dpc_regs[8];
+
+static void check_interrupts(void)
+{
+}
+
+class AngrylionBackend : public Backend
+{
+public:
+    const char* name() const
+    {
+        return "angrylion";
+    }
+
+    bool init(uint32_t dram_size)
+    {
+        dram.resize(dram_size);
+
+        gfx_info.RDRAM = dram.data();
+        gfx_info.DMEM = (uint8_t*)dmem;
+        gfx_info.MI_INTR_REG = &mi_intr;
+        gfx_info.DPC_START_REG = &dpc_regs[0];
+        gfx_info.DPC_END_REG = &dpc_regs[1];
+        gfx_info.DPC_CURRENT_REG = &dpc_regs[2];
+        gfx_info.DPC_STATUS_REG = &dpc_regs[3];
+        gfx_info.DPC_CLOCK_REG = &dpc_regs[4];
+        gfx_info.DPC_BUFBUSY_REG = &dpc_regs[5];
+        gfx_info.DPC_PIPEBUSY_REG = &dpc_regs[6];
+        gfx_info.DPC_TMEM_REG = &dpc_regs[7];
+        gfx_info.CheckInterrupts = check_interrupts;
+
+        rdp_init();
+        return true;
+    }
+
+    void command(uint32_t cmd, const uint32_t* args, uint32_t words)
+    {
+        // commands are passed in DMEM, which never holds a partial command
+        if (dmem_pos + words > DMEM_SIZE / sizeof(uint32_t))
+            flush();
+
+        memcpy(dmem + dmem_pos, args, words * sizeof(uint32_t));
+        dmem_pos += words;
+    }
+
+    void sync()
+    {
+        flush();
+    }
+
+    uint8_t* rdram()
+    {
+        return dram.data();
+    }
+
+    const uint8_t* hidden()
+    {
+        return hidden_bits;
+    }
+
+private:
+    std::vector<uint8_t> dram;
+    uint32_t dmem[DMEM_SIZE / sizeof(uint32_t)];
+    uint32_t dmem_pos = 0;
+
+    void flush()
+    {
+        if (!dmem_pos)
+            return;
+
+        *gfx_info.DPC_STATUS_REG = DP_STATUS_XBUS_DMA;
+        *gfx_info.DPC_CURRENT_REG = 0;
+        *gfx_info.DPC_END_REG = dmem_pos * sizeof(uint32_t);
+        process_RDP_list();
+
+        dmem_pos = 0;
+    }
+};
+
+Backend* create_angrylion_backend(void)
+{
+    return new AngrylionBackend;
+}
@@ -0,0 +1,197 @@
+// mupen64plus-video-angrylion-thr, driven per command like al-replay, or in
+// asynchronous mode through the DP registers and DMEM like the emulator does.
+
+#include <string.h>
+#include <vector>
+
+#include "backend.hpp"
+
+#include "rdp.h"
+#include "rdram.h"
+#include "parallel_c.hpp"
+
+#define DP_STATUS_XBUS_DMA  0x001
+
+static std::vector<uint8_t> thr_rdram;
+static std::vector<uint8_t> thr_hidden(0x400000);
+static uint32_t dp_regs[DP_NUM_REG];
+static uint32_t* dp_reg_ptrs[DP_NUM_REG];
+static uint32_t vi_regs[VI_NUM_REG];
+static uint32_t* vi_reg_ptrs[VI_NUM_REG];
+static uint8_t dmem[0x1000];
+
+// glue normally provided by core.cpp and the frontend
+
+extern "C" {
+
+uint32_t** plugin_get_dp_registers(void)
+{
+    return dp_reg_ptrs;
+}
+
+uint32_t** plugin_get_vi_registers(void)
+{
+    return vi_reg_ptrs;
+}
+
+uint8_t* plugin_get_rdram(void)
+{
+    return thr_rdram.data();
+}
+
+uint8_t* plugin_get_rdram_hidden(void)
+{
+    return thr_hidden.data();
+}
+
+uint32_t plugin_get_rdram_size(void)
+{
+    return thr_rdram.size();
+}
+
+uint8_t* plugin_get_dmem(void)
+{
+    return dmem;
+}
+
+uint8_t* plugin_get_rom_header(void)
+{
+    return NULL;
+}
+
+unsigned angrylion_get_dithering(void)
+{
+    return 1;
+}
+
+void core_dp_sync(void)
+{
+}
+
+void core_dp_interrupt(void)
+{
+}
+
+void msg_error(const char* err, ...)
+{
+}
+
+void msg_warning(const char* err, ...)
+{
+}
+
+void msg_debug(const char* err, ...)
+{
+}
+
+}
+
+class AngrylionThrBackend : public Backend
+{
+public:
+    AngrylionThrBackend(uint32_t num_workers, bool async) : num_workers(num_workers), async(async)
+    {
+    }
+
+    ~AngrylionThrBackend()
+    {
+        rdp_close();
+        parallel_close();
+    }
+
+    const char* name() const
+    {
+        return async ? "angrylion-thr-async" : "angrylion-thr";
+    }
+
+    bool init(uint32_t dram_size)
+    {
+        int i;
+
+        for (i = 0; i < DP_NUM_REG; i++)
+            dp_reg_ptrs[i] = &dp_regs[i];
+        for (i = 0; i < VI_NUM_REG; i++)
+            vi_reg_ptrs[i] = &vi_regs[i];
+
+        thr_rdram.resize(dram_size);
+
+        // same initial hidden bits as core_init
+        memset(thr_hidden.data(), 0x03, thr_hidden.size());
+
+        memset(&config, 0, sizeof(config));
+        config.parallel = true;
+        config.num_workers = num_workers;
+        config.dp.async = async;
+
+        parallel_alinit(num_workers);
+        rdram_init();
+        rdp_init(&config);
+        return true;
+    }
+
+    void command(uint32_t cmd, const uint32_t* args, uint32_t words)
+    {
+        if (!async)
+        {
+            rdp_cmd(args, words);
+            return;
+        }
+
+        // commands are passed in DMEM, which never holds a partial command
+        if (dmem_pos + words > sizeof(dmem) / sizeof(uint32_t))
+            flush();
+
+        memcpy((uint32_t*)dmem + dmem_pos, args, words * sizeof(uint32_t));
+        dmem_pos += words;
+    }
+
+    void sync()
+    {
+        // a full sync makes the workers run all buffered commands
+        uint32_t sync_full[2] = { CMD_ID_SYNC_FULL << 24, 0 };
+
+        if (!async)
+        {
+            rdp_cmd(sync_full, 2);
+            return;
+        }
+
+        command(CMD_ID_SYNC_FULL, sync_full, 2);
+        flush();
+        rdp_wait();
+    }
+
+    uint8_t* rdram()
+    {
+        return thr_rdram.data();
+    }
+
+    const uint8_t* hidden()
+    {
+        return thr_hidden.data();
+    }
+
+private:
+    struct core_config config;
+    uint32_t num_workers;
+    bool async;
+    uint32_t dmem_pos = 0;
+
+    void flush()
+    {
+        if (!dmem_pos)
+            return;
+
+        dp_regs[DP_STATUS] = DP_STATUS_XBUS_DMA;
+        dp_regs[DP_CURRENT] = 0;
+        dp_regs[DP_END] = dmem_pos * sizeof(uint32_t);
+        rdp_update();
+
+        dmem_pos = 0;
+    }
+};
+
+Backend* create_angrylion_thr_backend(uint32_t num_workers, bool async)
+{
+    return new AngrylionThrBackend(num_workers, async);
+}
@@ -0,0 +1,98 @@
+// paraLLEl RDP, the same way rdp-test drives it. Needs a Vulkan driver, e.g.
+// lavapipe on hosts without a GPU.
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <stdio.h>
+
+#include "backend.hpp"
+
+#include "frontend.hpp"
+#include "rdp.hpp"
+#include "vulkan.hpp"
+#include "vulkan_util.hpp"
+
+// glue normally provided by the libretro frontend
+extern "C" unsigned setting_get_dithering(void)
+{
+    return 1;
+}
+
+class ParallelBackend : public Backend
+{
+public:
+    ~ParallelBackend()
+    {
+        renderer.reset();
+        device.reset();
+        context.reset();
+    }
+
+    const char* name() const
+    {
+        return "paraLLEl";
+    }
+
+    bool init(uint32_t dram_size)
+    {
+        if (!Vulkan::VulkanContext::init_loader())
+            return false;
+
+        try
+        {
+            context.reset(new Vulkan::VulkanContext);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "paraLLEl: %s\n", e.what());
+            return false;
+        }
+
+        device.reset(new Vulkan::Device(*context, 3));
+        renderer.reset(new RDP::Renderer(*device));
+        frontend.set_renderer(renderer.get(), device.get());
+
+        dram.resize(dram_size);
+        renderer->set_rdram(dram.data(), dram.size());
+        return true;
+    }
+
+    void command(uint32_t cmd, const uint32_t* args, uint32_t words)
+    {
+        frontend.command(cmd, args);
+    }
+
+    void sync()
+    {
+        renderer->sync_full();
+
+        begin_index = (begin_index + 1) % 3;
+        device->begin_index(begin_index);
+        renderer->begin_index(begin_index);
+    }
+
+    uint8_t* rdram()
+    {
+        return dram.data();
+    }
+
+    const uint8_t* hidden()
+    {
+        return NULL;
+    }
+
+private:
+    std::unique_ptr<Vulkan::VulkanContext> context;
+    std::unique_ptr<Vulkan::Device> device;
+    std::unique_ptr<RDP::Renderer> renderer;
+    RDP::Frontend frontend;
+    std::vector<uint8_t> dram;
+    unsigned begin_index = 0;
+};
+
+Backend* create_parallel_backend(void)
+{
+    return new ParallelBackend;
+}
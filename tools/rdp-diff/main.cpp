@@ -0,0 +1,377 @@
+// Replays one RDPDUMP1 trace through every available RDP implementation in
+// lockstep and compares color, depth and hidden bits after each command list.
+//
+// The first backend is the reference, normally the original angrylion. Traces
+// can be recorded with HAVE_RDP_DUMP=1 and RDP_DUMP=<path> with either
+// angrylion or paraLLEl.
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.hpp"
+#include "rdp_dump.hpp"
+
+using namespace std;
+
+#define CMD_ID_SET_SCISSOR      0x2d
+#define CMD_ID_SET_MASK_IMAGE   0x3e
+#define CMD_ID_SET_COLOR_IMAGE  0x3f
+
+#define PIXEL_SIZE_8BIT         1
+#define PIXEL_SIZE_16BIT        2
+#define PIXEL_SIZE_32BIT        3
+
+// RDRAM is stored in 32-bit host words
+#define BYTE_ADDR_XOR           3
+#define WORD_ADDR_XOR           1
+
+// Framebuffer state at the end of a command list, tracked from the trace.
+struct image_state
+{
+    uint32_t color_addr;
+    uint32_t color_size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth_addr;
+    bool depth_valid;
+};
+
+struct diff_stats
+{
+    uint64_t color;
+    uint64_t depth;
+    uint64_t hidden;
+    uint64_t bytes;
+    uint32_t lists;
+};
+
+struct backend_state
+{
+    unique_ptr<Backend> backend;
+    chrono::steady_clock::duration time;
+    struct diff_stats diff;
+};
+
+static void track_state(struct image_state* state, uint32_t cmd, const uint32_t* args)
+{
+    switch (cmd)
+    {
+        case CMD_ID_SET_COLOR_IMAGE:
+            state->color_size = (args[0] >> 19) & 3;
+            state->width = (args[0] & 0x3ff) + 1;
+            state->color_addr = args[1] & 0xffffff;
+            break;
+        case CMD_ID_SET_MASK_IMAGE:
+            state->depth_addr = args[1] & 0xffffff;
+            state->depth_valid = true;
+            break;
+        case CMD_ID_SET_SCISSOR:
+            // lower right corner is u10.2
+            state->height = (args[1] & 0xfff) >> 2;
+            break;
+    }
+}
+
+static uint32_t read_pixel(const uint8_t* dram, uint32_t addr, uint32_t size, uint32_t i)
+{
+    switch (size)
+    {
+        case PIXEL_SIZE_8BIT:
+            return dram[(addr + i) ^ BYTE_ADDR_XOR];
+        case PIXEL_SIZE_16BIT:
+            return ((const uint16_t*)dram)[((addr >> 1) + i) ^ WORD_ADDR_XOR];
+        default:
+            return ((const uint32_t*)dram)[(addr >> 2) + i];
+    }
+}
+
+// Hidden bits belonging to a pixel, packed into one value.
+static uint32_t read_hidden(const uint8_t* hidden, uint32_t addr, uint32_t size, uint32_t i)
+{
+    switch (size)
+    {
+        case PIXEL_SIZE_8BIT:
+            return hidden[(addr + i) >> 1];
+        case PIXEL_SIZE_16BIT:
+            return hidden[(addr >> 1) + i];
+        default:
+        {
+            uint32_t idx = ((addr >> 2) + i) << 1;
+            return hidden[idx] | hidden[idx + 1] << 8;
+        }
+    }
+}
+
+static uint32_t compare_image(const char* label, const char* name, uint32_t list,
+    Backend* ref, Backend* other, uint32_t addr, uint32_t size, uint32_t width,
+    uint32_t height, uint32_t dram_size, uint64_t* hidden_diff, bool verbose)
+{
+    uint32_t bytes = (width * height << size) >> 1;
+    uint32_t diff = 0;
+    uint32_t i;
+
+    if (!size || !width || !height || addr + bytes > dram_size)
+        return 0;
+
+    const uint8_t* ref_dram = ref->rdram();
+    const uint8_t* dram = other->rdram();
+    const uint8_t* ref_hidden = ref->hidden();
+    const uint8_t* hidden = other->hidden();
+
+    for (i = 0; i < width * height; i++)
+    {
+        uint32_t a = read_pixel(ref_dram, addr, size, i);
+        uint32_t b = read_pixel(dram, addr, size, i);
+
+        if (a != b)
+        {
+            if (!diff && verbose)
+            {
+                printf("  list %u: %s %s differs first at (%u, %u): %08x != %08x\n",
+                    list, name, label, i % width, i / width, a, b);
+            }
+            diff++;
+        }
+
+        if (ref_hidden && hidden &&
+            read_hidden(ref_hidden, addr, size, i) != read_hidden(hidden, addr, size, i))
+            (*hidden_diff)++;
+    }
+
+    return diff;
+}
+
+static uint64_t compare_bytes(const uint8_t* a, const uint8_t* b, uint32_t size)
+{
+    uint64_t diff = 0;
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+        diff += a[i] != b[i];
+
+    return diff;
+}
+
+static void print_help(void)
+{
+    fprintf(stderr,
+        "usage: rdp-diff [options] <dump>\n"
+        "  --backends <a,b,...>  renderers to run, the first one is the reference\n"
+        "                        (default: angrylion,angrylion-thr,paraLLEl),\n"
+        "                        angrylion-thr-async runs the RDP thread of the\n"
+        "                        asynchronous mode, only one angrylion-thr variant\n"
+        "                        can run at a time\n"
+        "  --workers <n>         angrylion-thr worker count (default: one per core)\n"
+        "  --max-reports <n>     number of differing lists to describe (default: 10)\n"
+        "  --help                show this text\n");
+}
+
+static Backend* create_backend(const string& name, uint32_t num_workers)
+{
+    if (name == "angrylion")
+        return create_angrylion_backend();
+    if (name == "angrylion-thr")
+        return create_angrylion_thr_backend(num_workers, false);
+    if (name == "angrylion-thr-async")
+        return create_angrylion_thr_backend(num_workers, true);
+#ifdef HAVE_PARALLEL
+    if (name == "paraLLEl")
+        return create_parallel_backend();
+#endif
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = NULL;
+    string backend_list = "angrylion,angrylion-thr,paraLLEl";
+    uint32_t num_workers = 0;
+    uint32_t max_reports = 10;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--backends") && i + 1 < argc)
+            backend_list = argv[++i];
+        else if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+            num_workers = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--max-reports") && i + 1 < argc)
+            max_reports = strtoul(argv[++i], NULL, 10);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            print_help();
+            return !strcmp(argv[i], "--help") ? 0 : 1;
+        }
+    }
+
+    if (!path)
+    {
+        print_help();
+        return 1;
+    }
+
+    RDP::Dump dump;
+    if (!RDP::load_dump(path, &dump))
+    {
+        fprintf(stderr, "Failed to load dump: %s\n", path);
+        return 1;
+    }
+
+    vector<struct backend_state> backends;
+
+    size_t pos = 0;
+    while (pos <= backend_list.size())
+    {
+        size_t end = backend_list.find(',', pos);
+        if (end == string::npos)
+            end = backend_list.size();
+
+        string name = backend_list.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (name.empty())
+            continue;
+
+        struct backend_state state;
+        state.backend.reset(create_backend(name, num_workers));
+        state.time = chrono::steady_clock::duration::zero();
+        memset(&state.diff, 0, sizeof(state.diff));
+
+        if (!state.backend)
+        {
+            fprintf(stderr, "%s: not available in this build\n", name.c_str());
+            continue;
+        }
+
+        if (!state.backend->init(dump.dram_size))
+        {
+            fprintf(stderr, "%s: can't run on this host, skipped\n", name.c_str());
+            continue;
+        }
+
+        backends.push_back(move(state));
+    }
+
+    if (backends.size() < 2)
+        fprintf(stderr, "Less than two renderers available, only timing is reported.\n");
+
+    printf("%s: %u command lists\n\n", path, (unsigned)dump.lists.size());
+
+    Backend* ref = backends.empty() ? NULL : backends[0].backend.get();
+    struct image_state image;
+    uint32_t reports = 0;
+    uint32_t list_index = 0;
+
+    memset(&image, 0, sizeof(image));
+
+    for (auto& list : dump.lists)
+    {
+        for (auto& cmd : list.commands)
+            if (!cmd.arguments.empty())
+                track_state(&image, cmd.command & 0x3f, cmd.arguments.data());
+
+        for (auto& state : backends)
+        {
+            Backend* backend = state.backend.get();
+
+            for (auto& update : list.dram_updates)
+            {
+                if (update.offset + update.payload.size() <= dump.dram_size)
+                    memcpy(backend->rdram() + update.offset, update.payload.data(), update.payload.size());
+            }
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+            for (auto& cmd : list.commands)
+            {
+                if (!cmd.arguments.empty())
+                    backend->command(cmd.command & 0x3f, cmd.arguments.data(), cmd.arguments.size());
+            }
+
+            backend->sync();
+
+            state.time += chrono::steady_clock::now() - start;
+        }
+
+        for (size_t b = 1; b < backends.size(); b++)
+        {
+            Backend* backend = backends[b].backend.get();
+            struct diff_stats* diff = &backends[b].diff;
+            bool verbose = reports < max_reports;
+
+            uint64_t color = compare_image("color", backend->name(), list_index, ref, backend,
+                image.color_addr, image.color_size, image.width, image.height,
+                dump.dram_size, &diff->hidden, verbose);
+
+            uint64_t depth = 0;
+            if (image.depth_valid)
+            {
+                depth = compare_image("depth", backend->name(), list_index, ref, backend,
+                    image.depth_addr, PIXEL_SIZE_16BIT, image.width, image.height,
+                    dump.dram_size, &diff->hidden, verbose);
+            }
+
+            uint64_t bytes = compare_bytes(ref->rdram(), backend->rdram(), dump.dram_size);
+
+            if (color || depth || bytes)
+            {
+                diff->lists++;
+                if (verbose)
+                {
+                    printf("  list %u: %s differs in %llu color pixels, %llu depth pixels, %llu RDRAM bytes\n",
+                        list_index, backend->name(), (unsigned long long)color,
+                        (unsigned long long)depth, (unsigned long long)bytes);
+                    reports++;
+                }
+            }
+
+            diff->color += color;
+            diff->depth += depth;
+            diff->bytes += bytes;
+        }
+
+        list_index++;
+    }
+
+    if (reports)
+        printf("\n");
+
+    printf("%-20s %10s %10s %12s %12s %12s %8s\n",
+        "renderer", "time ms", "ms/list", "color diff", "depth diff", "hidden diff", "lists");
+
+    bool mismatch = false;
+
+    for (size_t b = 0; b < backends.size(); b++)
+    {
+        struct backend_state& state = backends[b];
+        double ms = chrono::duration<double, milli>(state.time).count();
+
+        printf("%-20s %10.2f %10.3f", state.backend->name(), ms,
+            dump.lists.empty() ? 0.0 : ms / dump.lists.size());
+
+        if (!b)
+            printf(" %12s %12s %12s %8s\n", "reference", "", "", "");
+        else
+        {
+            bool has_hidden = ref->hidden() && state.backend->hidden();
+
+            printf(" %12llu %12llu %12s %8u\n",
+                (unsigned long long)state.diff.color,
+                (unsigned long long)state.diff.depth,
+                has_hidden ? to_string(state.diff.hidden).c_str() : "n/a",
+                state.diff.lists);
+
+            mismatch |= state.diff.lists != 0;
+        }
+    }
+
+    return mismatch ? 1 : 0;
+}